@@ -0,0 +1,22 @@
+package java.lang;
+
+public class Runtime {
+    private static Runtime currentRuntime = new Runtime();
+
+    private Runtime() {}
+
+    public static Runtime getRuntime() {
+        return currentRuntime;
+    }
+
+    // Bytes which can be allocated before the next garbage collection
+    public native long freeMemory();
+    // Bytes of all objects and arrays plus free memory
+    public native long totalMemory();
+    // Heap of yvm has no fixed capacity, it's always Long.MAX_VALUE
+    public native long maxMemory();
+
+    public void gc() {
+        System.gc();
+    }
+}
@@ -0,0 +1,11 @@
+package java.lang;
+
+public final class System {
+    private System() {}
+
+    // Perform a full garbage collection and return after it's done
+    public static native void gc();
+
+    // Milliseconds since the epoch
+    public static native long currentTimeMillis();
+}
@@ -1,11 +1,92 @@
 package java.lang;
 
-public class Thread {
+public class Thread implements Runnable {
     private Runnable task;
+    // Thread id is assigned by start()
+    private long tid;
+    // It's guarded by the monitor of this thread, join() waits on it
+    private boolean alive;
+    // Virtual thread runs on a carrier thread rather than a native thread of
+    // its own
+    private boolean virtual;
+
+    public Thread() {}
 
     public Thread(Runnable runnable) {
         this.task = runnable;
     }
 
+    public static native Thread currentThread();
+
+    public static native void sleep(long millis) throws InterruptedException;
+
+    public static native void yield();
+
     public synchronized native void start();
+
+    public static Thread startVirtualThread(Runnable task) {
+        Thread thread = new Thread(task);
+        thread.startVirtual();
+        return thread;
+    }
+
+    private synchronized native void startVirtual();
+
+    // Subclasses override it, otherwise the task is executed
+    @Override
+    public void run() {
+        if (task != null) {
+            task.run();
+        }
+    }
+
+    public final synchronized boolean isAlive() {
+        return alive;
+    }
+
+    public final void join() throws InterruptedException {
+        join(0);
+    }
+
+    // Wait at most millis milliseconds for this thread to terminate, zero
+    // means to wait forever
+    public final synchronized void join(long millis)
+        throws InterruptedException {
+        long base = System.currentTimeMillis();
+        long now = 0;
+        if (millis == 0) {
+            while (alive) {
+                wait(0);
+            }
+        } else {
+            while (alive) {
+                long delay = millis - now;
+                if (delay <= 0) {
+                    break;
+                }
+                wait(delay);
+                now = System.currentTimeMillis() - base;
+            }
+        }
+    }
+
+    // Called by VM after run() returns
+    private synchronized void exit() {
+        alive = false;
+        notifyAll();
+    }
+
+    public final boolean isVirtual() {
+        return virtual;
+    }
+
+    public long getId() {
+        return tid;
+    }
+
+    public native void interrupt();
+
+    public native boolean isInterrupted();
+
+    public static native boolean interrupted();
 }
@@ -0,0 +1,47 @@
+package ydk.concurrent;
+
+public class AtomicInteger {
+    // It's only accessed by natives, which update it in place
+    private volatile int value;
+
+    public AtomicInteger() {
+    }
+
+    public AtomicInteger(int initialValue) {
+        set(initialValue);
+    }
+
+    public native int get();
+
+    public native void set(int newValue);
+
+    // Stores before it are visible to threads seeing the new value, but it
+    // may be reordered with later loads
+    public native void lazySet(int newValue);
+
+    public native int getAndSet(int newValue);
+
+    public native boolean compareAndSet(int expect, int update);
+
+    public native int getAndAdd(int delta);
+
+    public int getAndIncrement() {
+        return getAndAdd(1);
+    }
+
+    public int getAndDecrement() {
+        return getAndAdd(-1);
+    }
+
+    public int incrementAndGet() {
+        return getAndAdd(1) + 1;
+    }
+
+    public int decrementAndGet() {
+        return getAndAdd(-1) - 1;
+    }
+
+    public int addAndGet(int delta) {
+        return getAndAdd(delta) + delta;
+    }
+}
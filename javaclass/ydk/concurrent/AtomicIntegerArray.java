@@ -0,0 +1,46 @@
+package ydk.concurrent;
+
+public class AtomicIntegerArray {
+    // Elements are only accessed by natives
+    private final int[] array;
+
+    public AtomicIntegerArray(int length) {
+        array = new int[length];
+    }
+
+    public int length() {
+        return array.length;
+    }
+
+    public native int get(int i);
+
+    public native void set(int i, int newValue);
+
+    public native void lazySet(int i, int newValue);
+
+    public native int getAndSet(int i, int newValue);
+
+    public native boolean compareAndSet(int i, int expect, int update);
+
+    public native int getAndAdd(int i, int delta);
+
+    public int getAndIncrement(int i) {
+        return getAndAdd(i, 1);
+    }
+
+    public int getAndDecrement(int i) {
+        return getAndAdd(i, -1);
+    }
+
+    public int incrementAndGet(int i) {
+        return getAndAdd(i, 1) + 1;
+    }
+
+    public int decrementAndGet(int i) {
+        return getAndAdd(i, -1) - 1;
+    }
+
+    public int addAndGet(int i, int delta) {
+        return getAndAdd(i, delta) + delta;
+    }
+}
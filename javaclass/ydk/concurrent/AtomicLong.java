@@ -0,0 +1,45 @@
+package ydk.concurrent;
+
+public class AtomicLong {
+    // It's only accessed by natives, which update it in place
+    private volatile long value;
+
+    public AtomicLong() {
+    }
+
+    public AtomicLong(long initialValue) {
+        set(initialValue);
+    }
+
+    public native long get();
+
+    public native void set(long newValue);
+
+    public native void lazySet(long newValue);
+
+    public native long getAndSet(long newValue);
+
+    public native boolean compareAndSet(long expect, long update);
+
+    public native long getAndAdd(long delta);
+
+    public long getAndIncrement() {
+        return getAndAdd(1L);
+    }
+
+    public long getAndDecrement() {
+        return getAndAdd(-1L);
+    }
+
+    public long incrementAndGet() {
+        return getAndAdd(1L) + 1L;
+    }
+
+    public long decrementAndGet() {
+        return getAndAdd(-1L) - 1L;
+    }
+
+    public long addAndGet(long delta) {
+        return getAndAdd(delta) + delta;
+    }
+}
@@ -0,0 +1,46 @@
+package ydk.concurrent;
+
+public class AtomicLongArray {
+    // Elements are only accessed by natives
+    private final long[] array;
+
+    public AtomicLongArray(int length) {
+        array = new long[length];
+    }
+
+    public int length() {
+        return array.length;
+    }
+
+    public native long get(int i);
+
+    public native void set(int i, long newValue);
+
+    public native void lazySet(int i, long newValue);
+
+    public native long getAndSet(int i, long newValue);
+
+    public native boolean compareAndSet(int i, long expect, long update);
+
+    public native long getAndAdd(int i, long delta);
+
+    public long getAndIncrement(int i) {
+        return getAndAdd(i, 1L);
+    }
+
+    public long getAndDecrement(int i) {
+        return getAndAdd(i, -1L);
+    }
+
+    public long incrementAndGet(int i) {
+        return getAndAdd(i, 1L) + 1L;
+    }
+
+    public long decrementAndGet(int i) {
+        return getAndAdd(i, -1L) - 1L;
+    }
+
+    public long addAndGet(int i, long delta) {
+        return getAndAdd(i, delta) + delta;
+    }
+}
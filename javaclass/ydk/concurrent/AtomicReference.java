@@ -0,0 +1,24 @@
+package ydk.concurrent;
+
+public class AtomicReference<V> {
+    // It's only accessed by natives
+    private volatile V value;
+
+    public AtomicReference() {
+    }
+
+    public AtomicReference(V initialValue) {
+        set(initialValue);
+    }
+
+    public native V get();
+
+    public native void set(V newValue);
+
+    public native void lazySet(V newValue);
+
+    public native V getAndSet(V newValue);
+
+    // References are compared by identity
+    public native boolean compareAndSet(V expect, V update);
+}
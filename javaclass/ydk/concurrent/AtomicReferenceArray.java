@@ -0,0 +1,27 @@
+package ydk.concurrent;
+
+public class AtomicReferenceArray<E> {
+    // It's assigned by init(), and elements are only accessed by natives
+    private Object[] array;
+
+    public AtomicReferenceArray(int length) {
+        init(length);
+    }
+
+    // Create the array with null elements
+    private native void init(int length);
+
+    public int length() {
+        return array.length;
+    }
+
+    public native E get(int i);
+
+    public native void set(int i, E newValue);
+
+    public native void lazySet(int i, E newValue);
+
+    public native E getAndSet(int i, E newValue);
+
+    public native boolean compareAndSet(int i, E expect, E update);
+}
@@ -0,0 +1,18 @@
+package ydk.concurrent;
+
+public class CountDownLatch {
+    public CountDownLatch(int count) {
+        init(count);
+    }
+
+    private native void init(int count);
+
+    public native void await() throws InterruptedException;
+
+    // Wait at most timeout milliseconds, return whether the count reached zero
+    public native boolean await(long timeout) throws InterruptedException;
+
+    public native void countDown();
+
+    public native long getCount();
+}
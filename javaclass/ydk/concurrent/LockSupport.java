@@ -0,0 +1,12 @@
+package ydk.concurrent;
+
+// Every thread has a permit, park() consumes it or blocks until it's available
+// and unpark() makes it available. Parking may return spuriously, so callers
+// must recheck their conditions in a loop
+public class LockSupport {
+    public static native void park();
+
+    public static native void parkNanos(long nanos);
+
+    public static native void unpark(Thread thread);
+}
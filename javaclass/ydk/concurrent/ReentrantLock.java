@@ -0,0 +1,26 @@
+package ydk.concurrent;
+
+// A reentrant mutual exclusion lock, its state is kept by the VM so that an
+// uncontended lock() or unlock() is a single CAS
+public class ReentrantLock {
+    public ReentrantLock() {
+        init();
+    }
+
+    private native void init();
+
+    public native void lock();
+
+    public native void lockInterruptibly() throws InterruptedException;
+
+    public native boolean tryLock();
+
+    // Wait at most timeout milliseconds for the lock
+    public native boolean tryLock(long timeout) throws InterruptedException;
+
+    public native void unlock();
+
+    public native boolean isHeldByCurrentThread();
+
+    public native int getHoldCount();
+}
@@ -0,0 +1,33 @@
+package ydk.concurrent;
+
+public class Semaphore {
+    public Semaphore(int permits) {
+        init(permits);
+    }
+
+    private native void init(int permits);
+
+    public void acquire() throws InterruptedException {
+        acquire(1);
+    }
+
+    public native void acquire(int permits) throws InterruptedException;
+
+    public boolean tryAcquire() {
+        return tryAcquire(1);
+    }
+
+    public native boolean tryAcquire(int permits);
+
+    // Wait at most timeout milliseconds for the permits
+    public native boolean tryAcquire(int permits, long timeout)
+        throws InterruptedException;
+
+    public void release() {
+        release(1);
+    }
+
+    public native void release(int permits);
+
+    public native int availablePermits();
+}
@@ -0,0 +1,8 @@
+package ydk.lang;
+
+public class Diagnostics {
+    // Print instance counts and bytes of every class at a safepoint
+    public static native void printHeapHistogram();
+    // Write a heap dump in HPROF format, return false if it can't be written
+    public static native boolean dumpHeap(String path);
+}
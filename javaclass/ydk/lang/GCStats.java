@@ -0,0 +1,10 @@
+package ydk.lang;
+
+public class GCStats {
+    // Number of garbage collection cycles so far
+    public static native long getCollectionCount();
+    // Total pause time of all cycles in nanoseconds
+    public static native long getTotalPauseNanos();
+    // Total bytes freed by all cycles
+    public static native long getBytesReclaimed();
+}
@@ -0,0 +1,84 @@
+package ydk.test;
+
+import ydk.concurrent.AtomicInteger;
+import ydk.concurrent.AtomicIntegerArray;
+import ydk.concurrent.AtomicLong;
+import ydk.concurrent.AtomicLongArray;
+import ydk.concurrent.AtomicReference;
+import ydk.concurrent.AtomicReferenceArray;
+import ydk.lang.IO;
+
+public class AtomicTest {
+    static final AtomicInteger counter = new AtomicInteger();
+    static final AtomicLong total = new AtomicLong(100L);
+    static final AtomicIntegerArray hits = new AtomicIntegerArray(4);
+    static final AtomicLongArray sums = new AtomicLongArray(4);
+    // A spin lock taken by swapping the owner in, it guards plain
+    static final AtomicReference<Object> owner = new AtomicReference<Object>();
+    static final AtomicReferenceArray<Object> slots =
+        new AtomicReferenceArray<Object>(4);
+    static final AtomicInteger claims = new AtomicInteger();
+    static int plain;
+
+    static class Worker implements Runnable {
+        @Override
+        public void run() {
+            // Every slot is claimed by exactly one worker
+            for (int k = 0; k < 4; k++) {
+                if (slots.compareAndSet(k, null, this)) {
+                    claims.getAndIncrement();
+                }
+            }
+            long last = 0L;
+            for (int i = 0; i < 500; i++) {
+                counter.incrementAndGet();
+                last = total.addAndGet(2L);
+                hits.getAndIncrement(i & 3);
+                last = sums.addAndGet(i & 3, 3L);
+                while (!owner.compareAndSet(null, this)) {
+                    Thread.yield();
+                }
+                plain++;
+                owner.set(null);
+            }
+        }
+    }
+
+    static void check(boolean ok) {
+        IO.print(ok ? 1 : 0);
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        Thread a = new Thread(new Worker());
+        Thread b = new Thread(new Worker());
+        Thread c = new Thread(new Worker());
+        Thread d = new Thread(new Worker());
+        a.start();
+        b.start();
+        c.start();
+        d.start();
+        a.join();
+        b.join();
+        c.join();
+        d.join();
+
+        check(counter.get() == 2000);
+        check(total.get() == 4100L);
+        boolean even = true;
+        for (int k = 0; k < 4; k++) {
+            if (hits.get(k) != 500 || sums.get(k) != 1500L) {
+                even = false;
+            }
+        }
+        check(even);
+        check(claims.get() == 4);
+        check(plain == 2000);
+        // A failed CAS leaves the value alone
+        check(!counter.compareAndSet(1, 2) && counter.compareAndSet(2000, 7) &&
+              counter.getAndSet(8) == 7);
+        // References are compared by identity
+        check(!owner.compareAndSet(new Object(), null) && owner.get() == null);
+        total.lazySet(5L);
+        check(total.get() == 5L && total.decrementAndGet() == 4L);
+    }
+}
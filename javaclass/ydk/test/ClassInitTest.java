@@ -0,0 +1,42 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class ClassInitTest {
+    static class Slow {
+        static int value;
+
+        static {
+            // Other threads ask for the class meanwhile, they must wait
+            try {
+                Thread.sleep(200);
+            } catch (InterruptedException e) {
+            }
+            value = 42;
+        }
+    }
+
+    static class Reader extends Thread {
+        int ok;
+
+        @Override
+        public void run() {
+            ok = Slow.value == 42 ? 1 : 0;
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        Reader[] readers = new Reader[4];
+        for (int i = 0; i < readers.length; i++) {
+            readers[i] = new Reader();
+            readers[i].start();
+        }
+        int ok = Slow.value == 42 ? 1 : 0;
+        for (int i = 0; i < readers.length; i++) {
+            readers[i].join();
+            ok &= readers[i].ok;
+        }
+        IO.print(ok);
+        IO.print('\n');
+    }
+}
@@ -0,0 +1,90 @@
+package ydk.test;
+
+import ydk.concurrent.CountDownLatch;
+import ydk.concurrent.LockSupport;
+import ydk.concurrent.ReentrantLock;
+import ydk.concurrent.Semaphore;
+import ydk.lang.IO;
+
+public class ConcurrentPrimitivesTest {
+    static final ReentrantLock lock = new ReentrantLock();
+    static final CountDownLatch done = new CountDownLatch(3);
+    static final Semaphore permits = new Semaphore(0);
+    // Both are guarded by lock
+    static int counter;
+    static boolean ready;
+
+    static class Worker implements Runnable {
+        @Override
+        public void run() {
+            for (int i = 0; i < 200; i++) {
+                lock.lock();
+                counter++;
+                lock.unlock();
+            }
+            permits.release();
+            done.countDown();
+        }
+    }
+
+    static class Contender implements Runnable {
+        @Override
+        public void run() {
+            try {
+                // The lock is held by main thread
+                IO.print(lock.tryLock(10) ? 0 : 1);
+            } catch (InterruptedException e) {
+                IO.print(0);
+            }
+            permits.release();
+        }
+    }
+
+    static class Parker implements Runnable {
+        @Override
+        public void run() {
+            while (!isReady()) {
+                LockSupport.park();
+            }
+            permits.release(2);
+        }
+    }
+
+    static boolean isReady() {
+        lock.lock();
+        boolean result = ready;
+        lock.unlock();
+        return result;
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        for (int i = 0; i < 3; i++) {
+            new Thread(new Worker()).start();
+        }
+        done.await();
+        IO.print(counter == 600 ? 1 : 0);
+        // Every worker has released a permit
+        permits.acquire(3);
+        IO.print(permits.tryAcquire() ? 0 : 1);
+
+        lock.lock();
+        lock.lock();
+        new Thread(new Contender()).start();
+        permits.acquire();
+        IO.print(lock.getHoldCount() == 2 ? 1 : 0);
+        lock.unlock();
+        lock.unlock();
+
+        Thread parker = new Thread(new Parker());
+        parker.start();
+        LockSupport.parkNanos(1000000);
+        lock.lock();
+        ready = true;
+        lock.unlock();
+        LockSupport.unpark(parker);
+        IO.print(permits.tryAcquire(2, 10000) ? 1 : 0);
+
+        IO.print(new CountDownLatch(1).await(10) ? 0 : 1);
+        IO.print('\n');
+    }
+}
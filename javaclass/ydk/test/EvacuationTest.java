@@ -0,0 +1,44 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class EvacuationTest {
+    static class Node {
+        Node next;
+        int value;
+    }
+
+    static Node[] keep;
+
+    static void check() throws Exception {
+        if (keep[5].next.value != 42) {
+            throw new Exception();
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        // Holders fill a live region which is never evacuated
+        keep = new Node[1100];
+        for (int i = 0; i < 1100; i++) {
+            keep[i] = new Node();
+        }
+        // The referent is placed among garbage, so it's evacuated again and
+        // again while the holder stays where it is
+        for (int i = 0; i < 2000; i++) {
+            Node node = new Node();
+            if (i == 1000) {
+                node.value = 42;
+                keep[5].next = node;
+            }
+        }
+        for (int i = 0; i < 300000; i++) {
+            Node node = new Node();
+            if (i % 4096 == 0) {
+                check();
+            }
+        }
+        check();
+        IO.print(keep[5].next.value);
+        IO.print('\n');
+    }
+}
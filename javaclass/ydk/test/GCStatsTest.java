@@ -0,0 +1,23 @@
+package ydk.test;
+
+import ydk.lang.GCStats;
+import ydk.lang.IO;
+
+public class GCStatsTest {
+    public static void main(String[] args) {
+        for (int i = 0; i < 1000; i++) {
+            Object[] unused = new Object[16];
+        }
+        long before = GCStats.getCollectionCount();
+        System.gc();
+        long after = GCStats.getCollectionCount();
+        IO.print(after > before ? 1 : 0);
+        IO.print(GCStats.getBytesReclaimed() > 0 ? 1 : 0);
+        IO.print(GCStats.getTotalPauseNanos() > 0 ? 1 : 0);
+
+        Runtime runtime = Runtime.getRuntime();
+        IO.print(runtime.freeMemory() <= runtime.totalMemory() ? 1 : 0);
+        IO.print(runtime.totalMemory() <= runtime.maxMemory() ? 1 : 0);
+        IO.print('\n');
+    }
+}
@@ -0,0 +1,25 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class HeapDumpTest {
+    static class Node {
+        Node next;
+        int value;
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        Node head = new Node();
+        for (int i = 0; i < 100; i++) {
+            Node node = new Node();
+            node.value = i;
+            node.next = head;
+            head = node;
+        }
+        // SIGQUIT sent meanwhile prints heap histogram and writes heap dump
+        // at a safepoint, where this thread is blocked in sleep
+        Thread.sleep(3000);
+        IO.print(head.value);
+        IO.print('\n');
+    }
+}
@@ -0,0 +1,22 @@
+package ydk.test;
+
+import ydk.lang.Diagnostics;
+
+public class HeapInspectionTest {
+    static class Node {
+        Node next;
+        int value;
+    }
+
+    public static void main(String[] args) {
+        Node head = new Node();
+        for (int i = 0; i < 100; i++) {
+            Node node = new Node();
+            node.value = i;
+            node.next = head;
+            head = node;
+        }
+        int[] numbers = new int[16];
+        Diagnostics.printHeapHistogram();
+    }
+}
@@ -0,0 +1,37 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class MonitorContentionTest {
+    static final Object lock = new Object();
+    static int counter;
+    static int finished;
+
+    static class Increase implements Runnable {
+        @Override
+        public void run() {
+            for (int i = 0; i < 20000; i++) {
+                synchronized (lock) {
+                    // Reentered by the owner
+                    synchronized (lock) {
+                        counter++;
+                    }
+                }
+            }
+            synchronized (lock) {
+                finished++;
+                if (finished == 4) {
+                    IO.print(counter == 80000 ? 1 : 0);
+                    IO.print('\n');
+                }
+            }
+        }
+    }
+
+    public static void main(String[] args) {
+        for (int i = 0; i < 3; i++) {
+            new Thread(new Increase()).start();
+        }
+        new Increase().run();
+    }
+}
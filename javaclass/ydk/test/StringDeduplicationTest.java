@@ -0,0 +1,27 @@
+package ydk.test;
+
+import ydk.lang.GCStats;
+import ydk.lang.IO;
+
+public class StringDeduplicationTest {
+    static String[] keep;
+
+    public static void main(String[] args) {
+        // Equal strings own their value arrays until they are deduplicated
+        keep = new String[200];
+        for (int i = 0; i < keep.length; i++) {
+            keep[i] = new String((char) ('0' + i % 10));
+        }
+        // Strings are read back after several collections, which point them
+        // to shared arrays and free the arrays left behind
+        for (int i = 0; i < 300000; i++) {
+            new Object();
+        }
+        IO.print(GCStats.getCollectionCount() >= 3 ? 1 : 0);
+        IO.print('\n');
+        for (int i = 0; i < keep.length; i++) {
+            IO.print(keep[i]);
+        }
+        IO.print('\n');
+    }
+}
@@ -0,0 +1,67 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class ThreadLifecycleTest {
+    static final Object lock = new Object();
+    static int sum;
+
+    static class Adder extends Thread {
+        private final int from;
+
+        Adder(int from) {
+            this.from = from;
+        }
+
+        @Override
+        public void run() {
+            int partial = 0;
+            for (int i = from; i < from + 100; i++) {
+                partial += i;
+            }
+            synchronized (lock) {
+                sum += partial;
+            }
+        }
+    }
+
+    static class Sleeper implements Runnable {
+        @Override
+        public void run() {
+            try {
+                Thread.sleep(100000);
+                IO.print(0);
+            } catch (InterruptedException e) {
+                IO.print(Thread.currentThread().isInterrupted() ? 0 : 1);
+            }
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        Thread main = Thread.currentThread();
+        IO.print(main == Thread.currentThread() && main.isAlive() ? 1 : 0);
+
+        Thread[] adders = new Thread[4];
+        for (int i = 0; i < adders.length; i++) {
+            adders[i] = new Adder(i * 100);
+            adders[i].start();
+        }
+        for (int i = 0; i < adders.length; i++) {
+            adders[i].join();
+        }
+        IO.print(sum == 79800 ? 1 : 0);
+        IO.print(adders[0].isAlive() ? 0 : 1);
+
+        // Timed join returns while the sleeper is still sleeping
+        Thread sleeper = new Thread(new Sleeper());
+        sleeper.start();
+        sleeper.join(10);
+        IO.print(sleeper.isAlive() ? 1 : 0);
+        sleeper.interrupt();
+        sleeper.join();
+
+        Thread.sleep(1);
+        Thread.yield();
+        IO.print('\n');
+    }
+}
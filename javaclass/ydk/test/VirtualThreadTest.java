@@ -0,0 +1,103 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class VirtualThreadTest {
+    static final Object lock = new Object();
+    static int counter;
+    static int turn;
+
+    // Virtual threads contend for the lock and give up their carriers
+    static class Counter implements Runnable {
+        @Override
+        public void run() {
+            for (int i = 0; i < 100; i++) {
+                synchronized (lock) {
+                    counter++;
+                }
+                if (i % 10 == 0) {
+                    Thread.yield();
+                }
+            }
+        }
+    }
+
+    static class Napper implements Runnable {
+        @Override
+        public void run() {
+            try {
+                Thread.sleep(1);
+            } catch (InterruptedException e) {
+                IO.print(0);
+            }
+            if (!Thread.currentThread().isVirtual()) {
+                IO.print(0);
+            }
+        }
+    }
+
+    // Two virtual threads take turns through wait and notifyAll
+    static class Player implements Runnable {
+        private final int self;
+
+        Player(int self) {
+            this.self = self;
+        }
+
+        @Override
+        public void run() {
+            for (int i = 0; i < 50; i++) {
+                synchronized (lock) {
+                    while (turn != self) {
+                        try {
+                            lock.wait();
+                        } catch (InterruptedException e) {
+                            return;
+                        }
+                    }
+                    turn = 1 - self;
+                    lock.notifyAll();
+                }
+            }
+        }
+    }
+
+    static class Sleeper implements Runnable {
+        @Override
+        public void run() {
+            try {
+                Thread.sleep(100000);
+                IO.print(0);
+            } catch (InterruptedException e) {
+                IO.print(1);
+            }
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        Thread[] threads = new Thread[1000];
+        for (int i = 0; i < threads.length; i++) {
+            Runnable task = i % 2 == 0 ? new Counter() : new Napper();
+            threads[i] = Thread.startVirtualThread(task);
+        }
+        for (int i = 0; i < threads.length; i++) {
+            threads[i].join();
+        }
+        IO.print(counter == 50000 ? 1 : 0);
+        IO.print(threads[0].isVirtual() && !Thread.currentThread().isVirtual()
+                     ? 1
+                     : 0);
+
+        Thread first = Thread.startVirtualThread(new Player(0));
+        Thread second = Thread.startVirtualThread(new Player(1));
+        first.join();
+        second.join();
+        IO.print(turn == 0 ? 1 : 0);
+
+        // Interrupt wakes up a sleeping virtual thread
+        Thread sleeper = Thread.startVirtualThread(new Sleeper());
+        sleeper.interrupt();
+        sleeper.join();
+        IO.print('\n');
+    }
+}
@@ -0,0 +1,71 @@
+package ydk.test;
+
+import ydk.lang.IO;
+
+public class WaitNotifyTest {
+    static final Object lock = new Object();
+    // Zero means there is no item
+    static int item;
+
+    static class Producer implements Runnable {
+        @Override
+        public void run() {
+            try {
+                for (int i = 1; i <= 100; i++) {
+                    synchronized (lock) {
+                        while (item != 0) {
+                            lock.wait();
+                        }
+                        item = i;
+                        lock.notifyAll();
+                    }
+                }
+            } catch (InterruptedException e) {
+                IO.print(0);
+            }
+        }
+    }
+
+    static class Sleeper implements Runnable {
+        @Override
+        public void run() {
+            try {
+                synchronized (lock) {
+                    while (true) {
+                        lock.wait();
+                    }
+                }
+            } catch (InterruptedException e) {
+                // Interrupt status is cleared by throwing the exception
+                IO.print(Thread.interrupted() ? 0 : 1);
+                IO.print('\n');
+            }
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        // Timed wait returns without being notified
+        synchronized (lock) {
+            lock.wait(10);
+        }
+        IO.print(Thread.interrupted() ? 0 : 1);
+
+        new Thread(new Producer()).start();
+        int sum = 0;
+        for (int i = 0; i < 100; i++) {
+            synchronized (lock) {
+                while (item == 0) {
+                    lock.wait();
+                }
+                sum += item;
+                item = 0;
+                lock.notifyAll();
+            }
+        }
+        IO.print(sum == 5050 ? 1 : 0);
+
+        Thread sleeper = new Thread(new Sleeper());
+        sleeper.start();
+        sleeper.interrupt();
+    }
+}
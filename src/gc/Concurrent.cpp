@@ -33,23 +33,203 @@ void ThreadPool::initialize(int startThreadNum) noexcept {
 }
 
 ThreadPool::~ThreadPool() noexcept {
-    done = true;
+    ThreadPool::finalize();
     for (thread& td : threads) {
         td.join();
     }
 }
 
+void ThreadPool::finalize() {
+    done = true;
+    taskAvailable.notifyAll();
+}
+
 void ThreadPool::runPendingWork() {
     while (!done) {
-        taskQueueMtx.lock();
-        if (!taskQueue.empty()) {
-            auto task = std::move(taskQueue.front());
-            taskQueue.pop();
-            taskQueueMtx.unlock();
+        packaged_task<void()> task;
+        if (taskQueue.tryPop(task)) {
             task();
+            continue;
+        }
+        // Check again after announcing ourselves, otherwise a task submitted
+        // in between would not wake us up
+        const uint32_t key = taskAvailable.prepareWait();
+        if (taskQueue.tryPop(task)) {
+            taskAvailable.cancelWait();
+            task();
+        } else if (done) {
+            taskAvailable.cancelWait();
+        } else {
+            taskAvailable.commitWait(key);
+        }
+    }
+}
+
+thread_local WorkStealingPool::Worker* WorkStealingPool::currentWorker =
+    nullptr;
+
+void TaskGroup::fork(Body body, void* context, size_t begin, size_t end,
+                     size_t grain) {
+    if (begin >= end) {
+        return;
+    }
+    pending.fetch_add(1, memory_order_relaxed);
+    pool.push(ForkedTask{body, context, begin, end, max<size_t>(grain, 1),
+                         this});
+}
+
+void TaskGroup::finish() {
+    if (pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+        futexWake(&pending, INT_MAX);
+    }
+}
+
+void TaskGroup::join() {
+    WorkStealingPool::Worker* self = WorkStealingPool::currentWorker;
+    if (self != nullptr && self->pool != &pool) {
+        self = nullptr;
+    }
+    ForkedTask task;
+    while (true) {
+        const uint32_t left = pending.load(memory_order_acquire);
+        if (left == 0) {
+            return;
+        }
+        // Tasks of other groups are run as well, they never block us since
+        // a task which joins helps in turn
+        if (pool.take(self, task)) {
+            WorkStealingPool::execute(task);
+        } else {
+            futexWait(&pending, left);
+        }
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() noexcept {
+    finalize();
+    for (auto& worker : workers) {
+        if (worker->nativeThread.joinable()) {
+            worker->nativeThread.join();
+        }
+    }
+}
+
+void WorkStealingPool::setMaxWorkers(int num) {
+    maxWorkers = num;
+    while (static_cast<int>(workers.size()) < maxWorkers) {
+        workers.emplace_back(new Worker());
+        workers.back()->pool = this;
+    }
+}
+
+void WorkStealingPool::setActiveWorkers(int num) {
+    {
+        lock_guard<mutex> lock(workersMtx);
+        activeWorkers = min(max(num, 1), maxWorkers);
+        for (int i = 0; i < activeWorkers; i++) {
+            if (!workers[i]->nativeThread.joinable()) {
+                workers[i]->nativeThread =
+                    thread(&WorkStealingPool::runWorker, this, i);
+            }
+        }
+    }
+    inactiveCnd.notify_all();
+    // Workers which have been deactivated leave the event count
+    workAvailable.notifyAll();
+}
+
+void WorkStealingPool::finalize() {
+    {
+        lock_guard<mutex> lock(workersMtx);
+        done = true;
+    }
+    inactiveCnd.notify_all();
+    workAvailable.notifyAll();
+}
+
+void WorkStealingPool::push(const ForkedTask& task) {
+    Worker* target = currentWorker;
+    if (target == nullptr || target->pool != this) {
+        const int active = activeWorkers;
+        if (active == 0) {
+            // No worker was ever started, run it by ourselves
+            execute(task);
+            return;
+        }
+        target = workers[nextWorker++ % active].get();
+    }
+    {
+        lock_guard<mutex> lock(target->dequeMtx);
+        target->tasks.push_back(task);
+        queued++;
+    }
+    workAvailable.notifyOne();
+}
+
+bool WorkStealingPool::take(Worker* self, ForkedTask& task) {
+    if (queued == 0) {
+        return false;
+    }
+    if (self != nullptr) {
+        lock_guard<mutex> lock(self->dequeMtx);
+        if (!self->tasks.empty()) {
+            task = self->tasks.back();
+            self->tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    for (auto& victim : workers) {
+        if (victim.get() == self) {
+            continue;
+        }
+        lock_guard<mutex> lock(victim->dequeMtx);
+        if (!victim->tasks.empty()) {
+            task = victim->tasks.front();
+            victim->tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(ForkedTask task) {
+    // Keep the lower half and leave the upper half to thieves
+    while (task.end - task.begin > task.grain) {
+        const size_t mid = task.begin + (task.end - task.begin) / 2;
+        task.group->fork(task.body, task.context, mid, task.end, task.grain);
+        task.end = mid;
+    }
+    task.body(*task.group, task.context, task.begin, task.end);
+    task.group->finish();
+}
+
+void WorkStealingPool::runWorker(int id) {
+    Worker* self = workers[id].get();
+    currentWorker = self;
+    ForkedTask task;
+    while (!done) {
+        if (id >= activeWorkers) {
+            // We may have consumed a wakeup which was meant for an active
+            // worker
+            if (queued != 0) {
+                workAvailable.notifyOne();
+            }
+            unique_lock<mutex> lock(workersMtx);
+            inactiveCnd.wait(lock,
+                             [&] { return done || id < activeWorkers; });
+            continue;
+        }
+        if (take(self, task)) {
+            execute(task);
+            continue;
+        }
+        const uint32_t key = workAvailable.prepareWait();
+        if (queued != 0 || done || id >= activeWorkers) {
+            workAvailable.cancelWait();
         } else {
-            taskQueueMtx.unlock();
-            std::this_thread::yield();
+            workAvailable.commitWait(key);
         }
     }
 }
@@ -24,11 +24,17 @@
 #ifndef YVM_CONCURRENT_H
 #define YVM_CONCURRENT_H
 #include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
+#include "../runtime/Futex.h"
 
 using namespace std;
 
@@ -50,9 +56,151 @@ private:
     std::atomic_flag flag = ATOMIC_FLAG_INIT;
 };
 
+//--------------------------------------------------------------------------------
+// Bounded multi-producer multi-consumer queue on a ring of cells. Every cell
+// has a sequence number telling whether it's ready to be written or read at a
+// position, so producers and consumers claim positions by CAS and never take
+// a lock. Capacity must be a power of two.
+//--------------------------------------------------------------------------------
+template <typename T>
+class MPMCQueue {
+public:
+    explicit MPMCQueue(size_t capacity)
+        : cells(new Cell[capacity]),
+          mask(capacity - 1),
+          enqueuePos(0),
+          dequeuePos(0) {
+        for (size_t i = 0; i < capacity; i++) {
+            cells[i].sequence.store(i, memory_order_relaxed);
+        }
+    }
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    // Return false if the queue is full
+    bool tryPush(T&& value);
+    // Return false if the queue is empty
+    bool tryPop(T& value);
+    // It's only a hint since other threads may change the queue meanwhile
+    bool empty() const {
+        return enqueuePos.load(memory_order_relaxed) ==
+               dequeuePos.load(memory_order_relaxed);
+    }
+
+private:
+    struct Cell {
+        atomic<size_t> sequence;
+        T value;
+    };
+    // Cache lines of producers and consumers are kept apart
+    static constexpr size_t CACHE_LINE = 64;
+
+    unique_ptr<Cell[]> cells;
+    const size_t mask;
+    char pad0[CACHE_LINE];
+    atomic<size_t> enqueuePos;
+    char pad1[CACHE_LINE];
+    atomic<size_t> dequeuePos;
+    char pad2[CACHE_LINE];
+};
+
+template <typename T>
+bool MPMCQueue<T>::tryPush(T&& value) {
+    size_t pos = enqueuePos.load(memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & mask];
+        const size_t sequence = cell.sequence.load(memory_order_acquire);
+        const intptr_t diff =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                 memory_order_relaxed)) {
+                cell.value = std::move(value);
+                cell.sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The cell hasn't been read since last lap
+            return false;
+        } else {
+            pos = enqueuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool MPMCQueue<T>::tryPop(T& value) {
+    size_t pos = dequeuePos.load(memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & mask];
+        const size_t sequence = cell.sequence.load(memory_order_acquire);
+        const intptr_t diff =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                                 memory_order_relaxed)) {
+                value = std::move(cell.value);
+                cell.sequence.store(pos + mask + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The cell hasn't been written in this lap
+            return false;
+        } else {
+            pos = dequeuePos.load(memory_order_relaxed);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------
+// EventCount lets threads sleep until a lock-free condition becomes true. A
+// waiter announces itself by prepareWait(), checks the condition again, then
+// either cancels or commits the wait. Notifiers bump the epoch only if there
+// are waiters, so notifying costs an atomic load when nobody sleeps, and a
+// waiter never misses a notification issued after prepareWait().
+//--------------------------------------------------------------------------------
+class EventCount {
+public:
+    EventCount() : epoch(0), waiters(0) {}
+
+    uint32_t prepareWait() {
+        waiters.fetch_add(1, memory_order_seq_cst);
+        return epoch.load(memory_order_acquire);
+    }
+    void cancelWait() { waiters.fetch_sub(1, memory_order_relaxed); }
+    // Sleep until the epoch moves on from key, it may return spuriously
+    void commitWait(uint32_t key) {
+        futexWait(&epoch, key);
+        waiters.fetch_sub(1, memory_order_relaxed);
+    }
+
+    void notifyOne() { notify(1); }
+    void notifyAll() { notify(INT_MAX); }
+
+private:
+    void notify(int count) {
+        // Pairs with prepareWait(), the condition must be visible to a waiter
+        // which is not counted here
+        atomic_thread_fence(memory_order_seq_cst);
+        if (waiters.load(memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, memory_order_release);
+            futexWake(&epoch, count);
+        }
+    }
+
+    atomic<uint32_t> epoch;
+    atomic<uint32_t> waiters;
+};
+
+//--------------------------------------------------------------------------------
+// Workers take tasks from a lock-free queue and sleep on an event count when
+// it's empty. A submitter runs the task by itself if the queue is full
+//--------------------------------------------------------------------------------
 class ThreadPool {
 public:
-    ThreadPool() : done(false) {}
+    static constexpr size_t TASK_QUEUE_CAPACITY = 1024;
+
+    ThreadPool() : done(false), taskQueue(TASK_QUEUE_CAPACITY) {}
 
     virtual ~ThreadPool() noexcept;
 
@@ -64,22 +212,158 @@ public:
     template <typename Func>
     future<void> submit(Func task);
 
-    virtual void finalize() { done = true; }
+    virtual void finalize();
 
 protected:
     atomic_bool done{};
     vector<thread> threads;
-    queue<packaged_task<void()>> taskQueue;
-    mutex taskQueueMtx;
+    MPMCQueue<packaged_task<void()>> taskQueue;
+    // Idle workers sleep on it until a task is submitted or pool is finalized
+    EventCount taskAvailable;
 };
 
 template <typename Func>
 future<void> ThreadPool::submit(Func task) {
     packaged_task<void()> pt(task);
     future<void> f = pt.get_future();
-    lock_guard<mutex> lock(taskQueueMtx);
-    taskQueue.push(std::move(pt));
+    if (taskQueue.tryPush(std::move(pt))) {
+        taskAvailable.notifyOne();
+    } else {
+        // It also throttles submitters which are much faster than workers
+        pt();
+    }
     return f;
 }
 
+class WorkStealingPool;
+
+//--------------------------------------------------------------------------------
+// A forked task is a plain record of a body and a range of indices, so forking
+// allocates nothing but room in a deque. The body may fork further tasks into
+// the group it's given.
+//--------------------------------------------------------------------------------
+class TaskGroup;
+struct ForkedTask {
+    void (*body)(TaskGroup& group, void* context, size_t begin, size_t end);
+    void* context;
+    size_t begin;
+    size_t end;
+    size_t grain;
+    TaskGroup* group;
+};
+
+//--------------------------------------------------------------------------------
+// TaskGroup is a fork/join scope. join() returns after all tasks forked into
+// the group have finished, including tasks forked by them, and the joining
+// thread runs pending tasks by itself meanwhile. A range is halved until it's
+// not longer than grain, the upper halves are forked so that idle workers can
+// steal them. A group must be joined before it goes out of scope.
+//--------------------------------------------------------------------------------
+class TaskGroup {
+public:
+    using Body = void (*)(TaskGroup& group, void* context, size_t begin,
+                          size_t end);
+
+    explicit TaskGroup(WorkStealingPool& pool) : pool(pool), pending(0) {}
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void fork(Body body, void* context, size_t begin, size_t end,
+              size_t grain = 1);
+    // Call func(begin, end) on pieces of the range, func must outlive join()
+    template <typename Func>
+    void fork(size_t begin, size_t end, size_t grain, const Func& func);
+    void join();
+
+private:
+    friend class WorkStealingPool;
+    void finish();
+
+    WorkStealingPool& pool;
+    atomic<uint32_t> pending;
+};
+
+//--------------------------------------------------------------------------------
+// Workers of a work-stealing pool have their own deques. Tasks forked by a
+// worker go to its own deque and the newest one is run first since its data
+// is likely still in cache, while an idle worker steals the oldest task of
+// another worker, which is usually the largest one. Tasks forked by other
+// threads are spread round robin over active workers. Workers are started
+// lazily, those whose id is not less than active workers park on a condition
+// variable, and idle active workers sleep on an event count.
+//--------------------------------------------------------------------------------
+class WorkStealingPool {
+public:
+    WorkStealingPool()
+        : maxWorkers(0),
+          activeWorkers(0),
+          done(false),
+          queued(0),
+          nextWorker(0) {}
+    ~WorkStealingPool() noexcept;
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // It must be called before any worker is activated
+    void setMaxWorkers(int num);
+    void setActiveWorkers(int num);
+    int getMaxWorkers() const { return maxWorkers; }
+    void finalize();
+
+    // Call func(i) for every i of the range in parallel and wait for them
+    template <typename Func>
+    void parallelFor(size_t begin, size_t end, size_t grain, const Func& func);
+
+private:
+    friend class TaskGroup;
+    struct Worker {
+        WorkStealingPool* pool;
+        mutex dequeMtx;
+        deque<ForkedTask> tasks;
+        thread nativeThread;
+    };
+
+    void push(const ForkedTask& task);
+    // Pop the newest task of our own deque or steal the oldest task of others
+    bool take(Worker* self, ForkedTask& task);
+    static void execute(ForkedTask task);
+    void runWorker(int id);
+
+    static thread_local Worker* currentWorker;
+
+    vector<unique_ptr<Worker>> workers;
+    int maxWorkers;
+    // It's changed under workersMtx
+    atomic_int activeWorkers;
+    atomic_bool done;
+    // Number of tasks in all deques, idle workers sleep only if it's zero
+    atomic<size_t> queued;
+    atomic<size_t> nextWorker;
+    EventCount workAvailable;
+    mutex workersMtx;
+    condition_variable inactiveCnd;
+};
+
+template <typename Func>
+void TaskGroup::fork(size_t begin, size_t end, size_t grain, const Func& func) {
+    fork(
+        [](TaskGroup&, void* context, size_t begin, size_t end) {
+            (*static_cast<const Func*>(context))(begin, end);
+        },
+        const_cast<Func*>(&func), begin, end, grain);
+}
+
+template <typename Func>
+void WorkStealingPool::parallelFor(size_t begin, size_t end, size_t grain,
+                                   const Func& func) {
+    auto body = [&func](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            func(i);
+        }
+    };
+    TaskGroup group(*this);
+    group.fork(begin, end, grain, body);
+    group.join();
+}
+
 #endif
@@ -28,195 +28,954 @@
 #include "../runtime/ClassSpace.h"
 #include "../runtime/JavaClass.h"
 #include "../runtime/JavaHeap.hpp"
+#include "../runtime/JavaThread.h"
+#include "../runtime/Safepoint.h"
 #include "../runtime/JavaType.h"
-#include "../vm/YVM.h"
 #include "Concurrent.hpp"
 
 using namespace std;
 
-void ConcurrentGC::stopTheWorld() {
-    unique_lock<mutex> lock(safepointWaitMtx);
-    safepointWaitCnt++;
-    while (safepointWaitCnt != YVM::executor.getThreadNum()) {
-        safepointWaitCond.wait(lock);
+// Slot of String.value, which is the only field of java/lang/String
+static const size_t STRING_VALUE_SLOT = 0;
+
+// Parallel GC threads default to the number of cores up to 8, and 5/8 of the
+// cores beyond that, while concurrent GC threads default to a quarter of them
+static int defaultParallelGCThreads() {
+    const int cores = max<int>(thread::hardware_concurrency(), 1);
+    return cores <= 8 ? cores : 8 + (cores - 8) * 5 / 8;
+}
+
+void ConcurrentGC::initialize() {
+    const int parallelThreads =
+        runtime.option.parallelGCThreads != 0
+            ? static_cast<int>(runtime.option.parallelGCThreads)
+            : defaultParallelGCThreads();
+    const int concThreads =
+        runtime.option.concGCThreads != 0
+            ? static_cast<int>(runtime.option.concGCThreads)
+            : max((parallelThreads + 2) / 4, 1);
+    gcThreadPool.setMaxWorkers(parallelThreads);
+    concThreadPool.setMaxWorkers(concThreads);
+
+    ergonomics.initialize(runtime.option, parallelThreads);
+    pretenuring.initialize(runtime.option);
+    gcThreadPool.setActiveWorkers(ergonomics.getActiveWorkers());
+    if (runtime.option.useEvacuationGC) {
+        policy = GCPolicy::GC_REGION_EVACUATION;
+        runtime.heap->enableRememberedSet();
+    }
+}
+
+void ConcurrentGC::notifyGC(GCCause cause) {
+    this->cause = cause;
+    overMemoryThreshold = true;
+    runtime.safepoint->request();
+}
+
+void ConcurrentGC::collectAtSafepoint(GCCause cause) {
+    lock_guard<mutex> lock(overMemoryThresholdMtx);
+    this->cause = cause;
+    overMemoryThreshold = true;
+}
+
+void ConcurrentGC::countAllocation(size_t bytes) {
+    ergonomics.countAllocation(bytes);
+    if (allocatedBytes.fetch_add(bytes) + bytes >= ergonomics.getThreshold()) {
+        allocatedBytes = 0;
+        notifyGC();
     }
-    safepointWaitCond.notify_all();
+}
+
+void ConcurrentGC::GCThreadPool::setActiveWorkers(int num) {
+    {
+        lock_guard<mutex> lock(workersMtx);
+        activeWorkers = min(max(num, 1), maxWorkers);
+        while (static_cast<int>(threads.size()) < activeWorkers) {
+            threads.emplace_back(&GCThreadPool::runWorker, this,
+                                 static_cast<int>(threads.size()));
+        }
+    }
+    inactiveCnd.notify_all();
+    // Workers which have been deactivated leave the event count
+    taskAvailable.notifyAll();
 }
 
 void ConcurrentGC::GCThreadPool::finalize() {
-    work = true;
-    done = true;
-    sleepCnd.notify_all();
+    {
+        lock_guard<mutex> lock(workersMtx);
+        ThreadPool::finalize();
+    }
+    inactiveCnd.notify_all();
 }
 
-void ConcurrentGC::GCThreadPool::runPendingWork() {
+void ConcurrentGC::GCThreadPool::runWorker(int id) {
     while (!done) {
-        unique_lock<mutex> lock(sleepMtx);
-        while (work != true) {
-            sleepCnd.wait(lock);
+        if (id >= activeWorkers) {
+            // We may have consumed a wakeup which was meant for an active
+            // worker
+            if (!taskQueue.empty()) {
+                taskAvailable.notifyOne();
+            }
+            unique_lock<mutex> lock(workersMtx);
+            inactiveCnd.wait(lock,
+                             [&] { return done || id < activeWorkers; });
+            continue;
         }
-
-        taskQueueMtx.lock();
-        if (!taskQueue.empty()) {
-            auto task = move(taskQueue.front());
-            taskQueue.pop();
-            taskQueueMtx.unlock();
+        packaged_task<void()> task;
+        if (taskQueue.tryPop(task)) {
+            task();
+            continue;
+        }
+        const uint32_t key = taskAvailable.prepareWait();
+        if (taskQueue.tryPop(task)) {
+            taskAvailable.cancelWait();
             task();
+        } else if (done || id >= activeWorkers) {
+            taskAvailable.cancelWait();
         } else {
-            taskQueueMtx.unlock();
+            taskAvailable.commitWait(key);
         }
     }
 }
 
-void ConcurrentGC::gc(JavaFrame* frames, GCPolicy policy) {
+void ConcurrentGC::addRoot(JType* ref) {
+    lock_guard<mutex> lock(nativeRootsMtx);
+    nativeRoots.insert(ref);
+}
+
+void ConcurrentGC::removeRoot(JType* ref) {
+    lock_guard<mutex> lock(nativeRootsMtx);
+    auto pos = nativeRoots.find(ref);
+    if (pos != nativeRoots.end()) {
+        nativeRoots.erase(pos);
+    }
+}
+
+void ConcurrentGC::gc(GCPolicy policy) {
     lock_guard<mutex> lock(overMemoryThresholdMtx);
-    this->frames = frames;
     if (!overMemoryThreshold) {
         return;
     }
+    if (runtime.option.useStringDeduplication && stringClass == nullptr) {
+        stringClass = runtime.cs->findJavaClass("java/lang/String");
+    }
+
+    cycle = GCCycle();
+    cycle.id = log.getCycleCount() + 1;
+    cycle.cause = cause;
+    cycle.timeToSafepoint = runtime.safepoint->getLastTimeToSafepoint();
+    cycle.threshold = ergonomics.getThreshold();
+    cycle.activeWorkers = ergonomics.getActiveWorkers();
+    // Explicit collections are full collections
+    sweepLongLived = !pretenuring.isEnabled() ||
+                     pretenuring.shallSweepLongLived(cycle.id) ||
+                     cause == GCCause::SYSTEM_GC;
 
     switch (policy) {
-        case GCPolicy::GC_MARK_AND_SWEEP:
-            gcThreadPool.signalWork();
-            markAndSweep();
+        case GCPolicy::GC_REGION_EVACUATION:
+            markAndEvacuate();
             break;
+        case GCPolicy::GC_MARK_AND_SWEEP:
         default:
-            gcThreadPool.signalWork();
             markAndSweep();
             break;
     }
-    objectBitmap.clear();
-    arrayBitmap.clear();
+    if (pretenuring.isEnabled()) {
+        cycle.longLivedSites = pretenuring.update();
+        cycle.longLivedBytes = longLivedBytes();
+        cycle.longLivedSwept = sweepLongLived;
+    }
+    resetRegions();
+    freeReleasedRegions();
+    allocatedBytes = 0;
     overMemoryThreshold = false;
-    gcThreadPool.signalWait();
+
+    collectionCount++;
+    totalPauseNanos += cycle.pauseTime().count();
+    if (cycle.heapBytesBefore > cycle.heapBytesAfter) {
+        bytesReclaimed += cycle.heapBytesBefore - cycle.heapBytesAfter;
+    }
+    log.record(cycle);
+    ergonomics.update(cycle);
+    gcThreadPool.setActiveWorkers(ergonomics.getActiveWorkers());
 }
 
-void ConcurrentGC::mark(JType* ref) {
+void ConcurrentGC::mark(JType* ref, TaskGroup* group) {
     if (ref == nullptr) {
         // Prevent from throwing bad_typeid since local variable table slot
         // could be empty
         return;
     }
+    // All mutator threads were stopped at safe point, so we could read heap
+    // containers directly without acquiring JavaHeap's locks
     if (typeid(*ref) == typeid(JObject)) {
-        {
-            // Mark() is very quickly and busy, so we use lightweight spin lock
-            // instead of stl mutex
-            lock_guard<SpinLock> lock(objSpin);
-            objectBitmap.insert(dynamic_cast<JObject*>(ref)->offset);
+        auto& container = runtime.heap->objectContainer;
+        auto* object = static_cast<JObject*>(ref);
+        auto* fields = container.tryFind(object->offset);
+        // Mark bit is set atomically so that a record is marked once, this
+        // also prevents us from looping forever on cyclic references
+        if (fields == nullptr ||
+            !container.mark(object->offset, sizeOfRecord(*fields))) {
+            return;
         }
-        auto fields = runtime.heap->getFields(dynamic_cast<JObject*>(ref));
-        for (size_t i = 0; i < fields.size(); i++) {
-            mark(fields[i]);
+        const bool isString = object->jc == stringClass;
+        if (isString) {
+            lock_guard<SpinLock> lock(dedupSpin);
+            dedupCandidates.push_back(object->offset);
+        }
+        // Only visit slots which may hold references according to its class
+        for (size_t slot : object->jc->getReferenceMap()) {
+            if (!(isString && slot == STRING_VALUE_SLOT)) {
+                mark((*fields)[slot], group);
+            }
         }
     } else if (typeid(*ref) == typeid(JArray)) {
-        {
-            lock_guard<SpinLock> lock(arrSpin);
-            arrayBitmap.insert(dynamic_cast<JArray*>(ref)->offset);
+        auto& container = runtime.heap->arrayContainer;
+        auto* array = static_cast<JArray*>(ref);
+        auto* items = container.tryFind(array->offset);
+        if (items == nullptr ||
+            !container.mark(array->offset, sizeOfRecord(*items))) {
+            return;
+        }
+        if (!items->hasReferences()) {
+            // Elements of primitive array can never be references
+            return;
+        }
+        if (group != nullptr && items->length > YVM_GC_MARK_SLICE) {
+            group->fork(&ConcurrentGC::markItems, items, 0, items->length,
+                        YVM_GC_MARK_SLICE);
+            return;
         }
-        auto items = runtime.heap->getElements(dynamic_cast<JArray*>(ref));
+        for (size_t i = 0; i < items->length; i++) {
+            mark(items->items[i], group);
+        }
+    }
+    // Otherwise it's a primitive value on stack slots, local slots or static
+    // fields, which is not a reference at all
+}
 
-        for (size_t i = 0; i < items.first; i++) {
-            mark(items.second[i]);
+void ConcurrentGC::markRoots(TaskGroup& group, void* roots, size_t begin,
+                             size_t end) {
+    auto& refs = *static_cast<const vector<JType*>*>(roots);
+    for (size_t i = begin; i < end; i++) {
+        runtime.gc->mark(refs[i], &group);
+    }
+}
+
+// Records are neither moved nor freed while marking, so the array stays put
+// until its slices are done
+void ConcurrentGC::markItems(TaskGroup& group, void* items, size_t begin,
+                             size_t end) {
+    auto* array = static_cast<InternalArray*>(items);
+    for (size_t i = begin; i < end; i++) {
+        runtime.gc->mark(array->items[i], &group);
+    }
+}
+
+static size_t hashChars(const InternalArray& chars) {
+    size_t hash = chars.length;
+    for (size_t i = 0; i < chars.length; i++) {
+        const auto* c = static_cast<const JInt*>(chars.items[i]);
+        hash = hash * 31 + (c != nullptr ? c->val : 0);
+    }
+    return hash;
+}
+
+static bool sameChars(const InternalArray& a, const InternalArray& b) {
+    if (a.length != b.length) {
+        return false;
+    }
+    for (size_t i = 0; i < a.length; i++) {
+        const auto* ca = static_cast<const JInt*>(a.items[i]);
+        const auto* cb = static_cast<const JInt*>(b.items[i]);
+        if ((ca != nullptr ? ca->val : 0) != (cb != nullptr ? cb->val : 0)) {
+            return false;
         }
-    } else {
-        SHOULD_NOT_REACH_HERE
     }
+    return true;
 }
 
-void ConcurrentGC::sweep() {
-    future<void> objectFuture = gcThreadPool.submit([this]() -> void {
-        for (auto pos = runtime.heap->objectContainer.data.begin();
-             pos != runtime.heap->objectContainer.data.end();) {
-            // If we can not find active object in object bitmap then clear it
-            // Notice that here we don't need to lock objectBitmap since it must
-            // be marked before sweeping
-            if (objectBitmap.find(pos->first) == objectBitmap.cend()) {
-                runtime.heap->objectContainer.data.erase(pos++);
-            } else {
-                ++pos;
+//--------------------------------------------------------------------------------
+// Strings found by marking are deduplicated by a hash table keyed on contents
+// of their value arrays. A string whose contents were seen before is pointed
+// to the array seen first, while its own array is left unmarked and freed
+// unless something else refers to it. Strings which are referenced by roots
+// directly may still be under construction, they are never deduplicated.
+//--------------------------------------------------------------------------------
+void ConcurrentGC::deduplicateStrings(const vector<vector<JType*>>& rootSets) {
+    unordered_set<size_t> rootedStrings;
+    for (auto& roots : rootSets) {
+        for (JType* ref : roots) {
+            if (typeid(*ref) == typeid(JObject) &&
+                static_cast<JObject*>(ref)->jc == stringClass) {
+                rootedStrings.insert(static_cast<JObject*>(ref)->offset);
             }
         }
-    });
+    }
+
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    unordered_multimap<size_t, size_t> table;
+    for (size_t offset : dedupCandidates) {
+        auto& fields = objects.find(offset);
+        JType* value = fields.size() > STRING_VALUE_SLOT
+                           ? fields[STRING_VALUE_SLOT]
+                           : nullptr;
+        if (value == nullptr || typeid(*value) != typeid(JArray)) {
+            continue;
+        }
+        auto* array = static_cast<JArray*>(value);
+        auto* chars = arrays.tryFind(array->offset);
+        if (chars == nullptr || chars->elementType != T_CHAR ||
+            rootedStrings.count(offset) != 0) {
+            mark(array);
+            continue;
+        }
+
+        const size_t hash = hashChars(*chars);
+        auto range = table.equal_range(hash);
+        auto pos = range.first;
+        for (; pos != range.second; ++pos) {
+            if (pos->second == array->offset ||
+                sameChars(*chars, arrays.find(pos->second))) {
+                break;
+            }
+        }
+        if (pos == range.second) {
+            table.emplace(hash, array->offset);
+        } else if (pos->second != array->offset) {
+            array->offset = pos->second;
+            runtime.heap->writeBarrier(false, offset, array);
+            cycle.stringsDeduplicated++;
+        }
+        mark(array);
+    }
+    dedupCandidates.clear();
+}
+
+// Count a record as a survivor or a death of its allocation site when it's
+// swept for the first time, and forget its site then
+template <typename Type>
+static void profileSurvival(Region<Type>* region, size_t slot) {
+    AllocationSite*& site = region->sites[slot];
+    if (site != nullptr) {
+        (region->isMarked(slot) ? site->survivors : site->deaths)++;
+        site = nullptr;
+    }
+}
+
+//--------------------------------------------------------------------------------
+// Monitors which are neither busy nor entered since the last cycle are deflated
+// by restoring lock words of their records, and recycled. Monitors carrying
+// synchronizers live as long as their records. It runs right after
+// marking, so that monitors of dead records are recycled before these records
+// are freed; a dead record whose monitor is still busy leaks its monitor.
+//--------------------------------------------------------------------------------
+template <typename Type>
+size_t ConcurrentGC::deflateMonitors(Container<Type>& container) {
+    auto& monitors = runtime.heap->monitorContainer;
+    size_t deflated = 0;
+    for (auto* region : container.regions) {
+        if (region == nullptr) {
+            continue;
+        }
+        for (size_t slot = 0; slot < YVM_GC_REGION_SLOTS; slot++) {
+            const uintptr_t word = region->lockWords[slot];
+            if (!LockWord::isInflated(word)) {
+                continue;
+            }
+            const size_t monitorId = LockWord::monitorIdOf(word);
+            auto* monitor = monitors.find(monitorId);
+            if (monitor->isBusy() ||
+                (region->isMarked(slot) &&
+                 (monitor->getSynchronizer() != nullptr ||
+                  monitor->checkEntered()))) {
+                continue;
+            }
+            region->lockWords[slot] = LockWord::UNLOCKED;
+            monitors.remove(monitorId);
+            deflated++;
+        }
+    }
+    return deflated;
+}
+
+void ConcurrentGC::deflateMonitors() {
+    if (runtime.heap->monitorContainer.size() == 0) {
+        return;
+    }
+    cycle.monitorsDeflated =
+        deflateMonitors(runtime.heap->objectContainer) +
+        deflateMonitors(runtime.heap->arrayContainer);
+}
+
+// Free unmarked records of a chunk of regions, except regions which are going
+// to be evacuated and long-lived regions out of their turn. Freed slots go to
+// free lists of their regions
+template <typename Type>
+size_t ConcurrentGC::sweepRegions(Container<Type>& container, size_t begin,
+                                  size_t end) {
+    size_t freed = 0;
+    for (size_t i = begin; i < end; i++) {
+        auto* region = container.regions[i];
+        if (region == nullptr || region->inCollectionSet ||
+            (region->longLived && !sweepLongLived)) {
+            continue;
+        }
+        for (size_t slot = 0; slot < YVM_GC_REGION_SLOTS; slot++) {
+            if (!region->used[slot]) {
+                continue;
+            }
+            profileSurvival(region, slot);
+            if (!region->isMarked(slot)) {
+                container.free(region, slot);
+                freed++;
+            }
+        }
+    }
+    return freed;
+}
+
+template <typename Type>
+size_t ConcurrentGC::sweepChunkSize(Container<Type>& container) {
+    const size_t chunkNum =
+        static_cast<size_t>(max(ergonomics.getActiveWorkers(), 1)) *
+        YVM_GC_SWEEP_CHUNKS_PER_WORKER;
+    return max<size_t>(1, (container.regions.size() + chunkNum - 1) / chunkNum);
+}
+
+//--------------------------------------------------------------------------------
+// Heap is split into chunks of regions which are swept by all active GC
+// workers in parallel. A region belongs to exactly one chunk, therefore its
+// free list is refilled without any synchronization.
+//--------------------------------------------------------------------------------
+void ConcurrentGC::sweep() {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    atomic<size_t> objectsFreed{0};
+    atomic<size_t> arraysFreed{0};
+    auto sweepObjects = [&](size_t begin, size_t end) {
+        objectsFreed += sweepRegions(objects, begin, end);
+    };
+    auto sweepArrays = [&](size_t begin, size_t end) {
+        arraysFreed += sweepRegions(arrays, begin, end);
+    };
+    TaskGroup group(gcThreadPool);
+    group.fork(0, objects.regions.size(), sweepChunkSize(objects),
+               sweepObjects);
+    group.fork(0, arrays.regions.size(), sweepChunkSize(arrays), sweepArrays);
+    group.join();
+
+    cycle.objectsFreed += objectsFreed;
+    cycle.arraysFreed += arraysFreed;
+}
+
+template <typename Type>
+static size_t usedBytesOf(const vector<Region<Type>*>& regions) {
+    size_t bytes = 0;
+    for (auto* region : regions) {
+        bytes += region != nullptr ? region->usedBytes.load() : 0;
+    }
+    return bytes;
+}
+
+size_t ConcurrentGC::heapBytes() {
+    return usedBytesOf(runtime.heap->objectContainer.regions) +
+           usedBytesOf(runtime.heap->arrayContainer.regions);
+}
+
+template <typename Type>
+static size_t longLivedBytesOf(const vector<Region<Type>*>& regions) {
+    size_t bytes = 0;
+    for (auto* region : regions) {
+        bytes += region != nullptr && region->longLived
+                     ? region->usedBytes.load()
+                     : 0;
+    }
+    return bytes;
+}
+
+size_t ConcurrentGC::longLivedBytes() {
+    return longLivedBytesOf(runtime.heap->objectContainer.regions) +
+           longLivedBytesOf(runtime.heap->arrayContainer.regions);
+}
+
+void ConcurrentGC::resetRegions() {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    for (auto* region : objects.regions) {
+        if (region != nullptr) {
+            region->clearMarks();
+        }
+    }
+    for (auto* region : arrays.regions) {
+        if (region != nullptr) {
+            region->clearMarks();
+        }
+    }
+    objects.resetAllocation();
+    arrays.resetAllocation();
+}
+
+vector<vector<JType*>> ConcurrentGC::scanRoots() {
+    auto threads = runtime.threads->getThreads();
+    // Each root scanning task fills its own root set, so no lock is needed
+    vector<vector<JType*>> rootSets(threads.size() + 2);
 
-    future<void> arrayFuture = gcThreadPool.submit([this]() -> void {
-        for (auto pos = runtime.heap->arrayContainer.data.begin();
-             pos != runtime.heap->arrayContainer.data.end();) {
-            // DITTO
-            if (arrayBitmap.find(pos->first) == arrayBitmap.cend()) {
-                for (size_t i = 0; i < pos->second.first; i++) {
-                    delete pos->second.second[i];
+    // Stack slots and local slots of all frames of every java thread, as well
+    // as its thread object, each thread is scanned by its own GC worker
+    auto scanThread = [&rootSets, &threads](size_t t) {
+        auto* roots = &rootSets[t];
+        auto* thread = threads[t];
+        if (thread->threadObject != nullptr) {
+            roots->push_back(thread->threadObject);
+        }
+        for (auto* frame = thread->frames->top(); frame != nullptr;
+             frame = frame->next) {
+            for (int i = 0; i < frame->maxStack; i++) {
+                if (frame->stackSlots[i] != nullptr) {
+                    roots->push_back(frame->stackSlots[i]);
+                }
+            }
+            for (int i = 0; i < frame->maxLocal; i++) {
+                if (frame->localSlots[i] != nullptr) {
+                    roots->push_back(frame->localSlots[i]);
                 }
-                delete[] pos->second.second;
-                runtime.heap->arrayContainer.data.erase(pos++);
-            } else {
-                ++pos;
             }
         }
-    });
+    };
 
-    future<void> monitorFuture = gcThreadPool.submit([this]() -> void {
-        // DITTO
-        for (auto pos = runtime.heap->monitorContainer.data.begin();
-             pos != runtime.heap->monitorContainer.data.end();) {
-            if (objectBitmap.find(pos->first) == objectBitmap.cend() ||
-                arrayBitmap.find(pos->first) == arrayBitmap.cend()) {
-                runtime.heap->monitorContainer.data.erase(pos++);
-            } else {
-                ++pos;
+    // Static fields of all loaded classes. Threads may still be loading
+    // classes while they are not attached yet
+    auto* staticRoots = &rootSets[threads.size()];
+    auto scanStatics = [staticRoots]() {
+        lock_guard<recursive_mutex> lock(runtime.cs->maMutex);
+        for (auto& c : runtime.cs->classTable) {
+            for (auto& staticVar : c.second->staticVars) {
+                if (staticVar.second != nullptr) {
+                    staticRoots->push_back(staticVar.second);
+                }
             }
         }
+    };
+
+    // Objects referenced by native code
+    auto* nativeRootSet = &rootSets[threads.size() + 1];
+    auto scanNativeRoots = [this, nativeRootSet]() {
+        lock_guard<mutex> lock(nativeRootsMtx);
+        nativeRootSet->assign(nativeRoots.begin(), nativeRoots.end());
+    };
+
+    gcThreadPool.parallelFor(0, rootSets.size(), 1, [&](size_t t) {
+        if (t < threads.size()) {
+            scanThread(t);
+        } else if (t == threads.size()) {
+            scanStatics();
+        } else {
+            scanNativeRoots();
+        }
     });
+    return rootSets;
+}
 
-    objectFuture.get();
-    arrayFuture.get();
-    monitorFuture.get();
+// Every root set is forked in slices, marking goes on with the records they
+// reach, so work spreads over workers even if a few roots hold most of heap
+void ConcurrentGC::markFromRoots(const vector<vector<JType*>>& rootSets) {
+    TaskGroup group(gcThreadPool);
+    for (auto& roots : rootSets) {
+        group.fork(&ConcurrentGC::markRoots,
+                   const_cast<vector<JType*>*>(&roots), 0, roots.size(),
+                   YVM_GC_MARK_SLICE);
+    }
+    group.join();
 }
 
 void ConcurrentGC::markAndSweep() {
-    vector<future<void>> stackMarkFuture, localMarkFuture;
-    auto* temp = frames->top();
-    while (temp != nullptr) {
-        stackMarkFuture.push_back(gcThreadPool.submit([this, temp]() -> void {
-            for (int i = 0; i < temp->maxStack; i++) {
-                this->mark(temp->stackSlots[i]);
-            }
-        }));
-
-        localMarkFuture.push_back(gcThreadPool.submit([this, temp]() -> void {
-            for (int i = 0; i < temp->maxLocal; i++) {
-                this->mark(temp->localSlots[i]);
-            }
-        }));
-        temp = temp->next;
-    }
-
-    future<void> staticFieldsFuture = gcThreadPool.submit([this]() -> void {
-        for (auto c : runtime.cs->classTable) {
-            for_each(c.second->staticVars.cbegin(), c.second->staticVars.cend(),
-                     [this](const pair<size_t, JType*>& offset) {
-                         if (typeid(*offset.second) == typeid(JObject)) {
-                             {
-                                 lock_guard<SpinLock> lock(objSpin);
-                                 objectBitmap.insert(offset.first);
-                             }
-                         } else if (typeid(*offset.second) == typeid(JArray)) {
-                             {
-                                 lock_guard<SpinLock> lock(arrSpin);
-                                 arrayBitmap.insert(offset.first);
-                             }
-                         }
-                     });
+    auto phaseStart = chrono::steady_clock::now();
+    auto rootSets = scanRoots();
+    auto rootScanEnd = chrono::steady_clock::now();
+    markFromRoots(rootSets);
+    deduplicateStrings(rootSets);
+    deflateMonitors();
+    auto markEnd = chrono::steady_clock::now();
+    cycle.heapBytesBefore = heapBytes();
+    sweep();
+    cycle.heapBytesAfter = heapBytes();
+    auto sweepEnd = chrono::steady_clock::now();
+
+    cycle.rootScanTime = rootScanEnd - phaseStart;
+    cycle.markTime = markEnd - rootScanEnd;
+    cycle.sweepTime = sweepEnd - markEnd;
+}
+
+//--------------------------------------------------------------------------------
+// Region evacuation picks regions with the most garbage as collection set,
+// within the pause time goal which remains after marking. Live records of
+// collection set are copied to fresh regions by GC workers in parallel, then
+// references to them are fixed through roots, remembered sets of collection
+// set and the moved records themselves, and collection set is released at
+// last. Other regions are swept as usual.
+//--------------------------------------------------------------------------------
+void ConcurrentGC::markAndEvacuate() {
+    cycle.kind = "Evacuation";
+
+    auto phaseStart = chrono::steady_clock::now();
+    auto rootSets = scanRoots();
+    auto rootScanEnd = chrono::steady_clock::now();
+    markFromRoots(rootSets);
+    deduplicateStrings(rootSets);
+    deflateMonitors();
+    auto markEnd = chrono::steady_clock::now();
+    cycle.heapBytesBefore = heapBytes();
+
+    auto budget = chrono::nanoseconds::max();
+    if (ergonomics.getPauseGoal().count() != 0) {
+        budget = ergonomics.getPauseGoal() - cycle.timeToSafepoint -
+                 chrono::duration_cast<chrono::nanoseconds>(markEnd -
+                                                            phaseStart);
+    }
+    chooseCollectionSet(budget);
+    sweep();
+    auto sweepEnd = chrono::steady_clock::now();
+
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    cycle.recordsEvacuated = evacuateRegions(objects, cycle.objectsFreed) +
+                             evacuateRegions(arrays, cycle.arraysFreed);
+    fixReferences(rootSets);
+    gcThreadPool.parallelFor(0, 2, 1, [&](size_t i) {
+        if (i == 0) {
+            pruneRememberedSets(objects);
+        } else {
+            pruneRememberedSets(arrays);
         }
     });
+    cycle.regionsEvacuated =
+        releaseCollectionSet(objects) + releaseCollectionSet(arrays);
+    auto evacuationEnd = chrono::steady_clock::now();
+    cycle.heapBytesAfter = heapBytes();
 
-    staticFieldsFuture.get();
+    cycle.rootScanTime = rootScanEnd - phaseStart;
+    cycle.markTime = markEnd - rootScanEnd;
+    cycle.sweepTime = sweepEnd - markEnd;
+    cycle.evacuationTime = evacuationEnd - sweepEnd;
+    if (cycle.recordsEvacuated != 0) {
+        const double nanos =
+            static_cast<double>(cycle.evacuationTime.count()) /
+            cycle.recordsEvacuated;
+        avgEvacuationNanos = 0.7 * avgEvacuationNanos + 0.3 * nanos;
+    }
+}
 
-    for (auto& sk : stackMarkFuture) {
-        sk.get();
+void ConcurrentGC::chooseCollectionSet(chrono::nanoseconds budget) {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+
+    struct Candidate {
+        size_t garbageBytes;
+        size_t liveCnt;
+        bool isArray;
+        size_t index;
+    };
+    vector<Candidate> candidates;
+    auto worthEvacuating = [](size_t garbageBytes, size_t usedBytes) {
+        return garbageBytes * 100 >=
+               usedBytes * YVM_GC_EVACUATION_GARBAGE_PERCENT;
+    };
+    // Garbage of long-lived regions is left until their sweeping turn
+    auto skipped = [this](const auto* region) {
+        return region == nullptr || (region->longLived && !sweepLongLived);
+    };
+    for (auto* region : objects.regions) {
+        if (skipped(region) ||
+            !worthEvacuating(region->garbageBytes(), region->usedBytes)) {
+            continue;
+        }
+        candidates.push_back(
+            {region->garbageBytes(), region->liveCnt, false, region->index});
     }
-    for (auto& lv : localMarkFuture) {
-        lv.get();
+    for (auto* region : arrays.regions) {
+        if (skipped(region) ||
+            !worthEvacuating(region->garbageBytes(), region->usedBytes)) {
+            continue;
+        }
+        candidates.push_back(
+            {region->garbageBytes(), region->liveCnt, true, region->index});
     }
+    stable_sort(candidates.begin(), candidates.end(),
+                [](const Candidate& a, const Candidate& b) {
+                    return a.garbageBytes > b.garbageBytes;
+                });
 
-    sweep();
+    // Regions without live records are free to evacuate, other regions are
+    // chosen as long as their predicted copying cost fits into budget
+    double predictedNanos = 0;
+    for (const auto& c : candidates) {
+        const double nanos = c.liveCnt * avgEvacuationNanos;
+        if (c.liveCnt != 0 && predictedNanos + nanos > budget.count()) {
+            continue;
+        }
+        predictedNanos += nanos;
+        if (c.isArray) {
+            arrays.regions[c.index]->inCollectionSet = true;
+            arrays.regions[c.index]->forwarding.reset(
+                new size_t[YVM_GC_REGION_SLOTS]());
+        } else {
+            objects.regions[c.index]->inCollectionSet = true;
+            objects.regions[c.index]->forwarding.reset(
+                new size_t[YVM_GC_REGION_SLOTS]());
+        }
+    }
+}
+
+template <typename Type>
+size_t ConcurrentGC::evacuateRegions(Container<Type>& container,
+                                     size_t& freed) {
+    vector<Region<Type>*> collectionSet;
+    // Live records stay in their own space, so destinations are claimed for
+    // short-lived space and long-lived space respectively
+    size_t liveCnt[2] = {0, 0};
+    for (auto* region : container.regions) {
+        if (region != nullptr && region->inCollectionSet) {
+            collectionSet.push_back(region);
+            liveCnt[region->longLived] += region->liveCnt;
+        }
+    }
+    if (collectionSet.empty()) {
+        return 0;
+    }
+
+    // Every task fills its own destination regions, so at most one region
+    // of each task and space is left partially filled
+    const size_t taskNum =
+        min(collectionSet.size(),
+            static_cast<size_t>(max(ergonomics.getActiveWorkers(), 1)));
+    vector<Region<Type>*> destinations[2];
+    for (int space = 0; space < 2; space++) {
+        if (liveCnt[space] == 0) {
+            continue;
+        }
+        const size_t destinationNum =
+            (liveCnt[space] + YVM_GC_REGION_SLOTS - 1) / YVM_GC_REGION_SLOTS +
+            taskNum;
+        for (size_t i = 0; i < destinationNum; i++) {
+            destinations[space].push_back(container.claimRegion(space == 1));
+        }
+    }
+
+    atomic<size_t> nextDestination[2];
+    nextDestination[0] = nextDestination[1] = 0;
+    atomic<size_t> moved{0};
+    atomic<size_t> dead{0};
+    gcThreadPool.parallelFor(0, taskNum, 1, [&](size_t t) {
+        Region<Type>* destination[2] = {nullptr, nullptr};
+        size_t taskMoved = 0, taskDead = 0;
+        for (size_t i = t; i < collectionSet.size(); i += taskNum) {
+            auto* region = collectionSet[i];
+            const int space = region->longLived;
+            for (size_t slot = 0; slot < YVM_GC_REGION_SLOTS; slot++) {
+                if (!region->used[slot]) {
+                    continue;
+                }
+                profileSurvival(region, slot);
+                if (!region->isMarked(slot)) {
+                    container.free(region, slot);
+                    taskDead++;
+                    continue;
+                }
+                if (destination[space] == nullptr ||
+                    destination[space]->freeSlots.empty()) {
+                    destination[space] =
+                        destinations[space][nextDestination[space]++];
+                }
+                region->forwarding[slot] =
+                    container.move(region, slot, destination[space]);
+                taskMoved++;
+            }
+        }
+        moved += taskMoved;
+        dead += taskDead;
+    });
+    freed += dead;
+    return moved;
+}
+
+void ConcurrentGC::fixReference(JType* ref) {
+    if (ref == nullptr) {
+        return;
+    }
+    if (typeid(*ref) == typeid(JObject)) {
+        auto* object = static_cast<JObject*>(ref);
+        object->offset = runtime.heap->objectContainer.forward(object->offset);
+    } else if (typeid(*ref) == typeid(JArray)) {
+        auto* array = static_cast<JArray*>(ref);
+        array->offset = runtime.heap->arrayContainer.forward(array->offset);
+    }
+}
+
+// Remembered sets only know the old offset of a moved holder, and holders
+// outside collection set are not remembered by destination regions their
+// references were forwarded into. Both are remembered again here, otherwise
+// they would not be fixed when destination regions are evacuated later
+void ConcurrentGC::fixObject(size_t offset) {
+    auto* fields = runtime.heap->objectContainer.tryFind(offset);
+    if (fields == nullptr) {
+        // Holder was dead or evacuated
+        return;
+    }
+    // Class of holder is unknown here, but field values are typed anyway
+    for (JType* value : *fields) {
+        fixReference(value);
+        runtime.heap->writeBarrier(false, offset, value);
+    }
+}
+
+void ConcurrentGC::fixArray(size_t offset) {
+    auto* items = runtime.heap->arrayContainer.tryFind(offset);
+    if (items == nullptr || !items->hasReferences()) {
+        return;
+    }
+    for (size_t i = 0; i < items->length; i++) {
+        fixReference(items->items[i]);
+        runtime.heap->writeBarrier(true, offset, items->items[i]);
+    }
+}
+
+void ConcurrentGC::fixReferences(const vector<vector<JType*>>& rootSets) {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+
+    // Holders outside collection set are found in remembered sets, while
+    // evacuated records are found by forwarding tables
+    vector<size_t> objectHolders, arrayHolders, movedObjects, movedArrays;
+    auto collect = [](auto& container, vector<size_t>& objectHolders,
+                      vector<size_t>& arrayHolders, vector<size_t>& moved) {
+        for (auto* region : container.regions) {
+            if (region == nullptr || !region->inCollectionSet) {
+                continue;
+            }
+            objectHolders.insert(objectHolders.end(),
+                                 region->rememberedObjects.begin(),
+                                 region->rememberedObjects.end());
+            arrayHolders.insert(arrayHolders.end(),
+                                region->rememberedArrays.begin(),
+                                region->rememberedArrays.end());
+            for (size_t slot = 0; slot < YVM_GC_REGION_SLOTS; slot++) {
+                if (region->forwarding[slot] != 0) {
+                    moved.push_back(region->forwarding[slot]);
+                }
+            }
+        }
+    };
+    collect(objects, objectHolders, arrayHolders, movedObjects);
+    collect(arrays, objectHolders, arrayHolders, movedArrays);
+    for (auto* holders : {&objectHolders, &arrayHolders}) {
+        sort(holders->begin(), holders->end());
+        holders->erase(unique(holders->begin(), holders->end()),
+                       holders->end());
+    }
+
+    // Fixing a reference is idempotent, so shared handles of references are
+    // harmless to be visited by several tasks
+    auto fixRoots = [this, &rootSets](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (JType* ref : rootSets[i]) {
+                this->fixReference(ref);
+            }
+        }
+    };
+    auto fixChunk = [this](const vector<size_t>& offsets, bool isArray,
+                           size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (isArray) {
+                this->fixArray(offsets[i]);
+            } else {
+                this->fixObject(offsets[i]);
+            }
+        }
+    };
+    auto fixObjectHolders = [&](size_t begin, size_t end) {
+        fixChunk(objectHolders, false, begin, end);
+    };
+    auto fixArrayHolders = [&](size_t begin, size_t end) {
+        fixChunk(arrayHolders, true, begin, end);
+    };
+    auto fixMovedObjects = [&](size_t begin, size_t end) {
+        fixChunk(movedObjects, false, begin, end);
+    };
+    auto fixMovedArrays = [&](size_t begin, size_t end) {
+        fixChunk(movedArrays, true, begin, end);
+    };
+    const size_t chunkSize = YVM_GC_REGION_SLOTS;
+    TaskGroup group(gcThreadPool);
+    group.fork(0, rootSets.size(), 1, fixRoots);
+    group.fork(0, objectHolders.size(), chunkSize, fixObjectHolders);
+    group.fork(0, arrayHolders.size(), chunkSize, fixArrayHolders);
+    group.fork(0, movedObjects.size(), chunkSize, fixMovedObjects);
+    group.fork(0, movedArrays.size(), chunkSize, fixMovedArrays);
+    group.join();
+}
+
+// Drop holders which were dead or evacuated from remembered sets of surviving
+// regions, evacuated holders have been remembered by their new offsets
+template <typename Type>
+void ConcurrentGC::pruneRememberedSets(Container<Type>& container) {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    for (auto* region : container.regions) {
+        if (region == nullptr || region->inCollectionSet) {
+            continue;
+        }
+        lock_guard<SpinLock> lock(region->rememberedSetSpin);
+        for (auto pos = region->rememberedObjects.begin();
+             pos != region->rememberedObjects.end();) {
+            if (objects.has(*pos)) {
+                ++pos;
+            } else {
+                pos = region->rememberedObjects.erase(pos);
+            }
+        }
+        for (auto pos = region->rememberedArrays.begin();
+             pos != region->rememberedArrays.end();) {
+            if (arrays.has(*pos)) {
+                ++pos;
+            } else {
+                pos = region->rememberedArrays.erase(pos);
+            }
+        }
+    }
+}
+
+void ConcurrentGC::freeReleasedRegions() {
+    auto& objects = runtime.heap->objectContainer;
+    auto& arrays = runtime.heap->arrayContainer;
+    if (objects.releasedRegions.empty() && arrays.releasedRegions.empty()) {
+        return;
+    }
+    // Concurrent workers are started at the first time they are needed
+    concThreadPool.setActiveWorkers(concThreadPool.getMaxWorkers());
+    concThreadPool.submit(
+        [objectRegions = move(objects.releasedRegions),
+         arrayRegions = move(arrays.releasedRegions)]() -> void {
+            for (auto* region : objectRegions) {
+                delete region;
+            }
+            for (auto* region : arrayRegions) {
+                delete region;
+            }
+        });
+    objects.releasedRegions.clear();
+    arrays.releasedRegions.clear();
+}
+
+template <typename Type>
+size_t ConcurrentGC::releaseCollectionSet(Container<Type>& container) {
+    size_t released = 0;
+    for (auto* region : container.regions) {
+        if (region != nullptr && region->inCollectionSet) {
+            container.releaseRegion(region);
+            released++;
+        }
+    }
+    return released;
 }
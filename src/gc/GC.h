@@ -24,70 +24,179 @@
 #ifndef _YVM_GC_H
 #define _YVM_GC_H
 
+#include <algorithm>
 #include <memory>
 #include <unordered_set>
 #include "Concurrent.hpp"
+#include "GCErgonomics.h"
+#include "GCLog.h"
+#include "Pretenuring.h"
 #include "../misc/Option.h"
 #include "../runtime/RuntimeEnv.h"
 
 using namespace std;
 
 struct JType;
-
-enum class GCPolicy { GC_MARK_AND_SWEEP };
+class JavaClass;
+template <typename Type>
+class Container;
+
+//--------------------------------------------------------------------------------
+// Both policies mark live records from roots with the world stopped. Mark and
+// sweep frees dead records in place, while region evacuation additionally
+// copies live records out of regions with the most garbage and then releases
+// these regions, so that heap is compacted incrementally.
+//--------------------------------------------------------------------------------
+enum class GCPolicy { GC_MARK_AND_SWEEP, GC_REGION_EVACUATION };
 class ConcurrentGC {
+    friend class HeapInspector;
+
 public:
-    ConcurrentGC() : overMemoryThreshold(false), safepointWaitCnt(0) {
-        gcThreadPool.initialize(thread::hardware_concurrency());
-    }
+    ConcurrentGC()
+        : overMemoryThreshold(false),
+          cause(GCCause::ALLOCATION_THRESHOLD),
+          policy(GCPolicy::GC_MARK_AND_SWEEP) {}
+
+    // Apply GC options after command line arguments were parsed
+    void initialize();
 
     bool shallGC() const { return overMemoryThreshold; }
-    void notifyGC() {
-        safepointWaitCnt = 0;
-        overMemoryThreshold = true;
+    void notifyGC(GCCause cause = GCCause::ALLOCATION_THRESHOLD);
+    // Let the collection run at the current safepoint, it's called by VM
+    // operations such as System.gc(), which wait until the cycle is done
+    void collectAtSafepoint(GCCause cause);
+    // Heap records report their bytes once they are placed in regions, since
+    // region storage is allocated in bulk
+    void countAllocation(size_t bytes);
+    // Should only be called by safepoint coordinator when world was stopped
+    void gc(GCPolicy policy = GCPolicy::GC_MARK_AND_SWEEP);
+
+    // Objects which are merely referenced by native code are invisible to
+    // garbage collector, natives should register them as roots explicitly
+    void addRoot(JType* ref);
+    void removeRoot(JType* ref);
+
+    void terminateGC() {
+        gcThreadPool.finalize();
+        concThreadPool.finalize();
     }
-    void stopTheWorld();
-    void gc(JavaFrame* frames, GCPolicy policy = GCPolicy::GC_MARK_AND_SWEEP);
 
-    void terminateGC() { gcThreadPool.finalize(); }
+    GCLog& getLog() { return log; }
+    GCErgonomics& getErgonomics() { return ergonomics; }
+    PretenuringPolicy& getPretenuring() { return pretenuring; }
+    GCPolicy getPolicy() const { return policy; }
+
+    // Cumulative statistics, which can be read by java code at any time
+    size_t getCollectionCount() const { return collectionCount; }
+    size_t getTotalPauseNanos() const { return totalPauseNanos; }
+    size_t getBytesReclaimed() const { return bytesReclaimed; }
+    // Bytes which can be allocated before the next collection is triggered
+    size_t getBytesUntilGC() const {
+        const size_t threshold = ergonomics.getThreshold();
+        const size_t allocated = allocatedBytes;
+        return threshold > allocated ? threshold - allocated : 0;
+    }
 
 private:
-    inline void pushObjectBitmap(size_t offset) { objectBitmap.insert(offset); }
-
     void markAndSweep();
-    void mark(JType* ref);
+    void markAndEvacuate();
+    vector<vector<JType*>> scanRoots();
+    void markFromRoots(const vector<vector<JType*>>& rootSets);
+    // Elements of long reference arrays are forked into the group if it's
+    // given, so that idle GC workers can steal them
+    void mark(JType* ref, TaskGroup* group = nullptr);
+    static void markRoots(TaskGroup& group, void* roots, size_t begin,
+                          size_t end);
+    static void markItems(TaskGroup& group, void* items, size_t begin,
+                          size_t end);
+    void deduplicateStrings(const vector<vector<JType*>>& rootSets);
+    void deflateMonitors();
+    template <typename Type>
+    size_t deflateMonitors(Container<Type>& container);
     void sweep();
-    unordered_set<size_t> objectBitmap;
-    SpinLock objSpin;
+    template <typename Type>
+    size_t sweepRegions(Container<Type>& container, size_t begin, size_t end);
+    template <typename Type>
+    size_t sweepChunkSize(Container<Type>& container);
+    size_t heapBytes();
+    size_t longLivedBytes();
+    // Clear marks and let mutators allocate in regions with free slots
+    void resetRegions();
+
+    void chooseCollectionSet(chrono::nanoseconds budget);
+    template <typename Type>
+    size_t evacuateRegions(Container<Type>& container, size_t& freed);
+    void fixReferences(const vector<vector<JType*>>& rootSets);
+    void fixReference(JType* ref);
+    // Forward references of the holder and record it in remembered sets of
+    // regions they now point into
+    void fixObject(size_t offset);
+    void fixArray(size_t offset);
+    template <typename Type>
+    void pruneRememberedSets(Container<Type>& container);
+    template <typename Type>
+    size_t releaseCollectionSet(Container<Type>& container);
+    // Released regions are freed by concurrent workers out of GC pause
+    void freeReleasedRegions();
 
-    unordered_set<size_t> arrayBitmap;
-    SpinLock arrSpin;
     atomic_bool overMemoryThreshold;
     mutex overMemoryThresholdMtx;
-
-    int safepointWaitCnt;
-    mutex safepointWaitMtx;
-    condition_variable safepointWaitCond;
+    atomic<size_t> allocatedBytes{0};
+    atomic<size_t> collectionCount{0};
+    atomic<size_t> totalPauseNanos{0};
+    atomic<size_t> bytesReclaimed{0};
+
+    atomic<GCCause> cause;
+    GCPolicy policy;
+    // Predicted cost of evacuating a live record, which is used to fit
+    // collection set into pause time goal
+    double avgEvacuationNanos = 1000.0;
+    GCCycle cycle;
+    GCLog log;
+    GCErgonomics ergonomics;
+    PretenuringPolicy pretenuring;
+    // Regions of long-lived space are neither swept nor evacuated unless it's
+    // set, which is decided at the beginning of every cycle
+    bool sweepLongLived = true;
+
+    unordered_multiset<JType*> nativeRoots;
+    mutex nativeRootsMtx;
+
+    // Strings whose value arrays are left unmarked until deduplication, which
+    // is enabled only if string class is known
+    const JavaClass* stringClass = nullptr;
+    vector<size_t> dedupCandidates;
+    SpinLock dedupSpin;
 
 private:
+    //--------------------------------------------------------------------------------
+    // Concurrent workers are started lazily when they are activated for the
+    // first time. Workers whose id is not less than active workers park on
+    // their own condition variable, while idle active workers sleep on the
+    // event count of task queue, so that idle workers never spin.
+    //--------------------------------------------------------------------------------
     struct GCThreadPool : ThreadPool {
-        GCThreadPool() : ThreadPool(), work(false) {}
+        GCThreadPool() : ThreadPool(), maxWorkers(0), activeWorkers(0) {}
+        ~GCThreadPool() override { finalize(); }
 
-        void signalWork() {
-            work = true;
-            sleepCnd.notify_all();
-        }
-        void signalWait() { work = false; }
+        void setMaxWorkers(int num) { maxWorkers = num; }
+        void setActiveWorkers(int num);
+        int getMaxWorkers() const { return maxWorkers; }
 
         void finalize() override;
-        void runPendingWork() override;
+        void runWorker(int id);
 
-        atomic_bool work;
-        mutex sleepMtx;
-        condition_variable sleepCnd;
+        int maxWorkers;
+        // It's changed under workersMtx
+        atomic_int activeWorkers;
+        mutex workersMtx;
+        condition_variable inactiveCnd;
     };
-    JavaFrame* frames;
-    GCThreadPool gcThreadPool;
+    // Parallel workers fork and steal tasks within GC pauses, while
+    // concurrent workers run background tasks alongside mutators, e.g.
+    // freeing released regions
+    WorkStealingPool gcThreadPool;
+    GCThreadPool concThreadPool;
 };
 
 class GC;
@@ -109,7 +218,8 @@ struct HeapAllocator {
         if (n > size_t(-1) / sizeof(T)) throw bad_alloc();
         if (auto p = static_cast<T*>(malloc(n * sizeof(T)))) {
             thresholdVal += n * sizeof(T);
-            if (thresholdVal >= YVM_GC_THRESHOLD_VALUE) {
+            runtime.gc->getErgonomics().countAllocation(n * sizeof(T));
+            if (thresholdVal >= runtime.gc->getErgonomics().getThreshold()) {
                 runtime.gc->notifyGC();
                 thresholdVal = 0;
             }
@@ -117,9 +227,11 @@ struct HeapAllocator {
         }
         throw bad_alloc();
     }
-    void deallocate(T* p, size_t val) noexcept {
+    void deallocate(T* p, size_t n) noexcept {
         free(p);
-        thresholdVal -= val;
+        // Counter was reset when GC was triggered, so it may be less than
+        // bytes being freed
+        thresholdVal -= min(thresholdVal, n * sizeof(T));
     }
 
 private:
@@ -0,0 +1,101 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "GCErgonomics.h"
+#include <algorithm>
+#include "../misc/Option.h"
+
+// Weight of the newest sample of moving averages
+static const double SAMPLE_WEIGHT = 0.3;
+// Heap bytes which one GC worker is responsible for when there is no goal
+static const size_t HEAP_BYTES_PER_WORKER = 1024 * 1024;
+
+static double average(double avg, double sample, bool first) {
+    return first ? sample : avg * (1 - SAMPLE_WEIGHT) + sample * SAMPLE_WEIGHT;
+}
+
+GCErgonomics::GCErgonomics()
+    : pauseGoal(0),
+      gcTimeRatio(YVM_GC_TIME_RATIO),
+      minThreshold(YVM_GC_THRESHOLD_VALUE),
+      maxThreshold(YVM_GC_MAX_THRESHOLD_VALUE),
+      maxWorkers(1),
+      threshold(YVM_GC_THRESHOLD_VALUE),
+      activeWorkers(1),
+      allocatedBytes(0),
+      lastAllocatedBytes(0),
+      lastCycleEnd(chrono::steady_clock::now()),
+      avgPauseNanos(0),
+      avgAllocationRate(0) {}
+
+void GCErgonomics::initialize(const VMOption& option, int maxWorkers) {
+    pauseGoal = chrono::milliseconds(option.maxGCPauseMillis);
+    gcTimeRatio = option.gcTimeRatio;
+    maxThreshold = max(option.maxGCThreshold, option.initialGCThreshold);
+    threshold = option.initialGCThreshold;
+    // Pause goal is allowed to shrink threshold below its initial value
+    minThreshold = max<size_t>(option.initialGCThreshold / 8, 1);
+    this->maxWorkers = max(maxWorkers, 1);
+    // Heap is empty at startup, more workers are activated as it grows
+    activeWorkers = 1;
+}
+
+void GCErgonomics::update(const GCCycle& cycle) {
+    const auto now = chrono::steady_clock::now();
+    const bool first = cycle.id == 1;
+    const double pause = (cycle.timeToSafepoint + cycle.pauseTime()).count();
+    const double interval =
+        max<double>((now - lastCycleEnd).count() - pause, 1);
+    const size_t allocated = allocatedBytes - lastAllocatedBytes;
+    lastAllocatedBytes = allocatedBytes;
+    lastCycleEnd = now;
+
+    avgPauseNanos = average(avgPauseNanos, pause, first);
+    avgAllocationRate = average(avgAllocationRate, allocated / interval, first);
+
+    double newThreshold = threshold;
+    int newWorkers = activeWorkers;
+    if (pauseGoal.count() > 0) {
+        const double goal = pauseGoal.count();
+        if (pause > goal) {
+            newThreshold *= max(0.5, goal / pause);
+            newWorkers++;
+        } else if (pause < goal / 4) {
+            newWorkers--;
+        }
+    } else {
+        newWorkers = static_cast<int>(cycle.heapBytesBefore /
+                                      HEAP_BYTES_PER_WORKER) + 1;
+    }
+
+    // Keep GC time ratio only when pause goal isn't violated
+    if (pauseGoal.count() == 0 || pause <= pauseGoal.count()) {
+        const double wanted = avgAllocationRate * avgPauseNanos * gcTimeRatio;
+        newThreshold = max(newThreshold, wanted);
+    }
+
+    threshold = static_cast<size_t>(
+        min<double>(max<double>(newThreshold, minThreshold), maxThreshold));
+    activeWorkers = min(max(newWorkers, 1), maxWorkers);
+}
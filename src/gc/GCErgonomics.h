@@ -0,0 +1,82 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef YVM_GCERGONOMICS_H
+#define YVM_GCERGONOMICS_H
+
+#include <atomic>
+#include <chrono>
+#include "GCLog.h"
+
+struct VMOption;
+
+//--------------------------------------------------------------------------------
+// GC ergonomics adapts GC threshold and the number of active GC workers from
+// measured pause time and allocation rate after every cycle:
+//  - If pause exceeds the pause goal, threshold shrinks in proportion and one
+//    more worker is activated
+//  - If pause is far below the goal, a worker is given back
+//  - Threshold grows to the bytes allocated within pause * GCTimeRatio at the
+//    recent allocation rate, so that GC time stays below 1/(1+GCTimeRatio),
+//    as long as the pause goal is kept
+// Without a pause goal, the number of workers follows the heap size.
+//--------------------------------------------------------------------------------
+class GCErgonomics {
+public:
+    GCErgonomics();
+
+    void initialize(const VMOption& option, int maxWorkers);
+
+    size_t getThreshold() const { return threshold; }
+    // Zero means there is no pause time goal
+    chrono::nanoseconds getPauseGoal() const { return pauseGoal; }
+    int getActiveWorkers() const { return activeWorkers; }
+
+    // Heap allocator reports allocated bytes to estimate allocation rate
+    void countAllocation(size_t bytes) {
+        allocatedBytes.fetch_add(bytes, memory_order_relaxed);
+    }
+
+    void update(const GCCycle& cycle);
+
+private:
+    chrono::nanoseconds pauseGoal;
+    size_t gcTimeRatio;
+    size_t minThreshold;
+    size_t maxThreshold;
+    int maxWorkers;
+
+    atomic<size_t> threshold;
+    atomic_int activeWorkers;
+
+    atomic<size_t> allocatedBytes;
+    size_t lastAllocatedBytes;
+    chrono::steady_clock::time_point lastCycleEnd;
+
+    // Exponentially weighted moving averages
+    double avgPauseNanos;
+    double avgAllocationRate;  // bytes per nanosecond
+};
+
+#endif  // YVM_GCERGONOMICS_H
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "GCLog.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "../runtime/RuntimeEnv.h"
+
+const char* getGCCauseName(GCCause cause) {
+    switch (cause) {
+        case GCCause::ALLOCATION_THRESHOLD:
+            return "Allocation Threshold";
+        case GCCause::SYSTEM_GC:
+            return "System.gc()";
+    }
+    return "Unknown";
+}
+
+static double toMillis(chrono::nanoseconds t) { return t.count() / 1e6; }
+
+void GCLog::record(const GCCycle& cycle) {
+    lock_guard<mutex> lock(logMtx);
+    pauses.push_back(cycle.pauseTime());
+
+    if (!runtime.option.verboseGC) {
+        return;
+    }
+    char dedup[64] = "";
+    if (cycle.stringsDeduplicated != 0) {
+        snprintf(dedup, sizeof(dedup), ", dedup %zu strings",
+                 cycle.stringsDeduplicated);
+    }
+    char monitors[64] = "";
+    if (cycle.monitorsDeflated != 0) {
+        snprintf(monitors, sizeof(monitors), ", deflate %zu monitors",
+                 cycle.monitorsDeflated);
+    }
+    char evacuation[128] = "";
+    if (cycle.regionsEvacuated != 0) {
+        snprintf(evacuation, sizeof(evacuation),
+                 ", evacuate %.3fms (%zu regions, %zu records)",
+                 toMillis(cycle.evacuationTime), cycle.regionsEvacuated,
+                 cycle.recordsEvacuated);
+    }
+    char longLived[96] = "";
+    if (runtime.option.useAllocationSitePretenuring) {
+        snprintf(longLived, sizeof(longLived),
+                 ", long-lived %zuK of %zu sites (%s)",
+                 cycle.longLivedBytes / 1024, cycle.longLivedSites,
+                 cycle.longLivedSwept ? "swept" : "skipped");
+    }
+    fprintf(stderr,
+            "[gc #%zu] Pause %s (%s) %zuK->%zuK, freed %zu objects "
+            "%zu arrays%s%s, safepoint %.3fms, roots %.3fms, mark %.3fms, "
+            "sweep %.3fms%s%s, pause %.3fms, threshold %zuK, workers %d\n",
+            cycle.id, cycle.kind, getGCCauseName(cycle.cause),
+            cycle.heapBytesBefore / 1024, cycle.heapBytesAfter / 1024,
+            cycle.objectsFreed, cycle.arraysFreed, dedup, monitors,
+            toMillis(cycle.timeToSafepoint), toMillis(cycle.rootScanTime),
+            toMillis(cycle.markTime), toMillis(cycle.sweepTime), evacuation,
+            longLived, toMillis(cycle.pauseTime()), cycle.threshold / 1024,
+            cycle.activeWorkers);
+}
+
+void GCLog::printSummary() {
+    lock_guard<mutex> lock(logMtx);
+    if (!runtime.option.verboseGC) {
+        return;
+    }
+
+    auto elapsed = chrono::steady_clock::now() - startTime;
+    chrono::nanoseconds total{0};
+    for (auto p : pauses) {
+        total += p;
+    }
+    fprintf(stderr, "[gc] %zu collections, total pause %.3fms (%.2f%% of %.3fms)\n",
+            pauses.size(), toMillis(total),
+            elapsed.count() == 0 ? 0.0 : 100.0 * total.count() / elapsed.count(),
+            toMillis(chrono::duration_cast<chrono::nanoseconds>(elapsed)));
+    if (pauses.empty()) {
+        return;
+    }
+
+    // Nearest-rank percentiles
+    vector<chrono::nanoseconds> sorted(pauses);
+    sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        auto rank = static_cast<size_t>(ceil(p * sorted.size()));
+        return sorted[max<size_t>(rank, 1) - 1];
+    };
+    fprintf(stderr, "[gc] pause p50 %.3fms, p99 %.3fms, max %.3fms\n",
+            toMillis(percentile(0.50)), toMillis(percentile(0.99)),
+            toMillis(sorted.back()));
+}
+
+size_t GCLog::getCycleCount() {
+    lock_guard<mutex> lock(logMtx);
+    return pauses.size();
+}
@@ -0,0 +1,94 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef YVM_GCLOG_H
+#define YVM_GCLOG_H
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+enum class GCCause { ALLOCATION_THRESHOLD, SYSTEM_GC };
+
+const char* getGCCauseName(GCCause cause);
+
+//--------------------------------------------------------------------------------
+// Statistics of a single garbage collection cycle. Heap bytes are estimated by
+// headers and slots of all objects and arrays.
+//--------------------------------------------------------------------------------
+struct GCCycle {
+    size_t id = 0;
+    GCCause cause = GCCause::ALLOCATION_THRESHOLD;
+    const char* kind = "Mark-Sweep";
+
+    chrono::nanoseconds timeToSafepoint{0};
+    chrono::nanoseconds rootScanTime{0};
+    chrono::nanoseconds markTime{0};
+    chrono::nanoseconds sweepTime{0};
+    chrono::nanoseconds evacuationTime{0};
+
+    size_t heapBytesBefore = 0;
+    size_t heapBytesAfter = 0;
+    size_t objectsFreed = 0;
+    size_t arraysFreed = 0;
+    size_t stringsDeduplicated = 0;
+    size_t monitorsDeflated = 0;
+    size_t regionsEvacuated = 0;
+    size_t recordsEvacuated = 0;
+    // Only reported if pretenuring is enabled
+    size_t longLivedSites = 0;
+    size_t longLivedBytes = 0;
+    bool longLivedSwept = false;
+
+    size_t threshold = 0;
+    int activeWorkers = 0;
+
+    chrono::nanoseconds pauseTime() const {
+        return rootScanTime + markTime + sweepTime + evacuationTime;
+    }
+};
+
+//--------------------------------------------------------------------------------
+// GC log records every collection cycle. Each cycle is printed to stderr when
+// -verbose:gc is specified, and a summary of pause time distribution is
+// printed when virtual machine exits.
+//--------------------------------------------------------------------------------
+class GCLog {
+public:
+    GCLog() : startTime(chrono::steady_clock::now()) {}
+
+    void record(const GCCycle& cycle);
+    void printSummary();
+
+    size_t getCycleCount();
+
+private:
+    chrono::steady_clock::time_point startTime;
+    vector<chrono::nanoseconds> pauses;
+    mutex logMtx;
+};
+
+#endif  // YVM_GCLOG_H
@@ -0,0 +1,597 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "HeapInspector.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "GC.h"
+#include "../classfile/AccessFlag.h"
+#include "../runtime/ClassSpace.h"
+#include "../runtime/JavaClass.h"
+#include "../runtime/JavaFrame.hpp"
+#include "../runtime/JavaHeap.hpp"
+#include "../runtime/JavaThread.h"
+
+using namespace std;
+
+//--------------------------------------------------------------------------------
+// Histogram
+//--------------------------------------------------------------------------------
+struct HistogramEntry {
+    string name;
+    size_t instances = 0;
+    size_t bytes = 0;
+};
+
+void HeapInspector::printHistogram(FILE* out) {
+    unordered_map<const JavaClass*, HistogramEntry> objectEntries;
+    map<string, HistogramEntry> arrayEntries;
+
+    for (auto* region : runtime.heap->objectContainer.regions) {
+        for (size_t slot = 0; region != nullptr && slot < YVM_GC_REGION_SLOTS;
+             slot++) {
+            if (region->used[slot]) {
+                auto& entry = objectEntries[region->classes[slot]];
+                entry.instances++;
+                entry.bytes += sizeOfRecord(region->slots[slot]);
+            }
+        }
+    }
+    for (auto* region : runtime.heap->arrayContainer.regions) {
+        for (size_t slot = 0; region != nullptr && slot < YVM_GC_REGION_SLOTS;
+             slot++) {
+            if (region->used[slot]) {
+                auto& entry = arrayEntries[arrayClassName(
+                    region->slots[slot].elementType, region->classes[slot])];
+                entry.instances++;
+                entry.bytes += sizeOfRecord(region->slots[slot]);
+            }
+        }
+    }
+
+    vector<HistogramEntry> entries;
+    for (auto& e : objectEntries) {
+        e.second.name =
+            e.first != nullptr ? e.first->getClassName() : "<unknown>";
+        entries.push_back(e.second);
+    }
+    for (auto& e : arrayEntries) {
+        e.second.name = e.first;
+        entries.push_back(e.second);
+    }
+    sort(entries.begin(), entries.end(),
+         [](const HistogramEntry& a, const HistogramEntry& b) {
+             return a.bytes != b.bytes ? a.bytes > b.bytes : a.name < b.name;
+         });
+
+    size_t totalInstances = 0;
+    size_t totalBytes = 0;
+    fprintf(out, " num     #instances         #bytes  class name\n");
+    fprintf(out, "----------------------------------------------\n");
+    for (size_t i = 0; i < entries.size(); i++) {
+        // Class names are shown in binary form, e.g. java.lang.String
+        replace(entries[i].name.begin(), entries[i].name.end(), '/', '.');
+        fprintf(out, "%4zu: %14zu %14zu  %s\n", i + 1, entries[i].instances,
+                entries[i].bytes, entries[i].name.c_str());
+        totalInstances += entries[i].instances;
+        totalBytes += entries[i].bytes;
+    }
+    fprintf(out, "Total %14zu %14zu\n", totalInstances, totalBytes);
+    fflush(out);
+}
+
+//--------------------------------------------------------------------------------
+// HPROF heap dump. Identifiers are 8 bytes, object records and array records
+// are identified by their offsets tagged in the lowest bits, java classes by
+// their addresses, while array classes and names are numbered in their own
+// tagged spaces. Values of instance fields follow the order of record slots,
+// i.e. fields of the class itself go first and then fields of its super
+// classes, which is exactly what HPROF expects.
+//--------------------------------------------------------------------------------
+enum HprofTag : u1 {
+    HPROF_UTF8 = 0x01,
+    HPROF_LOAD_CLASS = 0x02,
+    HPROF_TRACE = 0x05,
+    HPROF_HEAP_DUMP_SEGMENT = 0x1C,
+    HPROF_HEAP_DUMP_END = 0x2C,
+
+    HPROF_GC_ROOT_JNI_GLOBAL = 0x01,
+    HPROF_GC_ROOT_JAVA_FRAME = 0x03,
+    HPROF_GC_ROOT_STICKY_CLASS = 0x05,
+    HPROF_GC_CLASS_DUMP = 0x20,
+    HPROF_GC_INSTANCE_DUMP = 0x21,
+    HPROF_GC_OBJ_ARRAY_DUMP = 0x22,
+    HPROF_GC_PRIM_ARRAY_DUMP = 0x23
+};
+
+// Basic types of HPROF, primitive ones have the same values as T_BOOLEAN...
+// T_LONG of newarray
+#define HPROF_NORMAL_OBJECT 2
+#define HPROF_ID_SIZE 8
+#define HPROF_TRACE_SERIAL 1
+// Heap dump is split into segments of this size roughly
+#define HPROF_SEGMENT_SIZE (1024 * 1024)
+
+static u1 basicTypeOf(const string& descriptor) {
+    switch (descriptor[0]) {
+        case 'Z':
+            return T_BOOLEAN;
+        case 'C':
+            return T_CHAR;
+        case 'F':
+            return T_FLOAT;
+        case 'D':
+            return T_DOUBLE;
+        case 'B':
+            return T_BYTE;
+        case 'S':
+            return T_SHORT;
+        case 'I':
+            return T_INT;
+        case 'J':
+            return T_LONG;
+        default:
+            return HPROF_NORMAL_OBJECT;
+    }
+}
+
+static size_t sizeOfBasicType(u1 type) {
+    switch (type) {
+        case T_BOOLEAN:
+        case T_BYTE:
+            return 1;
+        case T_CHAR:
+        case T_SHORT:
+            return 2;
+        case T_FLOAT:
+        case T_INT:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+namespace {
+struct HprofField {
+    uint64_t nameId;
+    u1 type;
+    size_t index;  // Index of field in class file
+};
+
+struct HprofClass {
+    uint64_t id;
+    uint64_t superId;
+    uint64_t nameId;
+    const JavaClass* jc;  // nullptr for array classes
+    vector<HprofField> staticFields;
+    vector<HprofField> instanceFields;
+    // Types of all instance fields including inherited ones, in the order of
+    // record slots
+    vector<u1> layout;
+    size_t instanceBytes = 0;
+};
+}  // namespace
+
+class HeapInspector::HprofWriter {
+public:
+    explicit HprofWriter(ofstream& file) : file(file) {}
+
+    bool write();
+
+private:
+    void writeU1(u1 v) { body.push_back(static_cast<char>(v)); }
+    void writeU2(u2 v) {
+        writeU1(static_cast<u1>(v >> 8));
+        writeU1(static_cast<u1>(v));
+    }
+    void writeU4(u4 v) {
+        writeU2(static_cast<u2>(v >> 16));
+        writeU2(static_cast<u2>(v));
+    }
+    void writeU8(uint64_t v) {
+        writeU4(static_cast<u4>(v >> 32));
+        writeU4(static_cast<u4>(v));
+    }
+    void writeId(uint64_t v) { writeU8(v); }
+    void writeValue(u1 type, const JType* v);
+    void flushRecord(u1 tag);
+    void flushSegmentIfFull();
+
+    static uint64_t objectId(size_t offset) { return offset << 3 | 1; }
+    static uint64_t arrayId(size_t offset) { return offset << 3 | 2; }
+    static uint64_t classId(const JavaClass* jc) {
+        return reinterpret_cast<uint64_t>(jc);
+    }
+    uint64_t referenceId(const JType* ref);
+    // Name strings are written as UTF8 records once they are met
+    uint64_t nameId(const string& name);
+
+    void writeClasses();
+    void loadClass(HprofClass& klass, const string& name);
+    void writeRoots();
+    void writeClassDump(const HprofClass& klass);
+    void writeObjects();
+    void writeArrays();
+
+    ofstream& file;
+    string body;
+    u4 classSerial = 0;
+    unordered_map<string, uint64_t> names;
+    unordered_map<const JavaClass*, HprofClass> classes;
+    map<string, HprofClass> arrayClasses;
+    uint64_t objectClassId = 0;
+};
+
+void HeapInspector::HprofWriter::flushRecord(u1 tag) {
+    string header;
+    header.push_back(static_cast<char>(tag));
+    // Microseconds since header timestamp, and length of record body
+    const u4 fields[2] = {0, static_cast<u4>(body.size())};
+    for (u4 f : fields) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            header.push_back(static_cast<char>(f >> shift));
+        }
+    }
+    file.write(header.data(), header.size());
+    file.write(body.data(), body.size());
+    body.clear();
+}
+
+void HeapInspector::HprofWriter::flushSegmentIfFull() {
+    if (body.size() >= HPROF_SEGMENT_SIZE) {
+        flushRecord(HPROF_HEAP_DUMP_SEGMENT);
+    }
+}
+
+uint64_t HeapInspector::HprofWriter::nameId(const string& name) {
+    auto iter = names.find(name);
+    if (iter != names.end()) {
+        return iter->second;
+    }
+    const uint64_t nid = (names.size() + 1) << 3 | 4;
+    names.insert(make_pair(name, nid));
+    writeId(nid);
+    body.append(name);
+    flushRecord(HPROF_UTF8);
+    return nid;
+}
+
+uint64_t HeapInspector::HprofWriter::referenceId(const JType* ref) {
+    // Dangling references are dumped as null, otherwise analyzers would
+    // complain about missing records
+    if (ref == nullptr) {
+        return 0;
+    }
+    if (typeid(*ref) == typeid(JObject)) {
+        const size_t offset = static_cast<const JObject*>(ref)->offset;
+        return runtime.heap->objectContainer.has(offset) ? objectId(offset)
+                                                         : 0;
+    }
+    if (typeid(*ref) == typeid(JArray)) {
+        const size_t offset = static_cast<const JArray*>(ref)->offset;
+        return runtime.heap->arrayContainer.has(offset) ? arrayId(offset) : 0;
+    }
+    return 0;
+}
+
+void HeapInspector::HprofWriter::writeValue(u1 type, const JType* v) {
+    int64_t integral = 0;
+    if (v != nullptr && typeid(*v) == typeid(JInt)) {
+        integral = static_cast<const JInt*>(v)->val;
+    } else if (v != nullptr && typeid(*v) == typeid(JLong)) {
+        integral = static_cast<const JLong*>(v)->val;
+    }
+    switch (type) {
+        case HPROF_NORMAL_OBJECT:
+            writeId(referenceId(v));
+            break;
+        case T_BOOLEAN:
+        case T_BYTE:
+            writeU1(static_cast<u1>(integral));
+            break;
+        case T_CHAR:
+        case T_SHORT:
+            writeU2(static_cast<u2>(integral));
+            break;
+        case T_INT:
+            writeU4(static_cast<u4>(integral));
+            break;
+        case T_LONG:
+            writeU8(static_cast<uint64_t>(integral));
+            break;
+        case T_FLOAT: {
+            float f = v != nullptr && typeid(*v) == typeid(JFloat)
+                          ? static_cast<const JFloat*>(v)->val
+                          : 0.0f;
+            u4 bits;
+            memcpy(&bits, &f, sizeof(bits));
+            writeU4(bits);
+        } break;
+        case T_DOUBLE: {
+            double d = v != nullptr && typeid(*v) == typeid(JDouble)
+                           ? static_cast<const JDouble*>(v)->val
+                           : 0.0;
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            writeU8(bits);
+        } break;
+        default:
+            break;
+    }
+}
+
+void HeapInspector::HprofWriter::loadClass(HprofClass& klass,
+                                           const string& name) {
+    klass.nameId = nameId(name);
+    writeU4(++classSerial);
+    writeId(klass.id);
+    writeU4(HPROF_TRACE_SERIAL);
+    writeId(klass.nameId);
+    flushRecord(HPROF_LOAD_CLASS);
+}
+
+// Write names and LOAD_CLASS records of all java classes and array classes,
+// and prepare their field information for the heap dump
+void HeapInspector::HprofWriter::writeClasses() {
+    for (auto& c : runtime.cs->classTable) {
+        HprofClass& klass = classes[c.second];
+        klass.id = classId(c.second);
+        klass.jc = c.second;
+        loadClass(klass, c.first);
+    }
+    objectClassId = classId(runtime.cs->findJavaClass("java/lang/Object"));
+
+    for (auto& c : classes) {
+        HprofClass& klass = c.second;
+        const JavaClass* jc = klass.jc;
+        const JavaClass* superClass =
+            jc->hasSuperClass()
+                ? runtime.cs->findJavaClass(jc->getSuperClassName())
+                : nullptr;
+        klass.superId = classes.count(superClass) != 0 ? classId(superClass)
+                                                       : 0;
+        FOR_EACH(i, jc->raw.fieldsCount) {
+            const HprofField field{
+                nameId(jc->getString(jc->raw.fields[i].nameIndex)),
+                basicTypeOf(jc->getString(jc->raw.fields[i].descriptorIndex)),
+                static_cast<size_t>(i)};
+            if (IS_FIELD_STATIC(jc->raw.fields[i].accessFlags)) {
+                klass.staticFields.push_back(field);
+            } else {
+                klass.instanceFields.push_back(field);
+            }
+        }
+    }
+    // Layout is computed after instance fields of all classes are known
+    for (auto& c : classes) {
+        for (const HprofClass* k = &c.second; k != nullptr;) {
+            for (auto& field : k->instanceFields) {
+                c.second.layout.push_back(field.type);
+                c.second.instanceBytes += sizeOfBasicType(field.type);
+            }
+            auto superClass = k->jc->hasSuperClass()
+                                  ? runtime.cs->findJavaClass(
+                                        k->jc->getSuperClassName())
+                                  : nullptr;
+            auto iter = classes.find(superClass);
+            k = iter != classes.end() ? &iter->second : nullptr;
+        }
+    }
+
+    uint64_t arrayClassCnt = 0;
+    for (auto* region : runtime.heap->arrayContainer.regions) {
+        for (size_t slot = 0; region != nullptr && slot < YVM_GC_REGION_SLOTS;
+             slot++) {
+            if (!region->used[slot] || !region->slots[slot].hasReferences()) {
+                continue;
+            }
+            const string name =
+                arrayClassName(region->slots[slot].elementType,
+                               region->classes[slot]);
+            if (arrayClasses.count(name) == 0) {
+                HprofClass& klass = arrayClasses[name];
+                klass.id = (++arrayClassCnt) << 3 | 3;
+                klass.superId = objectClassId;
+                klass.jc = nullptr;
+                loadClass(klass, name);
+            }
+        }
+    }
+}
+
+void HeapInspector::HprofWriter::writeRoots() {
+    for (auto& c : classes) {
+        writeU1(HPROF_GC_ROOT_STICKY_CLASS);
+        writeId(c.second.id);
+    }
+
+    auto threads = runtime.threads->getThreads();
+    for (size_t t = 0; t < threads.size(); t++) {
+        for (auto* frame = threads[t]->frames->top(); frame != nullptr;
+             frame = frame->next) {
+            vector<JType*> slots(frame->stackSlots,
+                                 frame->stackSlots + frame->maxStack);
+            slots.insert(slots.end(), frame->localSlots,
+                         frame->localSlots + frame->maxLocal);
+            for (auto* slot : slots) {
+                const uint64_t ref = referenceId(slot);
+                if (ref != 0) {
+                    writeU1(HPROF_GC_ROOT_JAVA_FRAME);
+                    writeId(ref);
+                    writeU4(static_cast<u4>(t + 1));
+                    // Frame number in stack trace, which is unknown
+                    writeU4(0xFFFFFFFF);
+                }
+            }
+        }
+        flushSegmentIfFull();
+    }
+
+    lock_guard<mutex> lock(runtime.gc->nativeRootsMtx);
+    for (auto* root : runtime.gc->nativeRoots) {
+        const uint64_t ref = referenceId(root);
+        if (ref != 0) {
+            writeU1(HPROF_GC_ROOT_JNI_GLOBAL);
+            writeId(ref);
+            writeId(ref);
+        }
+    }
+}
+
+void HeapInspector::HprofWriter::writeClassDump(const HprofClass& klass) {
+    writeU1(HPROF_GC_CLASS_DUMP);
+    writeId(klass.id);
+    writeU4(HPROF_TRACE_SERIAL);
+    writeId(klass.superId);
+    // Class loader, signers, protection domain and two reserved ids
+    for (int i = 0; i < 5; i++) {
+        writeId(0);
+    }
+    writeU4(static_cast<u4>(klass.instanceBytes));
+    writeU2(0);  // Constant pool is not dumped
+
+    writeU2(static_cast<u2>(klass.staticFields.size()));
+    for (auto& field : klass.staticFields) {
+        writeId(field.nameId);
+        writeU1(field.type);
+        // Static fields are created when class is linked
+        auto iter = klass.jc->staticVars.find(field.index);
+        writeValue(field.type,
+              iter != klass.jc->staticVars.end() ? iter->second : nullptr);
+    }
+    writeU2(static_cast<u2>(klass.instanceFields.size()));
+    for (auto& field : klass.instanceFields) {
+        writeId(field.nameId);
+        writeU1(field.type);
+    }
+    flushSegmentIfFull();
+}
+
+void HeapInspector::HprofWriter::writeObjects() {
+    auto& container = runtime.heap->objectContainer;
+    for (auto* region : container.regions) {
+        for (size_t slot = 0; region != nullptr && slot < YVM_GC_REGION_SLOTS;
+             slot++) {
+            auto iter = classes.find(region->classes[slot]);
+            if (!region->used[slot] || iter == classes.end()) {
+                continue;
+            }
+            const HprofClass& klass = iter->second;
+            const InternalObject& fields = region->slots[slot];
+            writeU1(HPROF_GC_INSTANCE_DUMP);
+            writeId(objectId(container.offsetOf(region->index, slot)));
+            writeU4(HPROF_TRACE_SERIAL);
+            writeId(klass.id);
+            writeU4(static_cast<u4>(klass.instanceBytes));
+            for (size_t i = 0; i < klass.layout.size(); i++) {
+                writeValue(klass.layout[i],
+                           i < fields.size() ? fields[i] : nullptr);
+            }
+            flushSegmentIfFull();
+        }
+    }
+}
+
+void HeapInspector::HprofWriter::writeArrays() {
+    auto& container = runtime.heap->arrayContainer;
+    for (auto* region : container.regions) {
+        for (size_t slot = 0; region != nullptr && slot < YVM_GC_REGION_SLOTS;
+             slot++) {
+            if (!region->used[slot]) {
+                continue;
+            }
+            const InternalArray& array = region->slots[slot];
+            if (array.hasReferences()) {
+                writeU1(HPROF_GC_OBJ_ARRAY_DUMP);
+                writeId(arrayId(container.offsetOf(region->index, slot)));
+                writeU4(HPROF_TRACE_SERIAL);
+                writeU4(static_cast<u4>(array.length));
+                const string name =
+                    arrayClassName(array.elementType, region->classes[slot]);
+                writeId(arrayClasses.find(name)->second.id);
+                for (size_t i = 0; i < array.length; i++) {
+                    writeId(referenceId(array.items[i]));
+                }
+            } else {
+                writeU1(HPROF_GC_PRIM_ARRAY_DUMP);
+                writeId(arrayId(container.offsetOf(region->index, slot)));
+                writeU4(HPROF_TRACE_SERIAL);
+                writeU4(static_cast<u4>(array.length));
+                writeU1(static_cast<u1>(array.elementType));
+                for (size_t i = 0; i < array.length; i++) {
+                    writeValue(static_cast<u1>(array.elementType),
+                          array.items[i]);
+                }
+            }
+            flushSegmentIfFull();
+        }
+    }
+}
+
+bool HeapInspector::HprofWriter::write() {
+    const char magic[] = "JAVA PROFILE 1.0.2";
+    file.write(magic, sizeof(magic));
+    writeU4(HPROF_ID_SIZE);
+    writeU8(static_cast<uint64_t>(
+        chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch())
+            .count()));
+    file.write(body.data(), body.size());
+    body.clear();
+
+    // A stack trace without frames, which all records refer to
+    writeU4(HPROF_TRACE_SERIAL);
+    writeU4(0);  // Thread serial number
+    writeU4(0);  // Number of frames
+    flushRecord(HPROF_TRACE);
+
+    lock_guard<recursive_mutex> lock(runtime.cs->maMutex);
+    writeClasses();
+    writeRoots();
+    for (auto& c : classes) {
+        writeClassDump(c.second);
+    }
+    for (auto& c : arrayClasses) {
+        writeClassDump(c.second);
+    }
+    writeObjects();
+    writeArrays();
+    flushRecord(HPROF_HEAP_DUMP_SEGMENT);
+    flushRecord(HPROF_HEAP_DUMP_END);
+
+    file.flush();
+    return file.good();
+}
+
+bool HeapInspector::dumpHeap(const string& path) {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    return HprofWriter(file).write();
+}
@@ -0,0 +1,52 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_HEAPINSPECTOR_H
+#define YVM_HEAPINSPECTOR_H
+
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+//--------------------------------------------------------------------------------
+// Heap inspector walks records of all regions in JavaHeap containers, classes
+// of records are taken from their regions. It prints a per-class histogram of
+// instance counts and bytes like "jmap -histo", or writes a heap dump in HPROF
+// format which can be opened by standard heap analyzers.
+//
+// All of them must run at a safepoint, e.g. as a VM operation passed to
+// Safepoint::execute(). Unreachable records which have not been collected yet
+// are included as well.
+//--------------------------------------------------------------------------------
+class HeapInspector {
+public:
+    static void printHistogram(FILE* out);
+    // Return false if the dump file can not be written
+    static bool dumpHeap(const string& path);
+
+private:
+    class HprofWriter;
+};
+
+#endif  // YVM_HEAPINSPECTOR_H
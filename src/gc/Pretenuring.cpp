@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "Pretenuring.h"
+#include <algorithm>
+#include "../misc/Option.h"
+
+void PretenuringPolicy::initialize(const VMOption& option) {
+    enabled = option.useAllocationSitePretenuring;
+    sweepInterval = max<size_t>(option.longLivedSweepInterval, 1);
+}
+
+AllocationSite* PretenuringPolicy::siteOf(const MethodInfo* method, u4 bci) {
+    if (!enabled || method == nullptr) {
+        return nullptr;
+    }
+    lock_guard<mutex> lock(sitesMtx);
+    return &sites[make_pair(method, bci)];
+}
+
+size_t PretenuringPolicy::update() {
+    lock_guard<mutex> lock(sitesMtx);
+    size_t longLivedSites = 0;
+    for (auto& entry : sites) {
+        AllocationSite& site = entry.second;
+        const size_t survivors = site.survivors;
+        const size_t total = survivors + site.deaths;
+        if (total >= YVM_GC_PRETENURE_MIN_SAMPLES) {
+            site.longLived = survivors * 100 >=
+                             total * YVM_GC_PRETENURE_SURVIVAL_PERCENT;
+            site.survivors = survivors / 2;
+            site.deaths = (total - survivors) / 2;
+        }
+        longLivedSites += site.longLived ? 1 : 0;
+    }
+    return longLivedSites;
+}
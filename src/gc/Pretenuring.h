@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_PRETENURING_H
+#define YVM_PRETENURING_H
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include "../interpreter/Internal.h"
+
+using namespace std;
+
+struct MethodInfo;
+struct VMOption;
+
+//--------------------------------------------------------------------------------
+// Allocation site is a new, newarray or anewarray bytecode of a method. Every
+// record remembers its site until a sweep examines it for the first time,
+// which counts it as a survivor of the site if it's marked, or as a death
+// otherwise. Records of long-lived sites are placed in long-lived regions.
+//--------------------------------------------------------------------------------
+struct AllocationSite {
+    atomic<size_t> survivors{0};
+    atomic<size_t> deaths{0};
+    atomic_bool longLived{false};
+};
+
+//--------------------------------------------------------------------------------
+// Pretenuring policy judges allocation sites by survival rate of their
+// records after every GC cycle. Heap is then segregated by lifetime: regions
+// of short-lived space are swept every cycle, while regions of long-lived
+// space are merely swept every LongLivedSweepInterval cycles, so that caches
+// which live for long are not scanned again and again. Counters of a site are
+// halved after it's judged, thus a site whose behavior changes is judged again
+// by its recent records.
+//--------------------------------------------------------------------------------
+class PretenuringPolicy {
+public:
+    void initialize(const VMOption& option);
+
+    bool isEnabled() const { return enabled; }
+
+    // Return nullptr if allocation sites are not profiled
+    AllocationSite* siteOf(const MethodInfo* method, u4 bci);
+
+    bool shallSweepLongLived(size_t cycleId) const {
+        return cycleId % sweepInterval == 0;
+    }
+
+    // Judge sites which have enough swept records after a GC cycle, return
+    // the number of long-lived sites
+    size_t update();
+
+private:
+    struct SiteHash {
+        size_t operator()(const pair<const MethodInfo*, u4>& key) const {
+            return hash<const void*>()(key.first) * 31 + key.second;
+        }
+    };
+
+    bool enabled = false;
+    size_t sweepInterval = 1;
+
+    mutex sitesMtx;
+    // Sites are never removed, since classes are never unloaded
+    unordered_map<pair<const MethodInfo*, u4>, AllocationSite, SiteHash>
+        sites;
+};
+
+#endif  // YVM_PRETENURING_H
@@ -24,13 +24,18 @@
 #include "CallSite.h"
 
 CallSite::CallSite()
-    : jc(nullptr), code(nullptr), exception(nullptr), callable(false) {}
+    : jc(nullptr),
+      method(nullptr),
+      code(nullptr),
+      exception(nullptr),
+      callable(false) {}
 
 CallSite CallSite::makeCallSite(const JavaClass* jc, MethodInfo* m) {
     CallSite cs;
     cs.callable = m != nullptr ? true : false;
     cs.accessFlags = m->accessFlags;
     cs.jc = jc;
+    cs.method = m;
 
     FOR_EACH(i, m->attributeCount) {
         if (typeid(*m->attributes[i]) == typeid(ATTR_Code)) {
@@ -34,6 +34,7 @@ struct CallSite {
     static CallSite makeCallSite(const JavaClass* jc, MethodInfo* m);
 
     const JavaClass* jc;
+    const MethodInfo* method;
     u2 accessFlags;
     u1* code;
     u4 codeLength;
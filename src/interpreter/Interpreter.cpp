@@ -27,6 +27,8 @@
 #include "../misc/Option.h"
 #include "../runtime/JavaClass.h"
 #include "../runtime/JavaHeap.hpp"
+#include "../runtime/MonitorProfiler.h"
+#include "../runtime/Safepoint.h"
 #include "CallSite.h"
 #include "Interpreter.hpp"
 #include "MethodResolve.h"
@@ -44,10 +46,46 @@ using namespace std;
 #define IS_COMPUTATIONAL_TYPE_2(value) \
     (typeid(*value) == typeid(JDouble) || typeid(*value) == typeid(JLong))
 
+// Safepoint poll, which is placed at method entry, method exit and backward
+// branches. The fast path is merely an atomic load
+#define SAFEPOINT_POLL()                         \
+    if (runtime.safepoint->isRequested()) {      \
+        runtime.safepoint->block(&thread);       \
+    }
+
 #pragma warning(disable : 4715)
 #pragma warning(disable : 4244)
 
-Interpreter::~Interpreter() { delete frames; }
+Interpreter::Interpreter(JavaFrame* frames) : frames(frames), thread(frames) {
+    // New thread is attached as blocked, it must not run java code while
+    // there is an ongoing safepoint which didn't know it
+    runtime.threads->attach(&thread);
+    runtime.safepoint->leaveBlocked(&thread);
+}
+
+Interpreter::~Interpreter() {
+    runtime.threads->detach(&thread);
+    runtime.monitorProfiler->retire(&thread);
+    delete frames;
+}
+
+void Interpreter::runThread() {
+    frames->pushFrame(1, 1);
+    frames->top()->push(thread.threadObject);
+    invokeVirtual("run", "()V");
+    if (exception.hasUnhandledException()) {
+        // Uncaught exception terminates the thread rather than the program
+        exception.printStackTrace();
+        exception.sweepException();
+    }
+    frames->popFrame();
+
+    frames->pushFrame(1, 1);
+    frames->top()->push(thread.threadObject);
+    invokeSpecial(runtime.cs->findJavaClass("java/lang/Thread"), "exit",
+                  "()V");
+    frames->popFrame();
+}
 
 JType *Interpreter::execNativeMethod(const string &className,
                                      const string &methodName,
@@ -59,20 +97,75 @@ JType *Interpreter::execNativeMethod(const string &className,
     nativeMethod.append(methodDescriptor);
     if (runtime.nativeMethods.find(nativeMethod) !=
         runtime.nativeMethods.end()) {
-        return ((*runtime.nativeMethods.find(nativeMethod)).second)(
-            &runtime, frames->top()->localSlots, frames->top()->maxLocal);
+        thread.state = ThreadState::IN_NATIVE;
+        JType *result = ((*runtime.nativeMethods.find(nativeMethod)).second)(
+            &runtime, &thread, frames->top()->localSlots,
+            frames->top()->maxLocal);
+        thread.state = ThreadState::IN_JAVA;
+        // Exception thrown by native method is propagated as if it's thrown
+        // by athrow which can not be handled within the method
+        if (thread.pendingException != nullptr) {
+            JObject *throwobj = thread.pendingException;
+            thread.pendingException = nullptr;
+            exception.markException();
+            exception.setThrowExceptionInfo(throwobj);
+            return throwobj;
+        }
+        return result;
     }
+    return nullptr;
+}
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
+JType *Interpreter::execMethod(const CallSite &csite, const string &name,
+                               const string &descriptor) {
+    JType *lockRef = nullptr;
+    if (IS_METHOD_SYNCHRONIZED(csite.accessFlags) &&
+        !IS_METHOD_STATIC(csite.accessFlags)) {
+        lockRef = frames->top()->localSlots[0];
+        enterMonitor(lockRef);
+    }
+    JType *result =
+        IS_METHOD_NATIVE(csite.accessFlags)
+            ? execNativeMethod(csite.jc->getClassName(), name, descriptor)
+            : execByteCode(csite.jc, csite.code, csite.codeLength,
+                           csite.exceptionLen, csite.exception);
+    if (lockRef != nullptr) {
+        exitMonitor(lockRef);
+    }
+    return result;
+}
+
+void Interpreter::enterMonitor(JType *ref) {
+    // Uncontended lock is acquired by a CAS on its lock word, only an
+    // inflated monitor may park this thread after spinning
+    auto *monitor = runtime.heap->enterMonitor(ref, thread.lockId);
+    MonitorProfiler *profiler = runtime.monitorProfiler;
+    MonitorProfiler::Contention contention;
+    const bool contended =
+        profiler->isEnabled() && monitor != nullptr &&
+        profiler->beginContention(monitor, ref, thread.lockId, contention);
+    if (monitor != nullptr && !monitor->tryEnter(thread.lockId)) {
+        ThreadBlockedScope blocked(runtime.safepoint, &thread);
+        monitor->enter(&thread);
+    }
+    if (profiler->isEnabled()) {
+        profiler->recordEnter(&thread, frames->top(), ref,
+                              contended ? &contention : nullptr);
+    }
+}
+
+void Interpreter::exitMonitor(JType *ref) {
+    runtime.heap->exitMonitor(ref, thread.lockId);
+    if (runtime.monitorProfiler->isEnabled()) {
+        runtime.monitorProfiler->recordExit(&thread, ref);
     }
-    return nullptr;
 }
 
 JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                                  u2 exceptLen, ExceptionTable *exceptTab) {
+    SAFEPOINT_POLL();
+    // Constant pool entries are resolved by this thread at most once
+    ResolvedRef *resolved = thread.resolution->entriesOf(jc);
     for (decltype(codeLength) op = 0; op < codeLength; op++) {
         // If callee propagates a unhandled exception, try to handle  it. When
         // we can not handle it, propagates it to upper and returns
@@ -94,6 +187,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 }
                 frames->top()->push(throwobj);
                 exception.sweepException();
+                // Handler pc was adjusted for the increment of the loop, but
+                // we are going to execute it right now
+                op++;
             } else {
                 return throwobj;
             }
@@ -104,6 +200,7 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
         }
         Inspector::printOpcode(code, op);
 #endif
+        frames->top()->bci = op;
         // Interpreting through big switching
         switch (code[op]) {
             case op_nop: {
@@ -921,6 +1018,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val == 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -930,6 +1030,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val != 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -939,6 +1042,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val < 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -948,6 +1054,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val >= 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -957,6 +1066,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val > 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -966,6 +1078,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value = frames->top()->pop<JInt>();
                 if (value->val <= 0) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -976,6 +1091,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val == value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -986,6 +1104,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val != value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -996,6 +1117,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val < value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1006,6 +1130,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val >= value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1016,6 +1143,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val > value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1026,6 +1156,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 auto *value1 = frames->top()->pop<JInt>();
                 if (value1->val <= value2->val) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1037,6 +1170,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 if (value1->offset == value2->offset &&
                     value1->jc == value2->jc) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1048,6 +1184,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 if (value1->offset != value2->offset ||
                     value1->jc != value2->jc) {
                     op = currentOffset + branchindex;
+                    if (branchindex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
 
             } break;
@@ -1055,6 +1194,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 u4 currentOffset = op - 1;
                 int16_t branchindex = consumeU2(code, op);
                 op = currentOffset + branchindex;
+                if (branchindex <= 0) {
+                    SAFEPOINT_POLL();
+                }
             } break;
             case op_jsr: {
                 throw runtime_error("unsupported opcode [jsr]");
@@ -1123,32 +1265,29 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
             } break;
             case op_getstatic: {
                 const u2 index = consumeU2(code, op);
-                auto symbolicRef = parseFieldSymbolicReference(jc, index);
-                runtime.cs->linkClassIfAbsent(symbolicRef.jc->getClassName());
-                runtime.cs->initClassIfAbsent(*this,
-                                          symbolicRef.jc->getClassName());
-                JType *field = symbolicRef.jc->getStaticVar(
-                    symbolicRef.name, symbolicRef.descriptor);
+                JType **slot = resolveStaticField(jc, index, resolved[index]);
+                JType *field = slot != nullptr ? *slot : nullptr;
                 frames->top()->push(field);
             } break;
             case op_putstatic: {
                 u2 index = consumeU2(code, op);
+                // Class initialization may reach a safepoint, the value must
+                // stay on operand stack until then so that it's a root
+                JType **slot = resolveStaticField(jc, index, resolved[index]);
                 JType *value = frames->top()->pop<JType>();
-                auto symbolicRef = parseFieldSymbolicReference(jc, index);
-
-                runtime.cs->linkClassIfAbsent(symbolicRef.jc->getClassName());
-                runtime.cs->initClassIfAbsent(*this,
-                                          symbolicRef.jc->getClassName());
-                symbolicRef.jc->setStaticVar(symbolicRef.name,
-                                             symbolicRef.descriptor, value);
+                if (slot != nullptr) {
+                    *slot = value;
+                }
             } break;
             case op_getfield: {
                 u2 index = consumeU2(code, op);
                 JObject *objectref = frames->top()->pop<JObject>();
-                auto symbolicRef = parseFieldSymbolicReference(jc, index);
-                JType *field = cloneValue(runtime.heap->getFieldByName(
-                    symbolicRef.jc, symbolicRef.name, symbolicRef.descriptor,
-                    objectref));
+                const size_t slot = resolveInstanceField(
+                    jc, index, resolved[index], objectref);
+                JType *field = slot != JavaHeap::NO_FIELD
+                                   ? cloneValue(runtime.heap->getFieldByOffset(
+                                         *objectref, slot))
+                                   : nullptr;
                 frames->top()->push(field);
 
             } break;
@@ -1156,10 +1295,11 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 const u2 index = consumeU2(code, op);
                 JType *value = frames->top()->pop<JType>();
                 JObject *objectref = frames->top()->pop<JObject>();
-                auto symbolicRef = parseFieldSymbolicReference(jc, index);
-                runtime.heap->putFieldByName(symbolicRef.jc, symbolicRef.name,
-                                          symbolicRef.descriptor, objectref,
-                                          value);
+                const size_t slot = resolveInstanceField(
+                    jc, index, resolved[index], objectref);
+                if (slot != JavaHeap::NO_FIELD) {
+                    runtime.heap->putFieldByOffset(*objectref, slot, value);
+                }
 
             } break;
             case op_invokevirtual: {
@@ -1167,7 +1307,11 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 assert(typeid(*jc->raw.constPoolInfo[index]) ==
                        typeid(CONSTANT_Methodref));
 
-                auto symbolicRef = parseMethodSymbolicReference(jc, index);
+                auto &symbolicRef = resolved[index];
+                if (!symbolicRef.isResolved()) {
+                    symbolicRef.resolve(
+                        parseMethodSymbolicReference(jc, index));
+                }
 
                 if (symbolicRef.name == "<init>") {
                     runtime_error(
@@ -1176,7 +1320,8 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 }
                 if (!IS_SIGNATURE_POLYMORPHIC_METHOD(
                         symbolicRef.jc->getClassName(), symbolicRef.name)) {
-                    invokeVirtual(symbolicRef.name, symbolicRef.descriptor);
+                    invokeVirtual(symbolicRef.name, symbolicRef.descriptor,
+                                  &symbolicRef);
                 } else {
                     // TODO:TO BE IMPLEMENTED
                 }
@@ -1184,17 +1329,20 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
             } break;
             case op_invokespecial: {
                 const u2 index = consumeU2(code, op);
-                SymbolicRef symbolicRef;
-
-                if (typeid(*jc->raw.constPoolInfo[index]) ==
-                    typeid(CONSTANT_InterfaceMethodref)) {
-                    symbolicRef =
-                        parseInterfaceMethodSymbolicReference(jc, index);
-                } else if (typeid(*jc->raw.constPoolInfo[index]) ==
-                           typeid(CONSTANT_Methodref)) {
-                    symbolicRef = parseMethodSymbolicReference(jc, index);
-                } else {
-                    SHOULD_NOT_REACH_HERE
+                auto &symbolicRef = resolved[index];
+
+                if (!symbolicRef.isResolved()) {
+                    if (typeid(*jc->raw.constPoolInfo[index]) ==
+                        typeid(CONSTANT_InterfaceMethodref)) {
+                        symbolicRef.resolve(
+                            parseInterfaceMethodSymbolicReference(jc, index));
+                    } else if (typeid(*jc->raw.constPoolInfo[index]) ==
+                               typeid(CONSTANT_Methodref)) {
+                        symbolicRef.resolve(
+                            parseMethodSymbolicReference(jc, index));
+                    } else {
+                        SHOULD_NOT_REACH_HERE
+                    }
                 }
 
                 // If all of the following are true, let C be the direct
@@ -1209,7 +1357,8 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                                 invokeSpecial(runtime.cs->findJavaClass(
                                                   jc->getSuperClassName()),
                                               symbolicRef.name,
-                                              symbolicRef.descriptor);
+                                              symbolicRef.descriptor,
+                                              &symbolicRef);
                                 break;
                             }
                         }
@@ -1217,38 +1366,44 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 }
                 // Otherwise let C be the symbolic reference class
                 invokeSpecial(symbolicRef.jc, symbolicRef.name,
-                              symbolicRef.descriptor);
+                              symbolicRef.descriptor, &symbolicRef);
             } break;
             case op_invokestatic: {
                 // Invoke a class (static) method
                 const u2 index = consumeU2(code, op);
-
-                if (typeid(*jc->raw.constPoolInfo[index]) ==
-                    typeid(CONSTANT_InterfaceMethodref)) {
-                    auto symbolicRef =
-                        parseInterfaceMethodSymbolicReference(jc, index);
-                    invokeStatic(symbolicRef.jc, symbolicRef.name,
-                                 symbolicRef.descriptor);
-                } else if (typeid(*jc->raw.constPoolInfo[index]) ==
-                           typeid(CONSTANT_Methodref)) {
-                    auto symbolicRef = parseMethodSymbolicReference(jc, index);
-                    invokeStatic(symbolicRef.jc, symbolicRef.name,
-                                 symbolicRef.descriptor);
-                } else {
-                    SHOULD_NOT_REACH_HERE
+                auto &symbolicRef = resolved[index];
+
+                if (!symbolicRef.isResolved()) {
+                    if (typeid(*jc->raw.constPoolInfo[index]) ==
+                        typeid(CONSTANT_InterfaceMethodref)) {
+                        symbolicRef.resolve(
+                            parseInterfaceMethodSymbolicReference(jc, index));
+                    } else if (typeid(*jc->raw.constPoolInfo[index]) ==
+                               typeid(CONSTANT_Methodref)) {
+                        symbolicRef.resolve(
+                            parseMethodSymbolicReference(jc, index));
+                    } else {
+                        SHOULD_NOT_REACH_HERE
+                    }
                 }
+                invokeStatic(symbolicRef.jc, symbolicRef.name,
+                             symbolicRef.descriptor, &symbolicRef);
             } break;
             case op_invokeinterface: {
                 const u2 index = consumeU2(code, op);
                 ++op;  // read count and discard
                 ++op;  // opcode padding 0;
 
-                if (typeid(*jc->raw.constPoolInfo[index]) ==
-                    typeid(CONSTANT_InterfaceMethodref)) {
-                    auto symbolicRef =
-                        parseInterfaceMethodSymbolicReference(jc, index);
+                auto &symbolicRef = resolved[index];
+                if (!symbolicRef.isResolved() &&
+                    typeid(*jc->raw.constPoolInfo[index]) ==
+                        typeid(CONSTANT_InterfaceMethodref)) {
+                    symbolicRef.resolve(
+                        parseInterfaceMethodSymbolicReference(jc, index));
+                }
+                if (symbolicRef.isResolved()) {
                     invokeInterface(symbolicRef.jc, symbolicRef.name,
-                                    symbolicRef.descriptor);
+                                    symbolicRef.descriptor, &symbolicRef);
                 }
             } break;
             case op_invokedynamic: {
@@ -1256,7 +1411,7 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
             } break;
             case op_new: {
                 const u2 index = consumeU2(code, op);
-                JObject *objectref = execNew(jc, index);
+                JObject *objectref = execNew(jc, index, resolved[index]);
                 frames->top()->push(objectref);
             } break;
             case op_newarray: {
@@ -1266,21 +1421,25 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 if (count->val < 0) {
                     throw runtime_error("negative array size");
                 }
-                JArray *arrayref =
-                    runtime.heap->createPODArray(atype, count->val);
+                JArray *arrayref = runtime.heap->createPODArray(
+                    atype, count->val, currentAllocationSite());
 
                 frames->top()->push(arrayref);
 
             } break;
             case op_anewarray: {
                 const u2 index = consumeU2(code, op);
-                auto symbolicRef = parseClassSymbolicReference(jc, index);
+                auto &symbolicRef = resolved[index];
+                if (!symbolicRef.isResolved()) {
+                    symbolicRef.resolve(parseClassSymbolicReference(jc, index));
+                }
                 JInt *count = frames->top()->pop<JInt>();
 
                 if (count->val < 0) {
                     throw runtime_error("negative array size");
                 }
-                JArray *arrayref = runtime.heap->createObjectArray(*symbolicRef.jc, count->val);
+                JArray *arrayref = runtime.heap->createObjectArray(
+                    *symbolicRef.jc, count->val, currentAllocationSite());
 
                 frames->top()->push(arrayref);
             } break;
@@ -1338,12 +1497,7 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 if (ref == nullptr) {
                     throw runtime_error("null pointer");
                 }
-
-                if (!runtime.heap->hasMonitor(ref)) {
-                    dynamic_cast<JObject *>(ref)->offset =
-                        runtime.heap->createMonitor();
-                }
-                runtime.heap->findMonitor(ref)->enter(this_thread::get_id());
+                enterMonitor(ref);
             } break;
             case op_monitorexit: {
                 JType *ref = frames->top()->pop<JType>();
@@ -1351,12 +1505,7 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 if (ref == nullptr) {
                     throw runtime_error("null pointer");
                 }
-                if (!runtime.heap->hasMonitor(ref)) {
-                    dynamic_cast<JObject *>(ref)->offset =
-                        runtime.heap->createMonitor();
-                }
-                runtime.heap->findMonitor(ref)->exit();
-
+                exitMonitor(ref);
             } break;
             case op_wide: {
                 throw runtime_error("unsupported opcode [wide]");
@@ -1370,6 +1519,9 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 JObject *value = frames->top()->pop<JObject>();
                 if (value == nullptr) {
                     op = currentOffset + branchIndex;
+                    if (branchIndex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
             } break;
             case op_ifnonnull: {
@@ -1378,12 +1530,18 @@ JType *Interpreter::execByteCode(const JavaClass *jc, u1 *code, u4 codeLength,
                 JObject *value = frames->top()->pop<JObject>();
                 if (value != nullptr) {
                     op = currentOffset + branchIndex;
+                    if (branchIndex <= 0) {
+                        SAFEPOINT_POLL();
+                    }
                 }
             } break;
             case op_goto_w: {
                 u4 currentOffset = op - 1;
                 int32_t branchIndex = consumeU4(code, op);
                 op = currentOffset + branchIndex;
+                if (branchIndex <= 0) {
+                    SAFEPOINT_POLL();
+                }
             } break;
             case op_jsr_w: {
                 throw runtime_error("unsupported opcode [jsr_w]");
@@ -1455,6 +1613,14 @@ bool Interpreter::handleException(const JavaClass *jc, u2 exceptLen,
                                   ExceptionTable *exceptTab,
                                   const JObject *objectref, u4 &op) {
     FOR_EACH(i, exceptLen) {
+        if (op < exceptTab[i].startPC || op >= exceptTab[i].endPC) {
+            continue;
+        }
+        // Handlers of finally and synchronized blocks catch any exception
+        if (exceptTab[i].catchType == 0) {
+            op = exceptTab[i].handlerPC - 1;
+            return true;
+        }
         const string &catchTypeName =
             jc->getString(dynamic_cast<CONSTANT_Class *>(
                               jc->raw.constPoolInfo[exceptTab[i].catchType])
@@ -1462,38 +1628,75 @@ bool Interpreter::handleException(const JavaClass *jc, u2 exceptLen,
 
         if (hasInheritanceRelationship(
                 runtime.cs->findJavaClass(objectref->jc->getClassName()),
-                runtime.cs->findJavaClass(catchTypeName)) &&
-            exceptTab[i].startPC <= op && op < exceptTab[i].endPC) {
-            // start<=op<end
+                runtime.cs->loadClassIfAbsent(catchTypeName))) {
             // If we found a proper exception handler, set current pc as
             // handlerPC of this exception table item;
             op = exceptTab[i].handlerPC - 1;
             return true;
         }
-        if (exceptTab[i].catchType == 0) {
-            op = exceptTab[i].handlerPC - 1;
-            return true;
-        }
     }
 
     return false;
 }
 
-JObject *Interpreter::execNew(const JavaClass *jc, u2 index) {
-    runtime.cs->linkClassIfAbsent(const_cast<JavaClass *>(jc)->getClassName());
-    runtime.cs->initClassIfAbsent(*this,
-                              const_cast<JavaClass *>(jc)->getClassName());
+JObject *Interpreter::execNew(const JavaClass *jc, u2 index,
+                              ResolvedRef &classRef) {
+    if (thread.resolution->markInitialized(jc)) {
+        runtime.cs->linkClassIfAbsent(
+            const_cast<JavaClass *>(jc)->getClassName());
+        runtime.cs->initClassIfAbsent(
+            *this, const_cast<JavaClass *>(jc)->getClassName());
+    }
 
-    if (typeid(*jc->raw.constPoolInfo[index]) != typeid(CONSTANT_Class)) {
-        throw runtime_error(
-            "operand index of new is not a class or "
-            "interface\n");
+    if (!classRef.isResolved()) {
+        if (typeid(*jc->raw.constPoolInfo[index]) != typeid(CONSTANT_Class)) {
+            throw runtime_error(
+                "operand index of new is not a class or "
+                "interface\n");
+        }
+        string className = jc->getString(
+            dynamic_cast<CONSTANT_Class *>(jc->raw.constPoolInfo[index])
+                ->nameIndex);
+        classRef.resolve(
+            SymbolicRef{runtime.cs->loadClassIfAbsent(className)});
+    }
+    return runtime.heap->createObject(*classRef.jc, currentAllocationSite());
+}
+
+JType **Interpreter::resolveStaticField(const JavaClass *jc, u2 index,
+                                        ResolvedRef &fieldRef) {
+    if (fieldRef.staticSlot == nullptr) {
+        if (!fieldRef.isResolved()) {
+            fieldRef.resolve(parseFieldSymbolicReference(jc, index));
+        }
+        runtime.cs->linkClassIfAbsent(fieldRef.jc->getClassName());
+        runtime.cs->initClassIfAbsent(*this, fieldRef.jc->getClassName());
+        fieldRef.staticSlot =
+            fieldRef.jc->getStaticVarSlot(fieldRef.name, fieldRef.descriptor);
+    }
+    return fieldRef.staticSlot;
+}
+
+size_t Interpreter::resolveInstanceField(const JavaClass *jc, u2 index,
+                                         ResolvedRef &fieldRef,
+                                         const JObject *object) {
+    if (object == nullptr) {
+        throw runtime_error("null pointer");
+    }
+    if (fieldRef.receiver != object->jc) {
+        if (!fieldRef.isResolved()) {
+            fieldRef.resolve(parseFieldSymbolicReference(jc, index));
+        }
+        fieldRef.receiver = object->jc;
+        fieldRef.fieldSlot = JavaHeap::fieldSlotOf(
+            fieldRef.jc, object->jc, fieldRef.name, fieldRef.descriptor);
     }
-    string className = jc->getString(
-        dynamic_cast<CONSTANT_Class *>(jc->raw.constPoolInfo[index])
-            ->nameIndex);
-    JavaClass *newClass = runtime.cs->loadClassIfAbsent(className);
-    return runtime.heap->createObject(*newClass);
+    return fieldRef.fieldSlot;
+}
+
+AllocationSite *Interpreter::currentAllocationSite() {
+    Slots *frame = frames->top();
+    return runtime.gc->getPretenuring().siteOf(frame->method, frame->bci);
 }
 
 bool Interpreter::checkInstanceof(const JavaClass *jc, u2 index,
@@ -1647,6 +1850,7 @@ void Interpreter::invokeByName(JavaClass *jc, const string &name,
     }
 
     frames->pushFrame(csite.maxLocal, csite.maxStack);
+    frames->top()->setMethod(csite.jc, csite.method);
 
     JType *returnValue{};
     if (IS_METHOD_NATIVE(m->accessFlags)) {
@@ -1672,48 +1876,66 @@ void Interpreter::invokeByName(JavaClass *jc, const string &name,
         exception.printStackTrace();
     }
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
+    SAFEPOINT_POLL();
+}
+// Return the method which was selected for the class last time, otherwise
+// select it by given selector and remember it in the resolved reference
+template <typename Selector>
+static CallSite selectMethod(const JavaClass *jc, ResolvedRef *site,
+                             Selector select) {
+    if (site != nullptr && site->receiver == jc) {
+        return site->target;
+    }
+    CallSite csite = select();
+    if (site != nullptr) {
+        site->receiver = jc;
+        site->target = csite;
     }
+    return csite;
 }
 //--------------------------------------------------------------------------------
 // Invoke interface method
 //--------------------------------------------------------------------------------
 void Interpreter::invokeInterface(const JavaClass *jc, const string &name,
-                                  const string &descriptor) {
+                                  const string &descriptor, ResolvedRef *site) {
     auto parameterAndReturnType = peelMethodParameterAndType(descriptor);
     const int returnType = get<0>(parameterAndReturnType);
     auto parameter = get<1>(parameterAndReturnType);
 
-    auto csite = findInstanceMethod(jc, name, descriptor);
-    if (!csite.isCallable()) {
-        csite = findInstanceMethodOnSupers(jc, name, descriptor);
+    // Interface method is selected by class of the receiver rather than the
+    // interface which declares it
+    auto *thisRef =
+        (JObject *)frames->top()
+            ->stackSlots[frames->top()->stackTop - parameter.size() - 1];
+    if (thisRef == nullptr) {
+        throw runtime_error("null pointer");
+    }
+    jc = thisRef->jc;
+
+    auto csite = selectMethod(jc, site, [&]() -> CallSite {
+        auto csite = findInstanceMethod(jc, name, descriptor);
         if (!csite.isCallable()) {
-            csite = findMaximallySpecifiedMethod(jc, name, descriptor);
+            csite = findInstanceMethodOnSupers(jc, name, descriptor);
             if (!csite.isCallable()) {
-                throw runtime_error("can not find method " + name + " " +
-                                    descriptor);
+                csite = findMaximallySpecifiedMethod(jc, name, descriptor);
+                if (!csite.isCallable()) {
+                    throw runtime_error("can not find method " + name + " " +
+                                        descriptor);
+                }
             }
         }
-    }
+        return csite;
+    });
 
     if (IS_METHOD_NATIVE(csite.accessFlags)) {
         csite.maxLocal = csite.maxStack = parameter.size() + 1;
     }
     frames->pushFrame(csite.maxLocal, csite.maxStack);
+    frames->top()->setMethod(csite.jc, csite.method);
     pushMethodArguments(parameter, true);
 
     JType *returnValue{};
-    if (IS_METHOD_NATIVE(csite.accessFlags)) {
-        returnValue = cloneValue(
-            execNativeMethod(csite.jc->getClassName(), name, descriptor));
-    } else {
-        returnValue =
-            cloneValue(execByteCode(csite.jc, csite.code, csite.codeLength,
-                                    csite.exceptionLen, csite.exception));
-    }
+    returnValue = cloneValue(execMethod(csite, name, descriptor));
     frames->popFrame();
 
     if (returnType != T_EXTRA_VOID) {
@@ -1727,17 +1949,14 @@ void Interpreter::invokeInterface(const JavaClass *jc, const string &name,
         }
     }
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
-    }
+    SAFEPOINT_POLL();
 }
 
 //--------------------------------------------------------------------------------
 // Invoke instance method; dispatch based on class
 //--------------------------------------------------------------------------------
-void Interpreter::invokeVirtual(const string &name, const string &descriptor) {
+void Interpreter::invokeVirtual(const string &name, const string &descriptor,
+                                ResolvedRef *site) {
     auto parameterAndReturnType = peelMethodParameterAndType(descriptor);
     const int returnType = get<0>(parameterAndReturnType);
     auto parameter = get<1>(parameterAndReturnType);
@@ -1745,35 +1964,36 @@ void Interpreter::invokeVirtual(const string &name, const string &descriptor) {
     auto *thisRef =
         (JObject *)frames->top()
             ->stackSlots[frames->top()->stackTop - parameter.size() - 1];
+    if (thisRef == nullptr) {
+        throw runtime_error("null pointer");
+    }
 
-    auto csite = findInstanceMethod(thisRef->jc, name, descriptor);
-    if (!csite.isCallable()) {
-        csite = findInstanceMethodOnSupers(thisRef->jc, name, descriptor);
+    auto csite = selectMethod(thisRef->jc, site, [&]() -> CallSite {
+        auto csite = findInstanceMethod(thisRef->jc, name, descriptor);
         if (!csite.isCallable()) {
-            csite = findMaximallySpecifiedMethod(thisRef->jc, name, descriptor);
+            csite = findInstanceMethodOnSupers(thisRef->jc, name, descriptor);
             if (!csite.isCallable()) {
-                throw runtime_error("can not find method " + name + " " +
-                                    descriptor);
+                csite = findMaximallySpecifiedMethod(thisRef->jc, name,
+                                                     descriptor);
+                if (!csite.isCallable()) {
+                    throw runtime_error("can not find method " + name + " " +
+                                        descriptor);
+                }
             }
         }
-    }
+        return csite;
+    });
 
     if (IS_METHOD_NATIVE(csite.accessFlags)) {
         csite.maxLocal = csite.maxStack = parameter.size() + 1;
     }
 
     frames->pushFrame(csite.maxLocal, csite.maxStack);
+    frames->top()->setMethod(csite.jc, csite.method);
     pushMethodArguments(parameter, true);
     JType *returnValue{};
     if (csite.isCallable()) {
-        if (IS_METHOD_NATIVE(csite.accessFlags)) {
-            returnValue = cloneValue(
-                execNativeMethod(csite.jc->getClassName(), name, descriptor));
-        } else {
-            returnValue =
-                cloneValue(execByteCode(csite.jc, csite.code, csite.codeLength,
-                                        csite.exceptionLen, csite.exception));
-        }
+        returnValue = cloneValue(execMethod(csite, name, descriptor));
     } else {
         throw runtime_error("can not find method to call");
     }
@@ -1790,51 +2010,44 @@ void Interpreter::invokeVirtual(const string &name, const string &descriptor) {
         }
     }
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
-    }
+    SAFEPOINT_POLL();
 }
 //--------------------------------------------------------------------------------
 //  Invoke instance method; special handling for superclass, private,
 //  and instance initialization method invocations
 //--------------------------------------------------------------------------------
 void Interpreter::invokeSpecial(const JavaClass *jc, const string &name,
-                                const string &descriptor) {
+                                const string &descriptor, ResolvedRef *site) {
     auto parameterAndReturnType = peelMethodParameterAndType(descriptor);
     const int returnType = get<0>(parameterAndReturnType);
     auto parameter = get<1>(parameterAndReturnType);
 
-    auto csite = findInstanceMethod(jc, name, descriptor);
-    if (!csite.isCallable()) {
-        csite = findInstanceMethodOnSupers(jc, name, descriptor);
+    auto csite = selectMethod(jc, site, [&]() -> CallSite {
+        auto csite = findInstanceMethod(jc, name, descriptor);
         if (!csite.isCallable()) {
-            csite = findJavaLangObjectMethod(jc, name, descriptor);
+            csite = findInstanceMethodOnSupers(jc, name, descriptor);
             if (!csite.isCallable()) {
-                csite = findMaximallySpecifiedMethod(jc, name, descriptor);
+                csite = findJavaLangObjectMethod(jc, name, descriptor);
                 if (!csite.isCallable()) {
-                    throw runtime_error("can not find method " + name + " " +
-                                        descriptor);
+                    csite = findMaximallySpecifiedMethod(jc, name, descriptor);
+                    if (!csite.isCallable()) {
+                        throw runtime_error("can not find method " + name +
+                                            " " + descriptor);
+                    }
                 }
             }
         }
-    }
+        return csite;
+    });
     if (IS_METHOD_NATIVE(csite.accessFlags)) {
         csite.maxLocal = csite.maxStack = parameter.size() + 1;
     }
     frames->pushFrame(csite.maxLocal, csite.maxStack);
+    frames->top()->setMethod(csite.jc, csite.method);
     pushMethodArguments(parameter, true);
     JType *returnValue{};
 
-    if (IS_METHOD_NATIVE(csite.accessFlags)) {
-        returnValue = cloneValue(
-            execNativeMethod(csite.jc->getClassName(), name, descriptor));
-    } else {
-        returnValue =
-            cloneValue(execByteCode(csite.jc, csite.code, csite.codeLength,
-                                    csite.exceptionLen, csite.exception));
-    }
+    returnValue = cloneValue(execMethod(csite, name, descriptor));
     frames->popFrame();
     if (returnType != T_EXTRA_VOID) {
         frames->top()->push(returnValue);
@@ -1847,27 +2060,28 @@ void Interpreter::invokeSpecial(const JavaClass *jc, const string &name,
         }
     }
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
-    }
+    SAFEPOINT_POLL();
 }
 
 void Interpreter::invokeStatic(const JavaClass *jc, const string &name,
-                               const string &descriptor) {
+                               const string &descriptor, ResolvedRef *site) {
     // Get instance method name and descriptor from CONSTANT_Methodref
     // locating by index and get interface method parameter and return value
     // descriptor
-    runtime.cs->linkClassIfAbsent(const_cast<JavaClass *>(jc)->getClassName());
-    runtime.cs->initClassIfAbsent(*this,
-                              const_cast<JavaClass *>(jc)->getClassName());
+    if (thread.resolution->markInitialized(jc)) {
+        runtime.cs->linkClassIfAbsent(
+            const_cast<JavaClass *>(jc)->getClassName());
+        runtime.cs->initClassIfAbsent(
+            *this, const_cast<JavaClass *>(jc)->getClassName());
+    }
 
     auto parameterAndReturnType = peelMethodParameterAndType(descriptor);
     const int returnType = get<0>(parameterAndReturnType);
     auto parameter = get<1>(parameterAndReturnType);
 
-    auto csite = CallSite::makeCallSite(jc, jc->findMethod(name, descriptor));
+    auto csite = selectMethod(jc, site, [&]() -> CallSite {
+        return CallSite::makeCallSite(jc, jc->findMethod(name, descriptor));
+    });
     if (!csite.isCallable()) {
         throw runtime_error("can not find method " + name + " " + descriptor);
     }
@@ -1879,16 +2093,10 @@ void Interpreter::invokeStatic(const JavaClass *jc, const string &name,
         csite.maxLocal = csite.maxStack = parameter.size();
     }
     frames->pushFrame(csite.maxLocal, csite.maxStack);
+    frames->top()->setMethod(csite.jc, csite.method);
     pushMethodArguments(parameter, false);
     JType *returnValue{};
-    if (IS_METHOD_NATIVE(csite.accessFlags)) {
-        returnValue = cloneValue(
-            execNativeMethod(csite.jc->getClassName(), name, descriptor));
-    } else {
-        returnValue =
-            cloneValue(execByteCode(csite.jc, csite.code, csite.codeLength,
-                                    csite.exceptionLen, csite.exception));
-    }
+    returnValue = cloneValue(execMethod(csite, name, descriptor));
     frames->popFrame();
 
     if (returnType != T_EXTRA_VOID) {
@@ -1902,9 +2110,5 @@ void Interpreter::invokeStatic(const JavaClass *jc, const string &name,
         }
     }
 
-    GC_SAFE_POINT
-    if (runtime.gc->shallGC()) {
-        runtime.gc->stopTheWorld();
-        runtime.gc->gc(frames, GCPolicy::GC_MARK_AND_SWEEP);
-    }
+    SAFEPOINT_POLL();
 }
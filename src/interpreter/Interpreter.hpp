@@ -24,46 +24,84 @@
 #ifndef YVM_INTERPRETER_H
 #define YVM_INTERPRETER_H
 
+#include <cmath>
 #include <typeinfo>
 #include "../classfile/ClassFile.h"
 #include "../runtime/JavaException.h"
 #include "../runtime/JavaFrame.hpp"
 #include "../runtime/JavaHeap.hpp"
+#include "../runtime/JavaThread.h"
 #include "../runtime/JavaType.h"
 #include "../runtime/RuntimeEnv.h"
 
 #pragma warning(disable : 4244)
 
+struct CallSite;
 struct MethodInfo;
+struct ResolvedRef;
 struct RuntimeEnv;
 extern RuntimeEnv runtime;
 using std::string;
 class Interpreter {
 public:
-    explicit Interpreter() : frames(new JavaFrame) {}
+    explicit Interpreter() : Interpreter(new JavaFrame) {}
 
-    explicit Interpreter(JavaFrame* frames) : frames(frames) {}
+    explicit Interpreter(JavaFrame* frames);
+
+    // Interpreter of a thread started by Thread.start(), see runThread()
+    explicit Interpreter(JObject* threadObject) : Interpreter() {
+        thread.threadObject = threadObject;
+    }
 
     ~Interpreter();
 
+    JavaThread* getThread() { return &thread; }
+
+    // Execute Thread.run() of the thread object, then terminate the thread by
+    // Thread.exit() which wakes up threads joining it
+    void runThread();
+
     void invokeByName(JavaClass* jc, const string& name,
                       const string& descriptor);
+    // Invoked method is selected by class of receiver and symbolic reference
+    // of the method. If the resolved reference of invoking instruction is
+    // given, the selection is remembered there and reused for the same class
     void invokeInterface(const JavaClass* jc, const string& name,
-                         const string& descriptor);
+                         const string& descriptor,
+                         ResolvedRef* site = nullptr);
     void invokeSpecial(const JavaClass* jc, const string& name,
-                       const string& descriptor);
+                       const string& descriptor, ResolvedRef* site = nullptr);
     void invokeStatic(const JavaClass* jc, const string& name,
-                      const string& descriptor);
-    void invokeVirtual(const string& name, const string& descriptor);
+                      const string& descriptor, ResolvedRef* site = nullptr);
+    void invokeVirtual(const string& name, const string& descriptor,
+                       ResolvedRef* site = nullptr);
 
 private:
     bool checkInstanceof(const JavaClass* jc, u2 index, JType* objectref);
 
-    JObject* execNew(const JavaClass* jc, u2 index);
+    JObject* execNew(const JavaClass* jc, u2 index, ResolvedRef& classRef);
+    // Slot of the static field referred by the constant pool entry, its class
+    // is linked and initialized when it's resolved by this thread
+    JType** resolveStaticField(const JavaClass* jc, u2 index,
+                               ResolvedRef& fieldRef);
+    // Slot of the instance field referred by the constant pool entry in the
+    // object, which is looked up once for each class of receiver
+    size_t resolveInstanceField(const JavaClass* jc, u2 index,
+                                ResolvedRef& fieldRef, const JObject* object);
+    // Allocation site of the executing bytecode, or nullptr if pretenuring
+    // is disabled
+    AllocationSite* currentAllocationSite();
     JType* execByteCode(const JavaClass* jc, u1* code, u4 codeLength,
                         u2 exceptLen, ExceptionTable* exceptTab);
     JType* execNativeMethod(const string& className, const string& methodName,
                             const string& methodDescriptor);
+    // Execute the method whose frame has been pushed. Monitor of synchronized
+    // instance method is held until the method returns or completes
+    // abruptly; there are no class objects for static ones to lock on
+    JType* execMethod(const CallSite& csite, const string& name,
+                      const string& descriptor);
+    void enterMonitor(JType* ref);
+    void exitMonitor(JType* ref);
 
     void loadConstantPoolItem2Stack(const JavaClass* jc, u2 index);
 
@@ -89,6 +127,7 @@ private:
 private:
     JavaFrame* frames;
     JavaException exception;
+    JavaThread thread;
 };
 
 template <typename ResultType, typename CallableObjectType>
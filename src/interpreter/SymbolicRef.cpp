@@ -81,3 +81,14 @@ SymbolicRef parseClassSymbolicReference(const JavaClass *jc, u2 index) {
     runtime.cs->linkClassIfAbsent(className);
     return SymbolicRef{c};
 }
+
+ResolvedRef *ResolutionCache::entriesOf(const JavaClass *jc) {
+    auto iter = entries.find(jc);
+    if (iter == entries.end()) {
+        iter = entries
+                   .emplace(jc, std::vector<ResolvedRef>(
+                                    jc->getConstPoolCount()))
+                   .first;
+    }
+    return iter->second.data();
+}
@@ -25,7 +25,11 @@
 #define _SYMBOLIC_REFERENCE_H
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include "../runtime/JavaClass.h"
+#include "CallSite.h"
 
 struct SymbolicRef {
     explicit SymbolicRef() : jc(nullptr) {}
@@ -48,4 +52,40 @@ SymbolicRef parseMethodSymbolicReference(const JavaClass* jc, u2 index);
 
 SymbolicRef parseClassSymbolicReference(const JavaClass* jc, u2 index);
 
+//--------------------------------------------------------------------------------
+// Symbolic reference which has been resolved by a thread, along with what the
+// instruction referring to it selected for the receiver class it saw last.
+// Every thread keeps its own copies, so they are read and updated without
+// any lock
+//--------------------------------------------------------------------------------
+struct ResolvedRef : public SymbolicRef {
+    bool isResolved() const { return jc != nullptr; }
+    void resolve(const SymbolicRef& ref) { SymbolicRef::operator=(ref); }
+
+    const JavaClass* receiver = nullptr;
+    // Slot of instance field in objects of receiver class
+    size_t fieldSlot = 0;
+    // Method selected for receiver class
+    CallSite target;
+    // Slot of static field, which is available after its class has been
+    // initialized
+    JType** staticSlot = nullptr;
+};
+
+class ResolutionCache {
+public:
+    // Resolved references of the class indexed by constant pool index, they
+    // remain valid as long as the cache
+    ResolvedRef* entriesOf(const JavaClass* jc);
+    // Return true if the class was not marked by this thread yet, so that
+    // the thread asks class space to link and initialize it only once
+    bool markInitialized(const JavaClass* jc) {
+        return initialized.insert(jc).second;
+    }
+
+private:
+    std::unordered_map<const JavaClass*, std::vector<ResolvedRef>> entries;
+    std::unordered_set<const JavaClass*> initialized;
+};
+
 #endif
@@ -23,27 +23,36 @@
 
 #include "NativeMethod.h"
 
+#include <chrono>
 #include <future>
 #include <iostream>
+#include <limits>
 #include <random>
 #include <string>
 
+#include "../gc/GC.h"
+#include "../gc/HeapInspector.h"
 #include "../runtime/ClassSpace.h"
 #include "../runtime/JavaClass.h"
 #include "../runtime/JavaHeap.hpp"
+#include "../runtime/JavaThread.h"
+#include "../runtime/Safepoint.h"
+#include "../runtime/Synchronizer.h"
+#include "../runtime/VirtualThread.h"
 #include "../vm/YVM.h"
 
-JType* ydk_lang_IO_print_str(RuntimeEnv* env, JType** args, int numArgs) {
+JType* ydk_lang_IO_print_str(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs) {
     JObject* str = (JObject*)args[0];
     if (nullptr != str) {
         auto fields = env->heap->getFields(str);
         JArray* chararr = (JArray*)fields[0];
-        auto lengthAndData = env->heap->getElements(chararr);
-        char* s = new char[lengthAndData.first + 1];
-        for (int i = 0; i < lengthAndData.first; i++) {
-            s[i] = (char)((JInt*)lengthAndData.second[i])->val;
+        auto& lengthAndData = env->heap->getElements(chararr);
+        char* s = new char[lengthAndData.length + 1];
+        for (int i = 0; i < lengthAndData.length; i++) {
+            s[i] = (char)((JInt*)lengthAndData.items[i])->val;
         }
-        s[lengthAndData.first] = '\0';
+        s[lengthAndData.length] = '\0';
         std::cout << s;
         delete[] s;
     } else {
@@ -53,26 +62,153 @@ JType* ydk_lang_IO_print_str(RuntimeEnv* env, JType** args, int numArgs) {
     return nullptr;
 }
 
-JType* ydk_lang_IO_print_I(RuntimeEnv* env, JType** args, int numArgs) {
+JType* ydk_lang_IO_print_I(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs) {
     JInt* num = (JInt*)args[0];
     std::cout << num->val;
     return nullptr;
 }
 
-JType* ydk_lang_IO_print_C(RuntimeEnv* env, JType** args, int numArgs) {
+JType* ydk_lang_IO_print_C(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs) {
     JInt* num = (JInt*)args[0];
     std::cout << (char)num->val;
     return nullptr;
 }
 
-JType* java_lang_Math_random(RuntimeEnv* env, JType** args, int numArgs) {
+JType* ydk_lang_Diagnostics_printHeapHistogram(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs) {
+    env->safepoint->execute(self, []() -> void {
+        HeapInspector::printHistogram(stdout);
+    });
+    return nullptr;
+}
+
+JType* ydk_lang_Diagnostics_dumpHeap(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    // Path is copied out of java heap since records may be moved at safepoint
+    const std::string path = javastring2stdtring((JObject*)args[0]);
+    bool succeeded = false;
+    env->safepoint->execute(self, [&]() -> void {
+        succeeded = HeapInspector::dumpHeap(path);
+    });
+    return new JInt(succeeded ? 1 : 0);
+}
+
+JType* ydk_lang_GCStats_getCollectionCount(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    return new JLong(env->gc->getCollectionCount());
+}
+
+JType* ydk_lang_GCStats_getTotalPauseNanos(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    return new JLong(env->gc->getTotalPauseNanos());
+}
+
+JType* ydk_lang_GCStats_getBytesReclaimed(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return new JLong(env->gc->getBytesReclaimed());
+}
+
+JType* java_lang_Math_random(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs) {
     std::default_random_engine dre;
     std::uniform_int_distribution<int> realD;
     return new JDouble(realD(dre));
 }
 
-JType* java_lang_stringbuilder_append_I(RuntimeEnv* env, JType** args,
-                                        int numArgs) {
+JType* java_lang_System_gc(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs) {
+    // Collection is performed by the same safepoint right after the operation,
+    // and execute() returns once it's done
+    env->safepoint->execute(self, [env]() -> void {
+        env->gc->collectAtSafepoint(GCCause::SYSTEM_GC);
+    });
+    return nullptr;
+}
+
+JType* java_lang_System_currentTimeMillis(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return new JLong(chrono::duration_cast<chrono::milliseconds>(
+                         chrono::system_clock::now().time_since_epoch())
+                         .count());
+}
+
+//--------------------------------------------------------------------------------
+// Heap of yvm has no fixed capacity, a collection is triggered whenever the
+// allocated bytes reach GC threshold. Therefore free memory is the bytes which
+// can be allocated before the next collection, total memory is used bytes plus
+// free memory, and max memory is unlimited.
+//--------------------------------------------------------------------------------
+JType* java_lang_Runtime_totalMemory(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    return new JLong(env->heap->getUsedBytes() + env->gc->getBytesUntilGC());
+}
+
+JType* java_lang_Runtime_freeMemory(RuntimeEnv* env, JavaThread* self,
+                                    JType** args, int numArgs) {
+    return new JLong(env->gc->getBytesUntilGC());
+}
+
+JType* java_lang_Runtime_maxMemory(RuntimeEnv* env, JavaThread* self,
+                                   JType** args, int numArgs) {
+    return new JLong(std::numeric_limits<int64_t>::max());
+}
+
+// The exception is raised by interpreter after the native method returns,
+// its detail message is left null
+static void throwException(RuntimeEnv* env, JavaThread* self,
+                           const char* className) {
+    auto* jc = env->cs->loadClassIfAbsent(className);
+    env->cs->linkClassIfAbsent(className);
+    self->pendingException = env->heap->createObject(*jc);
+}
+
+//--------------------------------------------------------------------------------
+// Waiting needs a wait set, so thin lock of the object is inflated first. The
+// interrupt status is cleared when InterruptedException is thrown
+//--------------------------------------------------------------------------------
+JType* java_lang_Object_wait(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs) {
+    const int64_t timeoutMillis = dynamic_cast<JLong*>(args[1])->val;
+    if (timeoutMillis < 0) {
+        throw runtime_error("timeout value is negative");
+    }
+    auto* monitor = env->heap->ownedMonitor(args[0], self->lockId, true);
+    if (!self->interrupted) {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        monitor->wait(self, timeoutMillis);
+    }
+    if (self->interrupted.exchange(false)) {
+        throwException(env, self, "java/lang/InterruptedException");
+    }
+    return nullptr;
+}
+
+// Nobody could wait on a thin lock, notifying it does nothing
+JType* java_lang_Object_notify(RuntimeEnv* env, JavaThread* self, JType** args,
+                               int numArgs) {
+    const uintptr_t lockId = self->lockId;
+    auto* monitor = env->heap->ownedMonitor(args[0], lockId, false);
+    if (monitor != nullptr) {
+        monitor->notify(lockId);
+    }
+    return nullptr;
+}
+
+JType* java_lang_Object_notifyAll(RuntimeEnv* env, JavaThread* self,
+                                  JType** args, int numArgs) {
+    const uintptr_t lockId = self->lockId;
+    auto* monitor = env->heap->ownedMonitor(args[0], lockId, false);
+    if (monitor != nullptr) {
+        monitor->notifyAll(lockId);
+    }
+    return nullptr;
+}
+
+JType* java_lang_stringbuilder_append_I(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
     JObject* caller = (JObject*)args[0];
     JInt* numParameter = (JInt*)args[1];
     std::string str{};
@@ -92,16 +228,11 @@ JType* java_lang_stringbuilder_append_I(RuntimeEnv* env, JType** args,
     JArray* newArr = env->heap->createCharArray(str, str.length());
     env->heap->putFieldByOffset(*caller, 0, newArr);
 
-    // remove old lhs string since new str overlapped it
-    if (arr != nullptr) {
-        env->heap->removeArray(arr->offset);
-    }
-
     return caller;
 }
 
-JType* java_lang_stringbuilder_append_C(RuntimeEnv* env, JType** args,
-                                        int numArgs) {
+JType* java_lang_stringbuilder_append_C(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
     JObject* caller = (JObject*)args[0];
     JInt* numParameter = (JInt*)args[1];
     std::string str{};
@@ -118,14 +249,11 @@ JType* java_lang_stringbuilder_append_C(RuntimeEnv* env, JType** args,
     str += c;
     JArray* newArr = env->heap->createCharArray(str, str.length());
     env->heap->putFieldByOffset(*caller, 0, newArr);
-    if (arr != nullptr) {
-        env->heap->removeArray(arr->offset);
-    }
     return caller;
 }
 
-JType* java_lang_stringbuilder_append_str(RuntimeEnv* env, JType** args,
-                                          int numArgs) {
+JType* java_lang_stringbuilder_append_str(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
     JObject* caller = (JObject*)args[0];
     JObject* strParameter = (JObject*)args[1];
     std::string str{};
@@ -147,15 +275,11 @@ JType* java_lang_stringbuilder_append_str(RuntimeEnv* env, JType** args,
 
     JArray* newArr = env->heap->createCharArray(str, str.length());
     env->heap->putFieldByOffset(*caller, 0, newArr);
-
-    if (arr != nullptr) {
-        env->heap->removeArray(arr->offset);
-    }
     return caller;
 }
 
-JType* java_lang_stringbuilder_append_D(RuntimeEnv* env, JType** args,
-                                        int numArgs) {
+JType* java_lang_stringbuilder_append_D(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
     JObject* caller = (JObject*)args[0];
     JDouble* numParameter = (JDouble*)args[1];
     std::string str{};
@@ -171,14 +295,11 @@ JType* java_lang_stringbuilder_append_D(RuntimeEnv* env, JType** args,
     str += std::to_string(numParameter->val);
     JArray* newArr = env->heap->createCharArray(str, str.length());
     env->heap->putFieldByOffset(*caller, 0, newArr);
-    if (arr != nullptr) {
-        env->heap->removeArray(arr->offset);
-    }
     return caller;
 }
 
-JType* java_lang_stringbuilder_tostring(RuntimeEnv* env, JType** args,
-                                        int numArgs) {
+JType* java_lang_stringbuilder_tostring(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
     JObject* caller = (JObject*)args[0];
     JArray* value =
         dynamic_cast<JArray*>(env->heap->getFieldByOffset(*caller, 0));
@@ -196,35 +317,750 @@ JType* java_lang_stringbuilder_tostring(RuntimeEnv* env, JType** args,
     return str;
 }
 
-JType* java_lang_thread_start(RuntimeEnv* env, JType** args, int numArgs) {
+//--------------------------------------------------------------------------------
+// Every java thread runs on its own native thread, which terminates together
+// with the java thread. Thread.exit() wakes up threads joining it when run()
+// returns
+//--------------------------------------------------------------------------------
+JType* java_lang_thread_start(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs) {
+    auto* threadClass = runtime.cs->findJavaClass("java/lang/Thread");
     auto* caller = (JObject*)args[0];
-    auto* runnableTask = (JObject*)cloneValue(dynamic_cast<JObject*>(
-        env->heap->getFieldByName(
-            runtime.cs->findJavaClass("java/lang/Thread"),
-                                   "task", "Ljava/lang/Runnable;", caller)));
+    if (dynamic_cast<JLong*>(env->heap->getFieldByName(threadClass, "tid", "J",
+                                                       caller))
+            ->val != 0) {
+        throw runtime_error("thread is already started");
+    }
+    // Thread object is only referenced by native code before new thread is
+    // attached, so we must keep it alive explicitly
+    auto* threadObject = (JObject*)cloneValue(caller);
+    env->gc->addRoot(threadObject);
+    // It's alive until Thread.exit(), which can't run before start() returns
+    // since both of them are synchronized
+    env->heap->putFieldByName(threadClass, "alive", "Z", caller, new JInt(1));
+    // Lock id of new thread is its thread id, which is published once the
+    // thread has been attached, so that it can be interrupted right after
+    // start() returns
+    auto started = make_shared<promise<uintptr_t>>();
 
-    YVM::executor.createThread();
-    future<void> subThreadF = YVM::executor.submit([=]() {
+    runtime.threads->spawn([=]() -> void {
 #ifdef YVM_DEBUG_SHOW_THREAD_NAME
         std::cout << "[New Java Thread] ID:" << std::this_thread::get_id()
                   << "\n";
 #endif
-        const std::string& name = runnableTask->jc->getClassName();
-        auto* jc = runtime.cs->loadClassIfAbsent(name);
-        runtime.cs->linkClassIfAbsent(name);
         // For each execution thread, we have a code execution engine
-        auto* frame = new JavaFrame;
-        frame->pushFrame(1, 1);
-        frame->top()->push(runnableTask);
-        Interpreter exec{frame};
+        Interpreter exec{threadObject};
+        started->set_value(exec.getThread()->lockId);
+        exec.runThread();
+    });
 
-        runtime.cs->initClassIfAbsent(exec, name);
-        // Push object reference and since Runnable.run() has no parameter, so
-        // we dont need to push arguments since Runnable.run() has no parameter
+    uintptr_t tid = 0;
+    {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        tid = started->get_future().get();
+    }
+    env->gc->removeRoot(threadObject);
+    env->heap->putFieldByName(threadClass, "tid", "J", caller,
+                              new JLong(static_cast<int64_t>(tid)));
+    return nullptr;
+}
 
-        exec.invokeInterface(jc, "run", "()V");
+// Virtual thread is attached by its starter, so that its lock id is known
+// without waiting for a carrier to mount it
+JType* java_lang_Thread_startVirtual(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    auto* threadClass = runtime.cs->findJavaClass("java/lang/Thread");
+    auto* caller = (JObject*)args[0];
+    if (dynamic_cast<JLong*>(env->heap->getFieldByName(threadClass, "tid", "J",
+                                                       caller))
+            ->val != 0) {
+        throw runtime_error("thread is already started");
+    }
+    auto* threadObject = (JObject*)cloneValue(caller);
+    env->gc->addRoot(threadObject);
+    Interpreter* exec = nullptr;
+    {
+        // Attaching a thread waits for the ongoing safepoint, if any
+        ThreadBlockedScope blocked(env->safepoint, self);
+        exec = new Interpreter(threadObject);
+        env->safepoint->enterBlocked(exec->getThread());
+    }
+    env->gc->removeRoot(threadObject);
+    env->heap->putFieldByName(threadClass, "alive", "Z", caller, new JInt(1));
+    env->heap->putFieldByName(threadClass, "virtual", "Z", caller,
+                              new JInt(1));
+    env->heap->putFieldByName(
+        threadClass, "tid", "J", caller,
+        new JLong(static_cast<int64_t>(exec->getThread()->lockId)));
+    env->scheduler->start(exec->getThread(), [exec]() -> void {
+        exec->runThread();
+        delete exec;
     });
-    YVM::executor.storeTaskFuture(subThreadF.share());
+    return nullptr;
+}
+
+JType* java_lang_Thread_currentThread(RuntimeEnv* env, JavaThread* self,
+                                      JType** args, int numArgs) {
+    if (self->threadObject == nullptr) {
+        auto* threadClass = runtime.cs->findJavaClass("java/lang/Thread");
+        auto* threadObject = env->heap->createObject(*threadClass);
+        env->heap->putFieldByName(
+            threadClass, "tid", "J", threadObject,
+            new JLong(static_cast<int64_t>(self->lockId)));
+        env->heap->putFieldByName(threadClass, "alive", "Z", threadObject,
+                                  new JInt(1));
+        self->threadObject = threadObject;
+    }
+    return self->threadObject;
+}
+
+// Sleeping thread parks on its permit, so it's woken up by interrupt()
+JType* java_lang_Thread_sleep(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs) {
+    const int64_t millis = dynamic_cast<JLong*>(args[0])->val;
+    if (millis < 0) {
+        throw runtime_error("timeout value is negative");
+    }
+    {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        const auto deadline =
+            chrono::steady_clock::now() + chrono::milliseconds(millis);
+        while (!self->interrupted) {
+            const chrono::nanoseconds remaining =
+                deadline - chrono::steady_clock::now();
+            if (remaining.count() <= 0) {
+                break;
+            }
+            self->park(&remaining);
+        }
+    }
+    if (self->interrupted.exchange(false)) {
+        throwException(env, self, "java/lang/InterruptedException");
+    }
+    return nullptr;
+}
+
+JType* java_lang_Thread_yield(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs) {
+    self->yield();
+    return nullptr;
+}
+
+static uintptr_t tidOf(RuntimeEnv* env, JObject* thread) {
+    auto* tid = dynamic_cast<JLong*>(env->heap->getFieldByName(
+        runtime.cs->findJavaClass("java/lang/Thread"), "tid", "J", thread));
+    return tid != nullptr ? static_cast<uintptr_t>(tid->val) : 0;
+}
+
+// Interrupting a thread which is not alive does nothing
+JType* java_lang_Thread_interrupt(RuntimeEnv* env, JavaThread* self,
+                                  JType** args, int numArgs) {
+    env->threads->interrupt(tidOf(env, (JObject*)args[0]));
+    return nullptr;
+}
+
+JType* java_lang_Thread_isInterrupted(RuntimeEnv* env, JavaThread* self,
+                                      JType** args, int numArgs) {
+    return new JInt(env->threads->isInterrupted(tidOf(env, (JObject*)args[0]))
+                        ? 1
+                        : 0);
+}
+
+// Test and clear interrupt status of the current thread
+JType* java_lang_Thread_interrupted(RuntimeEnv* env, JavaThread* self,
+                                    JType** args, int numArgs) {
+    return new JInt(self->interrupted.exchange(false) ? 1 : 0);
+}
+
+//--------------------------------------------------------------------------------
+// LockSupport parks the calling thread on its own permit, which is shared with
+// monitors and synchronizers, so parking may return spuriously
+//--------------------------------------------------------------------------------
+JType* ydk_concurrent_LockSupport_park(RuntimeEnv* env, JavaThread* self,
+                                       JType** args, int numArgs) {
+    // Parking returns immediately if the thread has been interrupted, the
+    // interrupt status is not cleared
+    if (!self->interrupted) {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        self->park();
+    }
+    return nullptr;
+}
+
+JType* ydk_concurrent_LockSupport_parkNanos(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs) {
+    const chrono::nanoseconds timeout(dynamic_cast<JLong*>(args[0])->val);
+    if (timeout.count() > 0 && !self->interrupted) {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        self->park(&timeout);
+    }
+    return nullptr;
+}
+
+// Unparking a thread which is not alive does nothing
+JType* ydk_concurrent_LockSupport_unpark(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs) {
+    if (args[0] != nullptr) {
+        env->threads->unpark(tidOf(env, (JObject*)args[0]));
+    }
+    return nullptr;
+}
+
+//--------------------------------------------------------------------------------
+// Hot paths of ydk.concurrent are natives. A synchronizer is acquired by CAS
+// first, and the thread is blocked for safepoints only if it has to park
+//--------------------------------------------------------------------------------
+// Interruptible acquisition throws InterruptedException right away if the
+// thread has been interrupted, even if the synchronizer is available
+static bool checkInterrupted(RuntimeEnv* env, JavaThread* self) {
+    if (self->interrupted.exchange(false)) {
+        throwException(env, self, "java/lang/InterruptedException");
+        return true;
+    }
+    return false;
+}
+
+// Park on the synchronizer, InterruptedException is thrown and the interrupt
+// status is cleared if the thread is interrupted meanwhile
+template <typename Block>
+static bool blockOn(RuntimeEnv* env, JavaThread* self, Block block) {
+    Synchronizer::Result result;
+    {
+        ThreadBlockedScope blocked(env->safepoint, self);
+        result = block();
+    }
+    if (result == Synchronizer::Result::INTERRUPTED) {
+        self->interrupted = false;
+        throwException(env, self, "java/lang/InterruptedException");
+    }
+    return result == Synchronizer::Result::ACQUIRED;
+}
+
+static chrono::nanoseconds timeoutOf(JType* millis) {
+    return chrono::milliseconds(
+        max<int64_t>(dynamic_cast<JLong*>(millis)->val, 0));
+}
+
+JType* ydk_concurrent_ReentrantLock_init(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs) {
+    env->heap->createSynchronizer(args[0], 0);
+    return nullptr;
+}
+
+JType* ydk_concurrent_ReentrantLock_lock(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    if (!sync->tryLock(self->lockId)) {
+        blockOn(env, self, [=]() { return sync->lock(self, nullptr, false); });
+    }
+    return nullptr;
+}
+
+JType* ydk_concurrent_ReentrantLock_lockInterruptibly(RuntimeEnv* env,
+                                                      JavaThread* self,
+                                                      JType** args,
+                                                      int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    if (!checkInterrupted(env, self) && !sync->tryLock(self->lockId)) {
+        blockOn(env, self, [=]() { return sync->lock(self, nullptr, true); });
+    }
+    return nullptr;
+}
+
+JType* ydk_concurrent_ReentrantLock_tryLock(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    return new JInt(sync->tryLock(self->lockId) ? 1 : 0);
+}
+
+JType* ydk_concurrent_ReentrantLock_tryLock_J(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    const chrono::nanoseconds timeout = timeoutOf(args[1]);
+    const bool acquired =
+        !checkInterrupted(env, self) &&
+        (sync->tryLock(self->lockId) || blockOn(env, self, [&]() {
+             return sync->lock(self, &timeout, true);
+         }));
+    return new JInt(acquired ? 1 : 0);
+}
+
+JType* ydk_concurrent_ReentrantLock_unlock(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    env->heap->findSynchronizer(args[0])->unlock(self->lockId);
+    return nullptr;
+}
+
+JType* ydk_concurrent_ReentrantLock_isHeldByCurrentThread(RuntimeEnv* env,
+                                                          JavaThread* self,
+                                                          JType** args,
+                                                          int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    return new JInt(sync->getHoldCount(self->lockId) != 0 ? 1 : 0);
+}
+
+JType* ydk_concurrent_ReentrantLock_getHoldCount(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    return new JInt(sync->getHoldCount(self->lockId));
+}
+
+JType* ydk_concurrent_CountDownLatch_init(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    const int32_t count = dynamic_cast<JInt*>(args[1])->val;
+    if (count < 0) {
+        throw runtime_error("count is negative");
+    }
+    env->heap->createSynchronizer(args[0], count);
+    return nullptr;
+}
+
+JType* ydk_concurrent_CountDownLatch_await(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    if (!checkInterrupted(env, self) && sync->getState() != 0) {
+        blockOn(env, self, [=]() { return sync->await(self, nullptr); });
+    }
+    return nullptr;
+}
 
+JType* ydk_concurrent_CountDownLatch_await_J(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    const chrono::nanoseconds timeout = timeoutOf(args[1]);
+    const bool released =
+        !checkInterrupted(env, self) &&
+        (sync->getState() == 0 ||
+         blockOn(env, self, [&]() { return sync->await(self, &timeout); }));
+    return new JInt(released ? 1 : 0);
+}
+
+JType* ydk_concurrent_CountDownLatch_countDown(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs) {
+    env->heap->findSynchronizer(args[0])->countDown();
+    return nullptr;
+}
+
+JType* ydk_concurrent_CountDownLatch_getCount(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    return new JLong(env->heap->findSynchronizer(args[0])->getState());
+}
+
+JType* ydk_concurrent_Semaphore_init(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    env->heap->createSynchronizer(args[0], dynamic_cast<JInt*>(args[1])->val);
+    return nullptr;
+}
+
+static int32_t permitsOf(JType* permits) {
+    const int32_t value = dynamic_cast<JInt*>(permits)->val;
+    if (value < 0) {
+        throw runtime_error("permits is negative");
+    }
+    return value;
+}
+
+JType* ydk_concurrent_Semaphore_acquire(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    const int32_t permits = permitsOf(args[1]);
+    if (!checkInterrupted(env, self) && !sync->tryAcquire(permits)) {
+        blockOn(env, self,
+                [=]() { return sync->acquire(self, permits, nullptr); });
+    }
+    return nullptr;
+}
+
+JType* ydk_concurrent_Semaphore_tryAcquire(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    return new JInt(sync->tryAcquire(permitsOf(args[1])) ? 1 : 0);
+}
+
+JType* ydk_concurrent_Semaphore_tryAcquire_IJ(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    auto* sync = env->heap->findSynchronizer(args[0]);
+    const int32_t permits = permitsOf(args[1]);
+    const chrono::nanoseconds timeout = timeoutOf(args[2]);
+    const bool acquired =
+        !checkInterrupted(env, self) &&
+        (sync->tryAcquire(permits) || blockOn(env, self, [&]() {
+             return sync->acquire(self, permits, &timeout);
+         }));
+    return new JInt(acquired ? 1 : 0);
+}
+
+JType* ydk_concurrent_Semaphore_release(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
+    env->heap->findSynchronizer(args[0])->release(permitsOf(args[1]));
+    return nullptr;
+}
+
+JType* ydk_concurrent_Semaphore_availablePermits(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs) {
+    return new JInt(env->heap->findSynchronizer(args[0])->getState());
+}
+
+//--------------------------------------------------------------------------------
+// Atomic classes keep their value in their only field, or in elements of the
+// array held by it. Java code never stores into them, so int and long boxes
+// there are owned by their slots and natives update them in place by atomic
+// operations. References are swapped by CAS and compared by their records.
+//--------------------------------------------------------------------------------
+static const size_t ATOMIC_VALUE_SLOT = 0;
+
+struct AtomicSlot {
+    atomic<JType*>& slot;
+    // Holder of the slot, which is recorded by write barrier
+    bool inArray;
+    size_t holder;
+};
+
+static AtomicSlot atomicFieldOf(RuntimeEnv* env, JType* ref) {
+    auto* object = static_cast<JObject*>(ref);
+    return {env->heap->atomicField(*object, ATOMIC_VALUE_SLOT), false,
+            object->offset};
+}
+
+static AtomicSlot atomicElementOf(RuntimeEnv* env, JType* ref,
+                                  JType* index) {
+    auto* array = static_cast<JArray*>(env->heap->getFieldByOffset(
+        *static_cast<JObject*>(ref), ATOMIC_VALUE_SLOT));
+    const int32_t i = dynamic_cast<JInt*>(index)->val;
+    if (i < 0 || i >= array->length) {
+        throw runtime_error("array index out of bounds");
+    }
+    return {env->heap->atomicElement(*array, i), true, array->offset};
+}
+
+template <typename Box>
+static atomic<decltype(Box::val)>& boxedValueOf(const AtomicSlot& s) {
+    static_assert(sizeof(atomic<decltype(Box::val)>) ==
+                      sizeof(decltype(Box::val)),
+                  "atomic value must share layout of plain value");
+    auto* box = static_cast<Box*>(s.slot.load(memory_order_relaxed));
+    return *reinterpret_cast<atomic<decltype(Box::val)>*>(&box->val);
+}
+
+template <typename Box>
+static decltype(Box::val) valueOf(JType* arg) {
+    return dynamic_cast<Box*>(arg)->val;
+}
+
+template <typename Box>
+static JType* atomicGet(const AtomicSlot& s) {
+    return new Box(boxedValueOf<Box>(s).load());
+}
+
+template <typename Box>
+static JType* atomicSet(const AtomicSlot& s, JType* value,
+                        memory_order order) {
+    boxedValueOf<Box>(s).store(valueOf<Box>(value), order);
+    return nullptr;
+}
+
+template <typename Box>
+static JType* atomicGetAndSet(const AtomicSlot& s, JType* value) {
+    return new Box(boxedValueOf<Box>(s).exchange(valueOf<Box>(value)));
+}
+
+template <typename Box>
+static JType* atomicCompareAndSet(const AtomicSlot& s, JType* expect,
+                                  JType* update) {
+    auto expected = valueOf<Box>(expect);
+    return new JInt(boxedValueOf<Box>(s).compare_exchange_strong(
+                        expected, valueOf<Box>(update))
+                        ? 1
+                        : 0);
+}
+
+template <typename Box>
+static JType* atomicGetAndAdd(const AtomicSlot& s, JType* delta) {
+    return new Box(boxedValueOf<Box>(s).fetch_add(valueOf<Box>(delta)));
+}
+
+static bool sameReference(const JType* a, const JType* b) {
+    if (a == nullptr || b == nullptr) {
+        return a == b;
+    }
+    if (typeid(*a) == typeid(JObject) && typeid(*b) == typeid(JObject)) {
+        return static_cast<const JObject*>(a)->offset ==
+               static_cast<const JObject*>(b)->offset;
+    }
+    if (typeid(*a) == typeid(JArray) && typeid(*b) == typeid(JArray)) {
+        return static_cast<const JArray*>(a)->offset ==
+               static_cast<const JArray*>(b)->offset;
+    }
+    return false;
+}
+
+// Slots hold their own handles since handles of dead arrays are deleted
+// along with elements
+static JType* referenceGet(const AtomicSlot& s) {
+    return cloneValue(s.slot.load());
+}
+
+static JType* referenceSet(RuntimeEnv* env, const AtomicSlot& s,
+                           JType* value, memory_order order) {
+    JType* handle = cloneValue(value);
+    s.slot.store(handle, order);
+    env->heap->rememberReference(s.inArray, s.holder, handle);
+    return nullptr;
+}
+
+static JType* referenceGetAndSet(RuntimeEnv* env, const AtomicSlot& s,
+                                 JType* value) {
+    JType* handle = cloneValue(value);
+    JType* old = s.slot.exchange(handle);
+    env->heap->rememberReference(s.inArray, s.holder, handle);
+    return cloneValue(old);
+}
+
+static JType* referenceCompareAndSet(RuntimeEnv* env, const AtomicSlot& s,
+                                     JType* expect, JType* update) {
+    JType* handle = cloneValue(update);
+    JType* current = s.slot.load();
+    while (sameReference(current, expect)) {
+        if (s.slot.compare_exchange_weak(current, handle)) {
+            env->heap->rememberReference(s.inArray, s.holder, handle);
+            return new JInt(1);
+        }
+    }
+    delete handle;
+    return new JInt(0);
+}
+
+JType* ydk_concurrent_AtomicInteger_get(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
+    return atomicGet<JInt>(atomicFieldOf(env, args[0]));
+}
+
+JType* ydk_concurrent_AtomicInteger_set(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs) {
+    return atomicSet<JInt>(atomicFieldOf(env, args[0]), args[1],
+                           memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicInteger_lazySet(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs) {
+    return atomicSet<JInt>(atomicFieldOf(env, args[0]), args[1],
+                           memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicInteger_getAndSet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    return atomicGetAndSet<JInt>(atomicFieldOf(env, args[0]), args[1]);
+}
+
+JType* ydk_concurrent_AtomicInteger_compareAndSet(RuntimeEnv* env,
+                                                  JavaThread* self,
+                                                  JType** args, int numArgs) {
+    return atomicCompareAndSet<JInt>(atomicFieldOf(env, args[0]), args[1],
+                                     args[2]);
+}
+
+JType* ydk_concurrent_AtomicInteger_getAndAdd(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    return atomicGetAndAdd<JInt>(atomicFieldOf(env, args[0]), args[1]);
+}
+
+// Long arguments take two local slots
+JType* ydk_concurrent_AtomicLong_get(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    return atomicGet<JLong>(atomicFieldOf(env, args[0]));
+}
+
+JType* ydk_concurrent_AtomicLong_set(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs) {
+    return atomicSet<JLong>(atomicFieldOf(env, args[0]), args[1],
+                            memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicLong_lazySet(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs) {
+    return atomicSet<JLong>(atomicFieldOf(env, args[0]), args[1],
+                            memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicLong_getAndSet(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    return atomicGetAndSet<JLong>(atomicFieldOf(env, args[0]), args[1]);
+}
+
+JType* ydk_concurrent_AtomicLong_compareAndSet(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs) {
+    return atomicCompareAndSet<JLong>(atomicFieldOf(env, args[0]), args[1],
+                                      args[3]);
+}
+
+JType* ydk_concurrent_AtomicLong_getAndAdd(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs) {
+    return atomicGetAndAdd<JLong>(atomicFieldOf(env, args[0]), args[1]);
+}
+
+JType* ydk_concurrent_AtomicReference_get(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return referenceGet(atomicFieldOf(env, args[0]));
+}
+
+JType* ydk_concurrent_AtomicReference_set(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return referenceSet(env, atomicFieldOf(env, args[0]), args[1],
+                        memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicReference_lazySet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    return referenceSet(env, atomicFieldOf(env, args[0]), args[1],
+                        memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicReference_getAndSet(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs) {
+    return referenceGetAndSet(env, atomicFieldOf(env, args[0]), args[1]);
+}
+
+JType* ydk_concurrent_AtomicReference_compareAndSet(RuntimeEnv* env,
+                                                    JavaThread* self,
+                                                    JType** args, int numArgs) {
+    return referenceCompareAndSet(env, atomicFieldOf(env, args[0]), args[1],
+                                  args[2]);
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_get(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs) {
+    return atomicGet<JInt>(atomicElementOf(env, args[0], args[1]));
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_set(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs) {
+    return atomicSet<JInt>(atomicElementOf(env, args[0], args[1]), args[2],
+                           memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_lazySet(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs) {
+    return atomicSet<JInt>(atomicElementOf(env, args[0], args[1]), args[2],
+                           memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_getAndSet(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs) {
+    return atomicGetAndSet<JInt>(atomicElementOf(env, args[0], args[1]),
+                                 args[2]);
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_compareAndSet(RuntimeEnv* env,
+                                                       JavaThread* self,
+                                                       JType** args,
+                                                       int numArgs) {
+    return atomicCompareAndSet<JInt>(atomicElementOf(env, args[0], args[1]),
+                                     args[2], args[3]);
+}
+
+JType* ydk_concurrent_AtomicIntegerArray_getAndAdd(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs) {
+    return atomicGetAndAdd<JInt>(atomicElementOf(env, args[0], args[1]),
+                                 args[2]);
+}
+
+JType* ydk_concurrent_AtomicLongArray_get(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return atomicGet<JLong>(atomicElementOf(env, args[0], args[1]));
+}
+
+JType* ydk_concurrent_AtomicLongArray_set(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs) {
+    return atomicSet<JLong>(atomicElementOf(env, args[0], args[1]), args[2],
+                            memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicLongArray_lazySet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs) {
+    return atomicSet<JLong>(atomicElementOf(env, args[0], args[1]), args[2],
+                            memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicLongArray_getAndSet(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs) {
+    return atomicGetAndSet<JLong>(atomicElementOf(env, args[0], args[1]),
+                                  args[2]);
+}
+
+JType* ydk_concurrent_AtomicLongArray_compareAndSet(RuntimeEnv* env,
+                                                    JavaThread* self,
+                                                    JType** args, int numArgs) {
+    return atomicCompareAndSet<JLong>(atomicElementOf(env, args[0], args[1]),
+                                      args[2], args[4]);
+}
+
+JType* ydk_concurrent_AtomicLongArray_getAndAdd(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs) {
+    return atomicGetAndAdd<JLong>(atomicElementOf(env, args[0], args[1]),
+                                  args[2]);
+}
+
+// Elements start as null, unlike elements of arrays created by anewarray
+JType* ydk_concurrent_AtomicReferenceArray_init(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs) {
+    const int32_t length = dynamic_cast<JInt*>(args[1])->val;
+    if (length < 0) {
+        throw runtime_error("array size is negative");
+    }
+    JArray* array = env->heap->createObjectArray(
+        *env->cs->findJavaClass("java/lang/Object"), length);
+    auto& elements = env->heap->getElements(array);
+    for (int32_t i = 0; i < length; i++) {
+        elements.items[i] = nullptr;
+    }
+    env->heap->putFieldByOffset(*static_cast<JObject*>(args[0]),
+                                ATOMIC_VALUE_SLOT, array);
     return nullptr;
 }
+
+JType* ydk_concurrent_AtomicReferenceArray_get(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs) {
+    return referenceGet(atomicElementOf(env, args[0], args[1]));
+}
+
+JType* ydk_concurrent_AtomicReferenceArray_set(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs) {
+    return referenceSet(env, atomicElementOf(env, args[0], args[1]), args[2],
+                        memory_order_seq_cst);
+}
+
+JType* ydk_concurrent_AtomicReferenceArray_lazySet(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs) {
+    return referenceSet(env, atomicElementOf(env, args[0], args[1]), args[2],
+                        memory_order_release);
+}
+
+JType* ydk_concurrent_AtomicReferenceArray_getAndSet(RuntimeEnv* env,
+                                                     JavaThread* self,
+                                                     JType** args,
+                                                     int numArgs) {
+    return referenceGetAndSet(env, atomicElementOf(env, args[0], args[1]),
+                              args[2]);
+}
+
+JType* ydk_concurrent_AtomicReferenceArray_compareAndSet(RuntimeEnv* env,
+                                                         JavaThread* self,
+                                                         JType** args,
+                                                         int numArgs) {
+    return referenceCompareAndSet(env, atomicElementOf(env, args[0], args[1]),
+                                  args[2], args[3]);
+}
@@ -27,16 +27,217 @@
 #include "../runtime/JavaType.h"
 #include "../runtime/RuntimeEnv.h"
 
-JType* ydk_lang_IO_print_str(RuntimeEnv* env, JType** args, int numArgs);
-JType* ydk_lang_IO_print_I(RuntimeEnv* env, JType** args, int numArgs);
-JType* ydk_lang_IO_print_C(RuntimeEnv* env, JType** args, int numArgs);
-
-JType* java_lang_Math_random(RuntimeEnv* env, JType** args, int numArgs);
-JType* java_lang_stringbuilder_append_I(RuntimeEnv* env, JType** args, int numArgs);
-JType* java_lang_stringbuilder_append_C(RuntimeEnv* env, JType** args, int numArgs);
-JType* java_lang_stringbuilder_append_str(RuntimeEnv* env, JType** args, int numArgs);
-JType* java_lang_stringbuilder_append_D(RuntimeEnv* env, JType** args, int numArgs);
-JType* java_lang_stringbuilder_tostring(RuntimeEnv* env, JType** args, int numArgs);
-
-JType* java_lang_thread_start(RuntimeEnv* env, JType** args, int numArgs);
+JType* ydk_lang_IO_print_str(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs);
+JType* ydk_lang_IO_print_I(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs);
+JType* ydk_lang_IO_print_C(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs);
+JType* ydk_lang_Diagnostics_printHeapHistogram(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs);
+JType* ydk_lang_Diagnostics_dumpHeap(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+
+JType* ydk_lang_GCStats_getCollectionCount(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_lang_GCStats_getTotalPauseNanos(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_lang_GCStats_getBytesReclaimed(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+
+JType* java_lang_Math_random(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs);
+JType* java_lang_System_gc(RuntimeEnv* env, JavaThread* self, JType** args,
+                           int numArgs);
+JType* java_lang_System_currentTimeMillis(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* java_lang_Runtime_totalMemory(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+JType* java_lang_Runtime_freeMemory(RuntimeEnv* env, JavaThread* self,
+                                    JType** args, int numArgs);
+JType* java_lang_Runtime_maxMemory(RuntimeEnv* env, JavaThread* self,
+                                   JType** args, int numArgs);
+JType* java_lang_Object_wait(RuntimeEnv* env, JavaThread* self, JType** args,
+                             int numArgs);
+JType* java_lang_Object_notify(RuntimeEnv* env, JavaThread* self, JType** args,
+                               int numArgs);
+JType* java_lang_Object_notifyAll(RuntimeEnv* env, JavaThread* self,
+                                  JType** args, int numArgs);
+JType* java_lang_stringbuilder_append_I(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* java_lang_stringbuilder_append_C(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* java_lang_stringbuilder_append_str(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* java_lang_stringbuilder_append_D(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* java_lang_stringbuilder_tostring(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+
+JType* java_lang_thread_start(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs);
+JType* java_lang_Thread_startVirtual(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+JType* java_lang_Thread_currentThread(RuntimeEnv* env, JavaThread* self,
+                                      JType** args, int numArgs);
+JType* java_lang_Thread_sleep(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs);
+JType* java_lang_Thread_yield(RuntimeEnv* env, JavaThread* self, JType** args,
+                              int numArgs);
+JType* java_lang_Thread_interrupt(RuntimeEnv* env, JavaThread* self,
+                                  JType** args, int numArgs);
+JType* java_lang_Thread_isInterrupted(RuntimeEnv* env, JavaThread* self,
+                                      JType** args, int numArgs);
+JType* java_lang_Thread_interrupted(RuntimeEnv* env, JavaThread* self,
+                                    JType** args, int numArgs);
+
+JType* ydk_concurrent_LockSupport_park(RuntimeEnv* env, JavaThread* self,
+                                       JType** args, int numArgs);
+JType* ydk_concurrent_LockSupport_parkNanos(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs);
+JType* ydk_concurrent_LockSupport_unpark(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs);
+
+JType* ydk_concurrent_ReentrantLock_init(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs);
+JType* ydk_concurrent_ReentrantLock_lock(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs);
+JType* ydk_concurrent_ReentrantLock_lockInterruptibly(RuntimeEnv* env,
+                                                      JavaThread* self,
+                                                      JType** args,
+                                                      int numArgs);
+JType* ydk_concurrent_ReentrantLock_tryLock(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs);
+JType* ydk_concurrent_ReentrantLock_tryLock_J(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+JType* ydk_concurrent_ReentrantLock_unlock(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_concurrent_ReentrantLock_isHeldByCurrentThread(RuntimeEnv* env,
+                                                          JavaThread* self,
+                                                          JType** args,
+                                                          int numArgs);
+JType* ydk_concurrent_ReentrantLock_getHoldCount(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs);
+
+JType* ydk_concurrent_CountDownLatch_init(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* ydk_concurrent_CountDownLatch_await(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_concurrent_CountDownLatch_await_J(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs);
+JType* ydk_concurrent_CountDownLatch_countDown(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs);
+JType* ydk_concurrent_CountDownLatch_getCount(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+
+JType* ydk_concurrent_Semaphore_init(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+JType* ydk_concurrent_Semaphore_acquire(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* ydk_concurrent_Semaphore_tryAcquire(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_concurrent_Semaphore_tryAcquire_IJ(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+JType* ydk_concurrent_Semaphore_release(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* ydk_concurrent_Semaphore_availablePermits(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs);
+JType* ydk_concurrent_AtomicInteger_get(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* ydk_concurrent_AtomicInteger_set(RuntimeEnv* env, JavaThread* self,
+                                        JType** args, int numArgs);
+JType* ydk_concurrent_AtomicInteger_lazySet(RuntimeEnv* env, JavaThread* self,
+                                            JType** args, int numArgs);
+JType* ydk_concurrent_AtomicInteger_getAndSet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+JType* ydk_concurrent_AtomicInteger_compareAndSet(RuntimeEnv* env,
+                                                  JavaThread* self,
+                                                  JType** args, int numArgs);
+JType* ydk_concurrent_AtomicInteger_getAndAdd(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+
+JType* ydk_concurrent_AtomicLong_get(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLong_set(RuntimeEnv* env, JavaThread* self,
+                                     JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLong_lazySet(RuntimeEnv* env, JavaThread* self,
+                                         JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLong_getAndSet(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLong_compareAndSet(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs);
+JType* ydk_concurrent_AtomicLong_getAndAdd(RuntimeEnv* env, JavaThread* self,
+                                           JType** args, int numArgs);
+
+JType* ydk_concurrent_AtomicReference_get(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* ydk_concurrent_AtomicReference_set(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* ydk_concurrent_AtomicReference_lazySet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+JType* ydk_concurrent_AtomicReference_getAndSet(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs);
+JType* ydk_concurrent_AtomicReference_compareAndSet(RuntimeEnv* env,
+                                                    JavaThread* self,
+                                                    JType** args, int numArgs);
+
+JType* ydk_concurrent_AtomicIntegerArray_get(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs);
+JType* ydk_concurrent_AtomicIntegerArray_set(RuntimeEnv* env, JavaThread* self,
+                                             JType** args, int numArgs);
+JType* ydk_concurrent_AtomicIntegerArray_lazySet(RuntimeEnv* env,
+                                                 JavaThread* self, JType** args,
+                                                 int numArgs);
+JType* ydk_concurrent_AtomicIntegerArray_getAndSet(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs);
+JType* ydk_concurrent_AtomicIntegerArray_compareAndSet(RuntimeEnv* env,
+                                                       JavaThread* self,
+                                                       JType** args,
+                                                       int numArgs);
+JType* ydk_concurrent_AtomicIntegerArray_getAndAdd(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs);
+
+JType* ydk_concurrent_AtomicLongArray_get(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLongArray_set(RuntimeEnv* env, JavaThread* self,
+                                          JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLongArray_lazySet(RuntimeEnv* env, JavaThread* self,
+                                              JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLongArray_getAndSet(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs);
+JType* ydk_concurrent_AtomicLongArray_compareAndSet(RuntimeEnv* env,
+                                                    JavaThread* self,
+                                                    JType** args, int numArgs);
+JType* ydk_concurrent_AtomicLongArray_getAndAdd(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs);
+
+JType* ydk_concurrent_AtomicReferenceArray_init(RuntimeEnv* env,
+                                                JavaThread* self, JType** args,
+                                                int numArgs);
+JType* ydk_concurrent_AtomicReferenceArray_get(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs);
+JType* ydk_concurrent_AtomicReferenceArray_set(RuntimeEnv* env,
+                                               JavaThread* self, JType** args,
+                                               int numArgs);
+JType* ydk_concurrent_AtomicReferenceArray_lazySet(RuntimeEnv* env,
+                                                   JavaThread* self,
+                                                   JType** args, int numArgs);
+JType* ydk_concurrent_AtomicReferenceArray_getAndSet(RuntimeEnv* env,
+                                                     JavaThread* self,
+                                                     JType** args, int numArgs);
+JType* ydk_concurrent_AtomicReferenceArray_compareAndSet(RuntimeEnv* env,
+                                                         JavaThread* self,
+                                                         JType** args,
+                                                         int numArgs);
 #endif
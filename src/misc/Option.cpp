@@ -0,0 +1,152 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "Option.h"
+#include <cstdlib>
+#include <cstring>
+
+// Parse size like 512k, 64m or 1g, return false if it's malformed
+static bool parseSize(const std::string& str, size_t& size) {
+    char* end = nullptr;
+    unsigned long long val = strtoull(str.c_str(), &end, 10);
+    if (end == str.c_str()) {
+        return false;
+    }
+    switch (*end) {
+        case '\0':
+            break;
+        case 'k':
+        case 'K':
+            val *= 1024;
+            end++;
+            break;
+        case 'm':
+        case 'M':
+            val *= 1024 * 1024;
+            end++;
+            break;
+        case 'g':
+        case 'G':
+            val *= 1024 * 1024 * 1024;
+            end++;
+            break;
+        default:
+            return false;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    size = static_cast<size_t>(val);
+    return true;
+}
+
+static bool parseNumber(const std::string& str, size_t& number) {
+    char* end = nullptr;
+    unsigned long long val = strtoull(str.c_str(), &end, 10);
+    if (end == str.c_str() || *end != '\0') {
+        return false;
+    }
+    number = static_cast<size_t>(val);
+    return true;
+}
+
+static bool startsWith(const std::string& str, const std::string& prefix) {
+    return str.compare(0, prefix.length(), prefix) == 0;
+}
+
+bool VMOption::parse(const std::string& arg) {
+    if (arg == "-verbose:gc" || arg == "-Xlog:gc") {
+        verboseGC = true;
+        return true;
+    }
+    if (arg == "-XX:+UseEvacuationGC" || arg == "-XX:-UseEvacuationGC") {
+        useEvacuationGC = arg[4] == '+';
+        return true;
+    }
+    if (arg == "-XX:+UseStringDeduplication" ||
+        arg == "-XX:-UseStringDeduplication") {
+        useStringDeduplication = arg[4] == '+';
+        return true;
+    }
+    if (arg == "-XX:+UseAllocationSitePretenuring" ||
+        arg == "-XX:-UseAllocationSitePretenuring") {
+        useAllocationSitePretenuring = arg[4] == '+';
+        return true;
+    }
+    if (startsWith(arg, "-XX:LongLivedSweepInterval=")) {
+        return parseNumber(arg.substr(strlen("-XX:LongLivedSweepInterval=")),
+                           longLivedSweepInterval) &&
+               longLivedSweepInterval != 0;
+    }
+    if (startsWith(arg, "-XX:MaxGCPauseMillis=")) {
+        return parseNumber(arg.substr(strlen("-XX:MaxGCPauseMillis=")),
+                           maxGCPauseMillis);
+    }
+    if (startsWith(arg, "-XX:ParallelGCThreads=")) {
+        return parseNumber(arg.substr(strlen("-XX:ParallelGCThreads=")),
+                           parallelGCThreads);
+    }
+    if (startsWith(arg, "-XX:ConcGCThreads=")) {
+        return parseNumber(arg.substr(strlen("-XX:ConcGCThreads=")),
+                           concGCThreads);
+    }
+    if (startsWith(arg, "-XX:HeapDumpPath=")) {
+        heapDumpPath = arg.substr(strlen("-XX:HeapDumpPath="));
+        return !heapDumpPath.empty();
+    }
+    if (startsWith(arg, "-XX:AllocationSampleInterval=")) {
+        return parseSize(arg.substr(strlen("-XX:AllocationSampleInterval=")),
+                         allocationSampleInterval);
+    }
+    if (startsWith(arg, "-XX:AllocationProfilePath=")) {
+        allocationProfilePath =
+            arg.substr(strlen("-XX:AllocationProfilePath="));
+        return !allocationProfilePath.empty();
+    }
+    if (arg == "-XX:+ProfileMonitorContention" ||
+        arg == "-XX:-ProfileMonitorContention") {
+        profileMonitorContention = arg[4] == '+';
+        return true;
+    }
+    if (startsWith(arg, "-XX:VirtualThreadCarriers=")) {
+        return parseNumber(arg.substr(strlen("-XX:VirtualThreadCarriers=")),
+                           virtualThreadCarriers);
+    }
+    if (startsWith(arg, "-XX:VirtualThreadStackSize=")) {
+        return parseSize(arg.substr(strlen("-XX:VirtualThreadStackSize=")),
+                         virtualThreadStackSize) &&
+               virtualThreadStackSize != 0;
+    }
+    if (startsWith(arg, "-XX:GCTimeRatio=")) {
+        return parseNumber(arg.substr(strlen("-XX:GCTimeRatio=")),
+                           gcTimeRatio);
+    }
+    if (startsWith(arg, "-Xms")) {
+        return parseSize(arg.substr(strlen("-Xms")), initialGCThreshold);
+    }
+    if (startsWith(arg, "-Xmx")) {
+        return parseSize(arg.substr(strlen("-Xmx")), maxGCThreshold);
+    }
+    return false;
+}
@@ -24,12 +24,85 @@
 #ifndef YVM_OPTION_H
 #define YVM_OPTION_H
 
+#include <string>
+
 //--------------------------------------------------------------------------------
 // denote the default threshold value of garbage collector. GC was started when
 // the memory allocation was beyond this value.
 //--------------------------------------------------------------------------------
 #define YVM_GC_THRESHOLD_VALUE (1024 * 1024 * 10)
 
+//--------------------------------------------------------------------------------
+// default upper bound of GC threshold which GC ergonomics could grow to, and
+// the default GC time ratio, i.e. mutator time should be at least 12 times of
+// GC pause time
+//--------------------------------------------------------------------------------
+#define YVM_GC_MAX_THRESHOLD_VALUE (YVM_GC_THRESHOLD_VALUE * 16)
+#define YVM_GC_TIME_RATIO 12
+
+//--------------------------------------------------------------------------------
+// number of record slots of a heap region, and the least percentage of garbage
+// of a region which is worth being evacuated by evacuating collector
+//--------------------------------------------------------------------------------
+#define YVM_GC_REGION_SLOTS 1024
+#define YVM_GC_EVACUATION_GARBAGE_PERCENT 50
+
+//--------------------------------------------------------------------------------
+// a thread places this many records into regions shared by all threads before
+// it claims regions of its own, so that threads which allocate little don't
+// hold a region each
+//--------------------------------------------------------------------------------
+#define YVM_GC_SHARED_ALLOCATION_RECORDS 64
+
+//--------------------------------------------------------------------------------
+// heap regions are split into this many chunks per active GC worker while
+// sweeping, more chunks balance the load better when liveness is uneven
+//--------------------------------------------------------------------------------
+#define YVM_GC_SWEEP_CHUNKS_PER_WORKER 4
+
+//--------------------------------------------------------------------------------
+// roots and elements of reference arrays are marked in slices of at most this
+// many references, slices of a long array can be stolen by idle GC workers
+//--------------------------------------------------------------------------------
+#define YVM_GC_MARK_SLICE 256
+
+//--------------------------------------------------------------------------------
+// an allocation site is judged after this many of its records were swept, it
+// allocates into long-lived space if at least this percentage of them
+// survived, and long-lived space is swept once every this many GC cycles
+//--------------------------------------------------------------------------------
+#define YVM_GC_PRETENURE_MIN_SAMPLES 32
+#define YVM_GC_PRETENURE_SURVIVAL_PERCENT 80
+#define YVM_GC_LONG_LIVED_SWEEP_INTERVAL 8
+
+//--------------------------------------------------------------------------------
+// allocation sampler records at most this many innermost frames of a stack,
+// and reports this many allocation sites with the most sampled bytes
+//--------------------------------------------------------------------------------
+#define YVM_ALLOCATION_SAMPLE_MAX_FRAMES 64
+#define YVM_ALLOCATION_REPORT_SITES 10
+
+//--------------------------------------------------------------------------------
+// a thread which failed to enter a held monitor spins up to this many times of
+// average hold time of the monitor before parking, but no longer than this
+// many nanoseconds
+//--------------------------------------------------------------------------------
+#define YVM_MONITOR_SPIN_HOLD_FACTOR 2
+#define YVM_MONITOR_MAX_SPIN_NANOS 20000
+
+//--------------------------------------------------------------------------------
+// monitor profiler reports this many sites and monitors with the longest wait
+// time, and this many most frequent owner sites of each of them
+//--------------------------------------------------------------------------------
+#define YVM_MONITOR_REPORT_ENTRIES 10
+#define YVM_MONITOR_REPORT_OWNERS 3
+
+//--------------------------------------------------------------------------------
+// stack size of a virtual thread, it's reserved up front but only the pages
+// which were touched are committed
+//--------------------------------------------------------------------------------
+#define YVM_VIRTUAL_THREAD_STACK_SIZE (1024 * 1024 * 4)
+
 //--------------------------------------------------------------------------------
 // show new spawning thread name
 //--------------------------------------------------------------------------------
@@ -62,8 +135,58 @@
 #endif
 
 //--------------------------------------------------------------------------------
-// to mark a gc safe point
+// show time-to-safepoint of every safepoint
 //--------------------------------------------------------------------------------
-#define GC_SAFE_POINT
+#undef YVM_DEBUG_SHOW_SAFEPOINT
+
+//--------------------------------------------------------------------------------
+// VM options which are specified by command line arguments, e.g.
+//   -verbose:gc   -Xlog:gc     log every garbage collection cycle
+//   -XX:MaxGCPauseMillis=<ms>  pause time goal of garbage collection
+//   -XX:GCTimeRatio=<n>        throughput goal, GC time is 1/(1+n) at most
+//   -Xms<size>   -Xmx<size>    initial and maximum GC threshold
+//   -XX:+UseEvacuationGC       evacuate regions with the most garbage
+//   -XX:+UseStringDeduplication
+//                              let equal strings share their value arrays
+//   -XX:+UseAllocationSitePretenuring
+//                              allocate long-lived sites into long-lived space
+//   -XX:LongLivedSweepInterval=<n>
+//                              sweep long-lived space every n GC cycles
+//   -XX:ParallelGCThreads=<n>  GC threads which work within pauses
+//   -XX:ConcGCThreads=<n>      GC threads which work alongside mutators
+//   -XX:HeapDumpPath=<path>    write heap dump on SIGQUIT besides histogram
+//   -XX:AllocationSampleInterval=<size>
+//                              sample an allocation every <size> bytes
+//   -XX:AllocationProfilePath=<path>
+//                              write allocation samples as pprof profile
+//   -XX:+ProfileMonitorContention
+//                              report contention of monitors at exit
+//   -XX:VirtualThreadCarriers=<n>
+//                              carrier threads which run virtual threads
+//   -XX:VirtualThreadStackSize=<size>
+//                              stack size of a virtual thread
+//--------------------------------------------------------------------------------
+struct VMOption {
+    bool verboseGC = false;
+    bool useEvacuationGC = false;
+    bool useStringDeduplication = false;
+    bool useAllocationSitePretenuring = false;
+    size_t longLivedSweepInterval = YVM_GC_LONG_LIVED_SWEEP_INTERVAL;
+    size_t parallelGCThreads = 0;  // 0 means it's chosen by core count
+    size_t concGCThreads = 0;      // DITTO
+    size_t maxGCPauseMillis = 0;  // 0 means there is no pause time goal
+    size_t gcTimeRatio = YVM_GC_TIME_RATIO;
+    size_t initialGCThreshold = YVM_GC_THRESHOLD_VALUE;
+    size_t maxGCThreshold = YVM_GC_MAX_THRESHOLD_VALUE;
+    std::string heapDumpPath;
+    size_t allocationSampleInterval = 0;  // 0 means sampling is disabled
+    std::string allocationProfilePath;
+    bool profileMonitorContention = false;
+    size_t virtualThreadCarriers = 0;  // 0 means it's chosen by core count
+    size_t virtualThreadStackSize = YVM_VIRTUAL_THREAD_STACK_SIZE;
+
+    // Parse a single command line option, return false if it's unrecognized
+    bool parse(const std::string& arg);
+};
 
 #endif  // !YVM_OPTION_H
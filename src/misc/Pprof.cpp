@@ -0,0 +1,184 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "Pprof.h"
+#include <fstream>
+
+// Field numbers of profile.proto
+#define PPROF_PROFILE_SAMPLE_TYPE 1
+#define PPROF_PROFILE_SAMPLE 2
+#define PPROF_PROFILE_LOCATION 4
+#define PPROF_PROFILE_FUNCTION 5
+#define PPROF_PROFILE_STRING_TABLE 6
+#define PPROF_PROFILE_TIME_NANOS 9
+#define PPROF_PROFILE_DURATION_NANOS 10
+#define PPROF_PROFILE_PERIOD_TYPE 11
+#define PPROF_PROFILE_PERIOD 12
+#define PPROF_VALUE_TYPE_TYPE 1
+#define PPROF_VALUE_TYPE_UNIT 2
+#define PPROF_SAMPLE_LOCATION_ID 1
+#define PPROF_SAMPLE_VALUE 2
+#define PPROF_LOCATION_ID 1
+#define PPROF_LOCATION_ADDRESS 3
+#define PPROF_LOCATION_LINE 4
+#define PPROF_LINE_FUNCTION_ID 1
+#define PPROF_LINE_LINE 2
+#define PPROF_FUNCTION_ID 1
+#define PPROF_FUNCTION_NAME 2
+#define PPROF_FUNCTION_SYSTEM_NAME 3
+#define PPROF_FUNCTION_FILENAME 4
+
+#define WIRE_VARINT 0
+#define WIRE_LENGTH_DELIMITED 2
+
+static void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static void putKey(string& out, int field, int wireType) {
+    putVarint(out, static_cast<uint64_t>(field << 3 | wireType));
+}
+
+// Negative int64 values are encoded in ten bytes as protobuf does
+static void putInt(string& out, int field, uint64_t value) {
+    putKey(out, field, WIRE_VARINT);
+    putVarint(out, value);
+}
+
+static void putBytes(string& out, int field, const string& bytes) {
+    putKey(out, field, WIRE_LENGTH_DELIMITED);
+    putVarint(out, bytes.size());
+    out.append(bytes);
+}
+
+template <typename Int>
+static void putPacked(string& out, int field, const vector<Int>& values) {
+    string packed;
+    for (Int value : values) {
+        putVarint(packed, static_cast<uint64_t>(value));
+    }
+    putBytes(out, field, packed);
+}
+
+PprofBuilder::PprofBuilder(const vector<pair<string, string>>& sampleTypes,
+                           const pair<string, string>& periodType,
+                           int64_t period) {
+    // The first string must be empty
+    stringIndex("");
+    for (auto& sampleType : sampleTypes) {
+        putBytes(profile, PPROF_PROFILE_SAMPLE_TYPE,
+                 encodeValueType(sampleType));
+    }
+    putBytes(profile, PPROF_PROFILE_PERIOD_TYPE, encodeValueType(periodType));
+    putInt(profile, PPROF_PROFILE_PERIOD, static_cast<uint64_t>(period));
+}
+
+int64_t PprofBuilder::stringIndex(const string& str) {
+    auto iter = stringIndexes.find(str);
+    if (iter != stringIndexes.end()) {
+        return iter->second;
+    }
+    strings.push_back(str);
+    stringIndexes.insert(make_pair(str, strings.size() - 1));
+    return static_cast<int64_t>(strings.size() - 1);
+}
+
+string PprofBuilder::encodeValueType(const pair<string, string>& valueType) {
+    string encoded;
+    putInt(encoded, PPROF_VALUE_TYPE_TYPE, stringIndex(valueType.first));
+    putInt(encoded, PPROF_VALUE_TYPE_UNIT, stringIndex(valueType.second));
+    return encoded;
+}
+
+uint64_t PprofBuilder::addFunction(const string& name, const string& systemName,
+                                   const string& fileName) {
+    auto key = make_tuple(name, systemName, fileName);
+    auto iter = functions.find(key);
+    if (iter != functions.end()) {
+        return iter->second;
+    }
+    const uint64_t id = functions.size() + 1;
+    functions.insert(make_pair(key, id));
+
+    string function;
+    putInt(function, PPROF_FUNCTION_ID, id);
+    putInt(function, PPROF_FUNCTION_NAME, stringIndex(name));
+    putInt(function, PPROF_FUNCTION_SYSTEM_NAME, stringIndex(systemName));
+    putInt(function, PPROF_FUNCTION_FILENAME, stringIndex(fileName));
+    putBytes(profile, PPROF_PROFILE_FUNCTION, function);
+    return id;
+}
+
+uint64_t PprofBuilder::addLocation(uint64_t functionId, uint64_t address,
+                                   int64_t line) {
+    auto key = make_tuple(functionId, address, line);
+    auto iter = locations.find(key);
+    if (iter != locations.end()) {
+        return iter->second;
+    }
+    const uint64_t id = locations.size() + 1;
+    locations.insert(make_pair(key, id));
+
+    string lineInfo;
+    putInt(lineInfo, PPROF_LINE_FUNCTION_ID, functionId);
+    putInt(lineInfo, PPROF_LINE_LINE, static_cast<uint64_t>(line));
+    string location;
+    putInt(location, PPROF_LOCATION_ID, id);
+    putInt(location, PPROF_LOCATION_ADDRESS, address);
+    putBytes(location, PPROF_LOCATION_LINE, lineInfo);
+    putBytes(profile, PPROF_PROFILE_LOCATION, location);
+    return id;
+}
+
+void PprofBuilder::addSample(const vector<uint64_t>& locations,
+                             const vector<int64_t>& values) {
+    string sample;
+    putPacked(sample, PPROF_SAMPLE_LOCATION_ID, locations);
+    putPacked(sample, PPROF_SAMPLE_VALUE, values);
+    putBytes(profile, PPROF_PROFILE_SAMPLE, sample);
+}
+
+void PprofBuilder::setTime(int64_t timeNanos, int64_t durationNanos) {
+    putInt(profile, PPROF_PROFILE_TIME_NANOS, static_cast<uint64_t>(timeNanos));
+    putInt(profile, PPROF_PROFILE_DURATION_NANOS,
+           static_cast<uint64_t>(durationNanos));
+}
+
+bool PprofBuilder::write(const string& path) {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    string stringTable;
+    for (auto& str : strings) {
+        putBytes(stringTable, PPROF_PROFILE_STRING_TABLE, str);
+    }
+    file.write(profile.data(), profile.size());
+    file.write(stringTable.data(), stringTable.size());
+    file.flush();
+    return file.good();
+}
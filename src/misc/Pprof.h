@@ -0,0 +1,75 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_PPROF_H
+#define YVM_PPROF_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//--------------------------------------------------------------------------------
+// PprofBuilder encodes a profile in the protocol buffer format of pprof, i.e.
+// the Profile message of profile.proto. Profiles are written uncompressed,
+// which can be read by pprof directly. Functions and locations are interned,
+// so that callers can add them for every sample.
+//--------------------------------------------------------------------------------
+class PprofBuilder {
+public:
+    // Value types are pairs of type and unit, e.g. {"alloc_space", "bytes"}
+    PprofBuilder(const vector<pair<string, string>>& sampleTypes,
+                 const pair<string, string>& periodType, int64_t period);
+
+    uint64_t addFunction(const string& name, const string& systemName,
+                         const string& fileName);
+    // Address has no meaning for pprof, it's used to distinguish locations
+    // of the same function and line
+    uint64_t addLocation(uint64_t functionId, uint64_t address, int64_t line);
+    // Locations are ordered from the leaf to the root, values are ordered as
+    // sample types
+    void addSample(const vector<uint64_t>& locations,
+                   const vector<int64_t>& values);
+
+    void setTime(int64_t timeNanos, int64_t durationNanos);
+    // Return false if the profile can not be written
+    bool write(const string& path);
+
+private:
+    int64_t stringIndex(const string& str);
+    string encodeValueType(const pair<string, string>& valueType);
+
+    // Encoded fields of Profile message except string table
+    string profile;
+    vector<string> strings;
+    unordered_map<string, int64_t> stringIndexes;
+    map<tuple<string, string, string>, uint64_t> functions;
+    map<tuple<uint64_t, uint64_t, int64_t>, uint64_t> locations;
+};
+
+#endif  // YVM_PPROF_H
@@ -58,9 +58,8 @@ JType* cloneValue(JType* value) {
         dupvalue = new JInt();
         dynamic_cast<JInt*>(dupvalue)->val = dynamic_cast<JInt*>(value)->val;
     } else if (typeid(*value) == typeid(JLong)) {
-        dupvalue = new JDouble();
-        dynamic_cast<JDouble*>(dupvalue)->val =
-            dynamic_cast<JDouble*>(value)->val;
+        dupvalue = new JLong();
+        dynamic_cast<JLong*>(dupvalue)->val = dynamic_cast<JLong*>(value)->val;
     } else if (typeid(*value) == typeid(JObject)) {
         dupvalue = new JObject();
         dynamic_cast<JObject*>(dupvalue)->jc =
@@ -93,7 +92,8 @@ bool hasInheritanceRelationship(const JavaClass* source,
 
 void registerNativeMethod(const char* className, const char* name,
                           const char* descriptor,
-                          JType* (*func)(RuntimeEnv*, JType**,int)) {
+                          JType* (*func)(RuntimeEnv*, JavaThread*, JType**,
+                                        int)) {
     std::string methodName(className);
     methodName.append(".");
     methodName.append(name);
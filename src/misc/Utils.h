@@ -71,7 +71,8 @@ bool hasInheritanceRelationship(const JavaClass* source,
                                 const JavaClass* super);
 void registerNativeMethod(const char* className, const char* name,
                           const char* descriptor,
-                          JType* (*func)(RuntimeEnv*, JType**, int));
+                          JType* (*func)(RuntimeEnv*, JavaThread*, JType**,
+                                        int));
 
 inline u1 consumeU1(const u1* code, u4& opidx) {
     const u1 byte = code[++opidx];
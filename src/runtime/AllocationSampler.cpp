@@ -0,0 +1,186 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "AllocationSampler.h"
+#include <algorithm>
+#include <cmath>
+#include "../misc/Option.h"
+#include "../misc/Pprof.h"
+#include "JavaClass.h"
+#include "JavaFrame.hpp"
+#include "JavaHeap.hpp"
+#include "JavaThread.h"
+#include "RuntimeEnv.h"
+
+thread_local size_t AllocationSampler::bytesUntilSample = 0;
+thread_local bool AllocationSampler::samplingStarted = false;
+thread_local mt19937_64 AllocationSampler::random;
+
+void AllocationSampler::initialize(const VMOption& option) {
+    interval = option.allocationSampleInterval;
+    profilePath = option.allocationProfilePath;
+    startTime = chrono::system_clock::now();
+}
+
+size_t AllocationSampler::nextInterval() {
+    exponential_distribution<double> distribution(1.0 / interval);
+    return static_cast<size_t>(distribution(random)) + 1;
+}
+
+void AllocationSampler::takeSample(size_t bytes, const JavaClass* klass,
+                                   int arrayType) {
+    if (!samplingStarted) {
+        // The counter of a new thread is zero, draw its first interval rather
+        // than sampling its first allocation
+        samplingStarted = true;
+        auto now = chrono::steady_clock::now().time_since_epoch().count();
+        random.seed(hash<thread::id>()(this_thread::get_id()) ^
+                    static_cast<size_t>(now));
+        bytesUntilSample = nextInterval();
+        return;
+    }
+    bytesUntilSample = nextInterval();
+
+    Site site{klass, arrayType, {}};
+    JavaThread* thread = runtime.threads->current();
+    if (thread != nullptr) {
+        for (Slots* frame = thread->frames->top();
+             frame != nullptr &&
+             site.frames.size() < YVM_ALLOCATION_SAMPLE_MAX_FRAMES;
+             frame = frame->next) {
+            if (frame->method != nullptr) {
+                site.frames.push_back({frame->jc, frame->method, frame->bci});
+            }
+        }
+    }
+
+    const double weight =
+        1.0 / (1.0 - exp(-static_cast<double>(bytes) / interval));
+    lock_guard<mutex> lock(sitesMtx);
+    SiteStats& stats = sites[site];
+    stats.samples++;
+    stats.objects += weight;
+    stats.bytes += weight * bytes;
+}
+
+string AllocationSampler::allocatedTypeName(const Site& site) {
+    string name = site.arrayType == 0 ? site.klass->getClassName()
+                                      : arrayClassName(site.arrayType,
+                                                       site.klass);
+    replace(name.begin(), name.end(), '/', '.');
+    return name;
+}
+
+string AllocationSampler::methodName(const Frame& frame) {
+    string name = frame.jc->getClassName();
+    replace(name.begin(), name.end(), '/', '.');
+    return name + "." + frame.jc->getString(frame.method->nameIndex);
+}
+
+void AllocationSampler::finish() {
+    if (interval == 0) {
+        return;
+    }
+    if (!profilePath.empty()) {
+        if (!writeProfile(profilePath)) {
+            fprintf(stderr, "[alloc] Failed to write allocation profile %s\n",
+                    profilePath.c_str());
+        }
+        return;
+    }
+    printReport(stderr);
+}
+
+void AllocationSampler::printReport(FILE* out) {
+    lock_guard<mutex> lock(sitesMtx);
+    vector<pair<const Site*, const SiteStats*>> ranked;
+    size_t samples = 0;
+    double bytes = 0;
+    for (auto& site : sites) {
+        ranked.emplace_back(&site.first, &site.second);
+        samples += site.second.samples;
+        bytes += site.second.bytes;
+    }
+    sort(ranked.begin(), ranked.end(),
+         [](const pair<const Site*, const SiteStats*>& a,
+            const pair<const Site*, const SiteStats*>& b) {
+             return a.second->bytes > b.second->bytes;
+         });
+
+    fprintf(out,
+            "[alloc] %zu samples, %.0f bytes allocated (estimated), "
+            "sampling interval %zu bytes\n",
+            samples, bytes, interval);
+    for (size_t i = 0; i < ranked.size() && i < YVM_ALLOCATION_REPORT_SITES;
+         i++) {
+        const Site& site = *ranked[i].first;
+        const SiteStats& stats = *ranked[i].second;
+        fprintf(out, "[alloc] #%zu %s: %.0f bytes, %.0f objects (%.1f%%)\n",
+                i + 1, allocatedTypeName(site).c_str(), stats.bytes,
+                stats.objects, bytes > 0 ? stats.bytes * 100 / bytes : 0.0);
+        for (const Frame& frame : site.frames) {
+            fprintf(out, "[alloc]     at %s\n",
+                    frame.jc->getSourceLocation(frame.method, frame.bci)
+                        .c_str());
+        }
+    }
+}
+
+bool AllocationSampler::writeProfile(const string& path) {
+    PprofBuilder builder({{"alloc_objects", "count"}, {"alloc_space", "bytes"}},
+                         {"space", "bytes"}, static_cast<int64_t>(interval));
+    auto now = chrono::system_clock::now();
+    builder.setTime(chrono::duration_cast<chrono::nanoseconds>(
+                        startTime.time_since_epoch())
+                        .count(),
+                    chrono::duration_cast<chrono::nanoseconds>(now - startTime)
+                        .count());
+
+    lock_guard<mutex> lock(sitesMtx);
+    for (auto& entry : sites) {
+        const Site& site = entry.first;
+        vector<uint64_t> locations;
+        // The allocated type is the leaf of every stack, so that pprof could
+        // tell hotspots of every type apart
+        const string typeName = allocatedTypeName(site);
+        locations.push_back(
+            builder.addLocation(builder.addFunction(typeName, typeName, ""),
+                                0, 0));
+        for (const Frame& frame : site.frames) {
+            const string name = methodName(frame);
+            const string systemName =
+                frame.jc->getClassName() + "." +
+                frame.jc->getString(frame.method->nameIndex) +
+                frame.jc->getString(frame.method->descriptorIndex);
+            uint64_t function = builder.addFunction(
+                name, systemName, frame.jc->getSourceFileName());
+            locations.push_back(builder.addLocation(
+                function, frame.bci,
+                frame.jc->getLineNumber(frame.method, frame.bci)));
+        }
+        builder.addSample(locations,
+                          {static_cast<int64_t>(llround(entry.second.objects)),
+                           static_cast<int64_t>(llround(entry.second.bytes))});
+    }
+    return builder.write(path);
+}
@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_ALLOCATIONSAMPLER_H
+#define YVM_ALLOCATIONSAMPLER_H
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "../interpreter/Internal.h"
+
+using namespace std;
+
+class JavaClass;
+struct MethodInfo;
+struct VMOption;
+
+//--------------------------------------------------------------------------------
+// Allocation sampler takes a sample roughly every N bytes allocated by a
+// thread. Each thread counts down its own bytes until next sample, and the
+// distance between samples is drawn from an exponential distribution whose
+// mean is N, so that allocation patterns can not hide from sampling. A sample
+// records the allocated class and the java stack of allocating thread, frames
+// are identified by method and bytecode index.
+//
+// Samples of the same class and stack are merged, the number of allocations a
+// sample stands for is estimated as 1/(1-e^(-size/N)), which is the inverse of
+// probability that an allocation of this size is sampled. At exit, the top
+// allocation sites are reported or all samples are written as pprof profile.
+//--------------------------------------------------------------------------------
+class AllocationSampler {
+public:
+    void initialize(const VMOption& option);
+
+    // Heap reports every record once it's completely constructed. Array type
+    // is 0 for objects, otherwise it's element type of array, and class is
+    // element class of reference arrays
+    void recordAllocation(size_t bytes, const JavaClass* klass, int arrayType) {
+        if (interval == 0) {
+            return;
+        }
+        if (bytesUntilSample > bytes) {
+            bytesUntilSample -= bytes;
+            return;
+        }
+        takeSample(bytes, klass, arrayType);
+    }
+
+    // Print report or write pprof profile according to options
+    void finish();
+
+private:
+    struct Frame {
+        const JavaClass* jc;
+        const MethodInfo* method;
+        u4 bci;
+
+        bool operator<(const Frame& rhs) const {
+            return tie(jc, method, bci) < tie(rhs.jc, rhs.method, rhs.bci);
+        }
+    };
+    struct Site {
+        const JavaClass* klass;
+        int arrayType;
+        vector<Frame> frames;  // From the innermost frame
+
+        bool operator<(const Site& rhs) const {
+            return tie(klass, arrayType, frames) <
+                   tie(rhs.klass, rhs.arrayType, rhs.frames);
+        }
+    };
+    struct SiteStats {
+        size_t samples = 0;
+        double objects = 0;
+        double bytes = 0;
+    };
+
+    void takeSample(size_t bytes, const JavaClass* klass, int arrayType);
+    size_t nextInterval();
+    static string allocatedTypeName(const Site& site);
+    static string methodName(const Frame& frame);
+    void printReport(FILE* out);
+    bool writeProfile(const string& path);
+
+    size_t interval = 0;
+    string profilePath;
+    chrono::system_clock::time_point startTime;
+
+    static thread_local size_t bytesUntilSample;
+    static thread_local bool samplingStarted;
+    static thread_local mt19937_64 random;
+
+    mutex sitesMtx;
+    map<Site, SiteStats> sites;
+};
+
+#endif  // YVM_ALLOCATIONSAMPLER_H
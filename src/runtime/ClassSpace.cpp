@@ -24,7 +24,10 @@
 #include "ClassSpace.h"
 
 #include "../classfile/AccessFlag.h"
+#include "../interpreter/Interpreter.hpp"
 #include "JavaClass.h"
+#include "JavaThread.h"
+#include "Safepoint.h"
 
 using namespace std;
 
@@ -64,6 +67,7 @@ bool ClassSpace::loadJavaClass(const string& jcName) {
             !findJavaClass(jc->getSuperClassName())) {
             this->loadJavaClass(jc->getSuperClassName());
         }
+        jc->computeFieldLayout(findJavaClass(jc->getSuperClassName()));
 
         // Load super interfaces if existed
         vector<u2>&& interfacesIdx = jc->getInterfacesIndex();
@@ -212,12 +216,37 @@ void ClassSpace::linkJavaClass(const string& jcName) {
 }
 
 void ClassSpace::initJavaClass(Interpreter& exec, const string& jcName) {
-    lock_guard<recursive_mutex> lockMA(maMutex);
-    initedClasses.insert(jcName);
-    auto* jc = findJavaClass(jcName);
+    JavaClass* jc = findJavaClass(jcName);
+    // <clinit> may reach a safepoint, it must be executed without holding
+    // any lock, otherwise threads waiting for the lock would never be safe
     if (jc->findMethod("<clinit>", "()V")) {
         exec.invokeByName(jc, "<clinit>", "()V");
     }
+
+    lock_guard<mutex> lock(initMtx);
+    initializingClasses.erase(jcName);
+    initedClasses.insert(jcName);
+    initCnd.notify_all();
+}
+
+bool ClassSpace::beginInitialization(JavaThread* self,
+                                     const string& jcName) {
+    // Waiting thread is safe for safepoints. The scope is left after initMtx
+    // is released, since leaving it may wait for an ongoing safepoint
+    ThreadBlockedScope blocked(runtime.safepoint, self);
+    unique_lock<mutex> lock(initMtx);
+    while (initedClasses.count(jcName) == 0) {
+        auto iter = initializingClasses.find(jcName);
+        if (iter == initializingClasses.end()) {
+            initializingClasses.emplace(jcName, self);
+            return true;
+        }
+        if (iter->second == self) {
+            return false;
+        }
+        initCnd.wait(lock);
+    }
+    return false;
 }
 
 JavaClass* ClassSpace::loadClassIfAbsent(const string& jcName) {
@@ -246,15 +275,7 @@ void ClassSpace::linkClassIfAbsent(const string& jcName) {
 }
 
 void ClassSpace::initClassIfAbsent(Interpreter& exec, const string& jcName) {
-    lock_guard<recursive_mutex> lockMA(maMutex);
-
-    bool inited = false;
-    for (auto p : initedClasses) {
-        if (p == jcName) {
-            inited = true;
-        }
-    }
-    if (!inited) {
+    if (beginInitialization(exec.getThread(), jcName)) {
         initJavaClass(exec, jcName);
     }
 }
@@ -25,6 +25,7 @@
 #define YVM_CLASSSPACE_H
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <mutex>
 #include <string>
@@ -37,6 +38,7 @@ using namespace std;
 
 class Interpreter;
 class JavaClass;
+struct JavaThread;
 class ConcurrentGC;
 
 //--------------------------------------------------------------------------------
@@ -48,6 +50,7 @@ class ConcurrentGC;
 //--------------------------------------------------------------------------------
 class ClassSpace {
     friend class ConcurrentGC;
+    friend class HeapInspector;
 
 public:
     ClassSpace(const string& path);
@@ -57,23 +60,37 @@ public:
     bool loadJavaClass(const string& jcName);
     bool removeJavaClass(const string& jcName);
     void linkJavaClass(const string& jcName);
+    // Execute <clinit> of the class, then mark it as initialized and wake up
+    // threads waiting for it
     void initJavaClass(Interpreter& exec, const string& jcName);
 
 public:
     JavaClass* loadClassIfAbsent(const string& jcName);
     void linkClassIfAbsent(const string& jcName);
+    // Initialize the class unless it has been initialized. If another thread
+    // is initializing it, wait until that thread finishes. A recursive
+    // request of the initializing thread returns immediately
     void initClassIfAbsent(Interpreter& exec, const string& jcName);
 
 private:
     const string parseNameToPath(const string& name);
+    // Return true if the calling thread should initialize the class, which is
+    // then recorded as being initialized by it
+    bool beginInitialization(JavaThread* self, const string& jcName);
 
 private:
     recursive_mutex maMutex;
 
     unordered_set<string> linkedClasses;
-    unordered_set<string> initedClasses;
     unordered_map<string, JavaClass*> classTable;
 
+    // Initialization state is guarded by its own lock, since initializing
+    // threads run java code and reach safepoints while others wait for it
+    mutex initMtx;
+    condition_variable initCnd;
+    unordered_set<string> initedClasses;
+    unordered_map<string, const JavaThread*> initializingClasses;
+
     vector<string> searchPaths;
 };
 
@@ -0,0 +1,200 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "Continuation.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+#ifndef YVM_CONTINUATION_UCONTEXT
+//--------------------------------------------------------------------------------
+// yvm_swap_context(saveSp, loadSp) pushes callee-saved registers onto current
+// stack, stores the stack pointer to *saveSp, then switches to loadSp and pops
+// the registers saved there. A new stack is prepared as if it was suspended
+// right before yvm_context_start, which calls entry(arg) kept in two of
+// callee-saved registers
+//--------------------------------------------------------------------------------
+extern "C" void yvm_swap_context(void** saveSp, void* loadSp);
+extern "C" void yvm_context_start();
+
+#if defined(__x86_64__)
+asm(R"(
+    .text
+    .globl yvm_swap_context
+    .type yvm_swap_context, @function
+yvm_swap_context:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size yvm_swap_context, .-yvm_swap_context
+
+    .globl yvm_context_start
+    .type yvm_context_start, @function
+yvm_context_start:
+    movq %r12, %rdi
+    callq *%rbx
+    ud2
+    .size yvm_context_start, .-yvm_context_start
+)");
+
+// MXCSR and x87 control word, followed by r15, r14, r13, r12, rbx, rbp and
+// the return address
+static constexpr size_t SAVED_WORDS = 8;
+
+static void prepareStack(void** sp, void (*entry)(void*), void* arg) {
+    const uint32_t fpuControl[2] = {0x1f80, 0x037f};
+    memcpy(sp, fpuControl, sizeof(fpuControl));
+    sp[4] = arg;
+    sp[5] = reinterpret_cast<void*>(entry);
+    sp[6] = nullptr;
+    sp[7] = reinterpret_cast<void*>(yvm_context_start);
+}
+#elif defined(__aarch64__)
+asm(R"(
+    .text
+    .globl yvm_swap_context
+    .type yvm_swap_context, %function
+yvm_swap_context:
+    sub sp, sp, #176
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mov x9, sp
+    str x9, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    add sp, sp, #176
+    ret
+    .size yvm_swap_context, .-yvm_swap_context
+
+    .globl yvm_context_start
+    .type yvm_context_start, %function
+yvm_context_start:
+    mov x0, x20
+    blr x19
+    brk #0
+    .size yvm_context_start, .-yvm_context_start
+)");
+
+// x19-x30 and d8-d15, padded to keep the stack 16-byte aligned
+static constexpr size_t SAVED_WORDS = 22;
+
+static void prepareStack(void** sp, void (*entry)(void*), void* arg) {
+    sp[0] = reinterpret_cast<void*>(entry);
+    sp[1] = arg;
+    sp[10] = nullptr;
+    sp[11] = reinterpret_cast<void*>(yvm_context_start);
+}
+#endif
+#endif  // !YVM_CONTINUATION_UCONTEXT
+
+Continuation::Continuation(size_t stackSize, void (*entry)(void*), void* arg) {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    stackSize = (stackSize + pageSize - 1) / pageSize * pageSize;
+    mappedSize = stackSize + pageSize;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#ifdef MAP_STACK
+    flags |= MAP_STACK;
+#endif
+    stack = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (stack == MAP_FAILED) {
+        throw runtime_error("failed to map stack of continuation");
+    }
+    // Stack grows downwards, so the guard page is at the lowest address
+    mprotect(stack, pageSize, PROT_NONE);
+
+#ifdef YVM_CONTINUATION_UCONTEXT
+    this->entry = entry;
+    this->arg = arg;
+    getcontext(&context);
+    context.uc_stack.ss_sp = static_cast<char*>(stack) + pageSize;
+    context.uc_stack.ss_size = stackSize;
+    context.uc_link = nullptr;
+    const auto self = reinterpret_cast<uintptr_t>(this);
+    makecontext(&context, reinterpret_cast<void (*)()>(start), 2,
+                static_cast<unsigned>(static_cast<uint64_t>(self) >> 32),
+                static_cast<unsigned>(self));
+#else
+    void** top = reinterpret_cast<void**>(static_cast<char*>(stack) +
+                                          mappedSize);
+    sp = top - SAVED_WORDS;
+    prepareStack(static_cast<void**>(sp), entry, arg);
+    resumerSp = nullptr;
+#endif
+}
+
+Continuation::~Continuation() { munmap(stack, mappedSize); }
+
+#ifdef YVM_CONTINUATION_UCONTEXT
+void Continuation::start(unsigned high, unsigned low) {
+    auto* self = reinterpret_cast<Continuation*>(
+        static_cast<uintptr_t>((static_cast<uint64_t>(high) << 32) | low));
+    self->entry(self->arg);
+}
+
+void Continuation::resume() { swapcontext(&resumerContext, &context); }
+
+void Continuation::suspend() { swapcontext(&context, &resumerContext); }
+#else
+void Continuation::resume() { yvm_swap_context(&resumerSp, sp); }
+
+void Continuation::suspend() { yvm_swap_context(&sp, resumerSp); }
+#endif
@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_CONTINUATION_H
+#define YVM_CONTINUATION_H
+
+#include <cstddef>
+
+#if !(defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__)))
+#define YVM_CONTINUATION_UCONTEXT
+#include <ucontext.h>
+#endif
+
+//--------------------------------------------------------------------------------
+// Continuation is a computation with its own native stack, which can suspend
+// itself and be resumed later, possibly by another native thread. The stack is
+// reserved up front but committed by the OS page by page as it grows, and a
+// guard page below it catches overflow. Switching saves only callee-saved
+// registers, it's a few instructions of assembly on x86-64 and AArch64, other
+// platforms fall back to ucontext.
+//--------------------------------------------------------------------------------
+class Continuation {
+public:
+    // entry(arg) runs on the new stack when the continuation is resumed for
+    // the first time, it must never return but suspend itself at last
+    Continuation(size_t stackSize, void (*entry)(void*), void* arg);
+    ~Continuation();
+    Continuation(const Continuation&) = delete;
+    Continuation& operator=(const Continuation&) = delete;
+
+    // Run the continuation on the calling thread until it suspends itself
+    void resume();
+    // Called by the continuation, return to the thread which resumed it
+    void suspend();
+
+private:
+    void* stack;
+    size_t mappedSize;
+#ifdef YVM_CONTINUATION_UCONTEXT
+    static void start(unsigned high, unsigned low);
+
+    void (*entry)(void*);
+    void* arg;
+    ucontext_t context;
+    ucontext_t resumerContext;
+#else
+    void* sp;
+    void* resumerSp;
+#endif
+};
+
+#endif  // YVM_CONTINUATION_H
@@ -0,0 +1,73 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "Futex.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+void futexWait(atomic<uint32_t>* word, uint32_t expected,
+               const chrono::nanoseconds* timeout) {
+    timespec relative{};
+    if (timeout != nullptr) {
+        relative.tv_sec = timeout->count() / 1000000000;
+        relative.tv_nsec = timeout->count() % 1000000000;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, timeout != nullptr ? &relative : nullptr, nullptr, 0);
+}
+
+void futexWake(atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
+}
+#else
+static mutex parkingMtx;
+static condition_variable parkingCv;
+
+void futexWait(atomic<uint32_t>* word, uint32_t expected,
+               const chrono::nanoseconds* timeout) {
+    unique_lock<mutex> lock(parkingMtx);
+    auto changed = [=] { return word->load() != expected; };
+    if (timeout != nullptr) {
+        parkingCv.wait_for(lock, *timeout, changed);
+    } else {
+        parkingCv.wait(lock, changed);
+    }
+}
+
+void futexWake(atomic<uint32_t>*, int) {
+    lock_guard<mutex> lock(parkingMtx);
+    parkingCv.notify_all();
+}
+#endif
@@ -0,0 +1,45 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_FUTEX_H
+#define YVM_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//--------------------------------------------------------------------------------
+// Futex is the parking primitive of monitors and java threads. A thread waits
+// on a 32-bit word while it holds the expected value, and it's woken by
+// another thread which has changed the word. Waiting may return spuriously,
+// so callers must recheck the word. Platforms without futex fall back to a
+// condition variable shared by all words.
+//--------------------------------------------------------------------------------
+// Block the calling thread while *word equals expected, or until the timeout
+// expires if it's given
+void futexWait(std::atomic<uint32_t>* word, uint32_t expected,
+               const std::chrono::nanoseconds* timeout = nullptr);
+// Wake up at most count threads waiting on the word
+void futexWake(std::atomic<uint32_t>* word, int count = 1);
+
+#endif  // YVM_FUTEX_H
@@ -23,6 +23,7 @@
 
 #include "JavaClass.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <vector>
@@ -63,6 +64,56 @@ vector<u2> JavaClass::getInterfacesIndex() const {
     return v;
 }
 
+const string JavaClass::getSourceFileName() const {
+    FOR_EACH(i, raw.attributesCount) {
+        if (typeid(*raw.attributes[i]) == typeid(ATTR_SourceFile)) {
+            return getString(
+                ((ATTR_SourceFile*)raw.attributes[i])->sourceFileIndex);
+        }
+    }
+    return "";
+}
+
+int JavaClass::getLineNumber(const MethodInfo* method, u4 bci) const {
+    FOR_EACH(i, method->attributeCount) {
+        if (typeid(*method->attributes[i]) != typeid(ATTR_Code)) {
+            continue;
+        }
+        auto* code = (ATTR_Code*)method->attributes[i];
+        FOR_EACH(j, code->attributeCount) {
+            if (typeid(*code->attributes[j]) != typeid(ATTR_LineNumberTable)) {
+                continue;
+            }
+            // Line of the last entry which starts at or before bci
+            auto* table = (ATTR_LineNumberTable*)code->attributes[j];
+            int line = 0;
+            u2 startPC = 0;
+            FOR_EACH(k, table->lineNumberTableLength) {
+                const auto& entry = table->lineNumberTable[k];
+                if (entry.startPC <= bci && entry.startPC >= startPC) {
+                    startPC = entry.startPC;
+                    line = entry.lineNumber;
+                }
+            }
+            return line;
+        }
+    }
+    return 0;
+}
+
+const string JavaClass::getSourceLocation(const MethodInfo* method,
+                                          u4 bci) const {
+    string name = getClassName();
+    replace(name.begin(), name.end(), '/', '.');
+    name += "." + getString(method->nameIndex);
+    if (IS_METHOD_NATIVE(method->accessFlags)) {
+        return name + "(Native Method)";
+    }
+    const string file = getSourceFileName();
+    return name + "(" + (file.empty() ? "Unknown Source" : file) + ":" +
+           to_string(getLineNumber(method, bci)) + ") bci=" + to_string(bci);
+}
+
 MethodInfo* JavaClass::findMethod(const string& methodName,
                                   const string& methodDescriptor) const {
     FOR_EACH(i, raw.methodsCount) {
@@ -80,36 +131,63 @@ MethodInfo* JavaClass::findMethod(const string& methodName,
 
 bool JavaClass::setStaticVar(const string& name, const string& descriptor,
                              JType* value) {
+    JType** slot = getStaticVarSlot(name, descriptor);
+    if (slot == nullptr) {
+        return false;
+    }
+    *slot = value;
+    return true;
+}
+
+// Instance fields of an object are laid out as fields declared by its class
+// followed by fields of its super classes, so the reference map of a class is
+// its own reference slots plus reference map of super class shifted by the
+// number of its own instance fields. Garbage collector uses it to visit
+// reference slots only, instead of inspecting every field of an object
+void JavaClass::computeFieldLayout(const JavaClass* superClass) {
+    referenceMap.clear();
+    fieldDescriptors.clear();
+    size_t slot = 0;
     FOR_EACH(i, raw.fieldsCount) {
         if (IS_FIELD_STATIC(raw.fields[i].accessFlags)) {
-            auto n = getString(raw.fields[i].nameIndex);
-            auto d = getString(raw.fields[i].descriptorIndex);
-            if (n == name && d == descriptor) {
-                staticVars.find(i)->second = value;
-                return true;
-            }
+            continue;
         }
+        const string& descriptor = getString(raw.fields[i].descriptorIndex);
+        if (IS_FIELD_REF_CLASS(descriptor) || IS_FIELD_REF_ARRAY(descriptor)) {
+            referenceMap.push_back(slot);
+        }
+        fieldDescriptors.push_back(descriptor);
+        slot++;
     }
-    if (raw.superClass != 0) {
-        return runtime.cs->findJavaClass(getSuperClassName())
-            ->setStaticVar(name, descriptor, value);
+    if (superClass != nullptr) {
+        for (size_t superSlot : superClass->referenceMap) {
+            referenceMap.push_back(slot + superSlot);
+        }
+        fieldDescriptors.insert(fieldDescriptors.end(),
+                                superClass->fieldDescriptors.begin(),
+                                superClass->fieldDescriptors.end());
     }
-    return false;
 }
 
 JType* JavaClass::getStaticVar(const string& name, const string& descriptor) {
+    JType** slot = getStaticVarSlot(name, descriptor);
+    return slot != nullptr ? *slot : nullptr;
+}
+
+JType** JavaClass::getStaticVarSlot(const string& name,
+                                    const string& descriptor) {
     FOR_EACH(i, raw.fieldsCount) {
         if (IS_FIELD_STATIC(raw.fields[i].accessFlags)) {
             auto n = getString(raw.fields[i].nameIndex);
             auto d = getString(raw.fields[i].descriptorIndex);
             if (n == name && d == descriptor) {
-                return staticVars.find(i)->second;
+                return &staticVars.find(i)->second;
             }
         }
     }
     if (raw.superClass != 0) {
         return runtime.cs->findJavaClass(getSuperClassName())
-            ->getStaticVar(name, descriptor);
+            ->getStaticVarSlot(name, descriptor);
     }
     return nullptr;
 }
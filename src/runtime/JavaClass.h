@@ -53,6 +53,7 @@ class JavaClass {
     friend class ClassSpace;
     friend class Interpreter;
     friend class ConcurrentGC;
+    friend class HeapInspector;
 
 public:
     explicit JavaClass(const string& classFilePath);
@@ -60,6 +61,8 @@ public:
     JavaClass(const JavaClass& rhs);
 
 public:
+    forceinline u2 getConstPoolCount() const { return raw.constPoolCount; }
+
     forceinline ConstantPoolInfo* getConstPoolItem(u2 index) const {
         return raw.constPoolInfo[index];
     }
@@ -97,12 +100,34 @@ public:
 
     forceinline u2 getAccessFlag() const { return raw.accessFlags; }
 
+    // Slots of instance fields which hold references, in the same order of
+    // fields created by JavaHeap::createObject()
+    forceinline const vector<size_t>& getReferenceMap() const {
+        return referenceMap;
+    }
+    // Descriptors of instance fields in the same order, objects are created
+    // from them without looking up super classes
+    forceinline const vector<string>& getFieldDescriptors() const {
+        return fieldDescriptors;
+    }
+
 public:
     MethodInfo* findMethod(const string& methodName,
                            const string& methodDescriptor) const;
+    // Debugging information of class file, they are used by profilers. Source
+    // file name is empty and line number is 0 if they are absent
+    const string getSourceFileName() const;
+    int getLineNumber(const MethodInfo* method, u4 bci) const;
+    // Source location of bci in the method, in the form of stack trace entry,
+    // e.g. "a.B.foo(B.java:11) bci=3" or "a.B.bar(Native Method)"
+    const string getSourceLocation(const MethodInfo* method, u4 bci) const;
     bool setStaticVar(const string& name, const string& descriptor,
                       JType* value);
     JType* getStaticVar(const string& name, const string& descriptor);
+    // Slot of the static field declared by this class or its super classes,
+    // or nullptr if there is no such field. Slots are created when the class
+    // is linked and never move since then
+    JType** getStaticVarSlot(const string& name, const string& descriptor);
 
 private:
     void parseClassFile();
@@ -111,6 +136,7 @@ private:
     bool parseField(u2 fieldCount);
     bool parseMethod(u2 methodCount);
     bool parseAttribute(AttributeInfo**(&attrs), u2 attributeCount);
+    void computeFieldLayout(const JavaClass* superClass);
 
 private:
     VerificationTypeInfo* determineVerificationType(u1 tag);
@@ -123,6 +149,8 @@ private:
     ClassFile raw{};
     FileReader reader;
     map<size_t, JType*> staticVars;
+    vector<size_t> referenceMap;
+    vector<string> fieldDescriptors;
 };
 
 #endif  // YVM_JAVACLASS_H
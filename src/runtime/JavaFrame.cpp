@@ -49,7 +49,10 @@ Slots::Slots(int maxLocal, int maxStack)
       maxStack(maxStack),
       next(nullptr),
       localSlots(nullptr),
-      stackSlots(nullptr) {
+      stackSlots(nullptr),
+      jc(nullptr),
+      method(nullptr),
+      bci(0) {
     if (maxLocal > 0) {
         localSlots = new JType*[maxLocal];
         memset(localSlots, 0, sizeof(JType*) * maxLocal);
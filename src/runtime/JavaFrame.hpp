@@ -34,10 +34,14 @@
 using namespace std;
 
 struct JType;
+struct MethodInfo;
 
 class Slots {
     friend class JavaFrame;
     friend class ConcurrentGC;
+    friend class HeapInspector;
+    friend class AllocationSampler;
+    friend class MonitorProfiler;
     friend class Interpreter;
 
 public:
@@ -77,6 +81,13 @@ public:
     // an exception occurred
     void grow(int size);
 
+    // Method which this frame is executing, it's absent for frames created by
+    // natives
+    void setMethod(const JavaClass *jc, const MethodInfo *method) {
+        this->jc = jc;
+        this->method = method;
+    }
+
 private:
     std::list<JType *> exceptions;
     JType **localSlots;
@@ -85,6 +96,12 @@ private:
     int maxStack;
     int stackTop;
     Slots *next;
+
+    const JavaClass *jc;
+    const MethodInfo *method;
+    // Index of bytecode which is being executed, it's updated by interpreter
+    // before executing every bytecode
+    u4 bci;
 };
 
 //--------------------------------------------------------------------------------
@@ -153,8 +170,9 @@ inline void Slots::store(u1 localIndex) {
     auto *var = dynamic_cast<StoreType *>(stackSlots[stackTop]);
     stackSlots[stackTop] = nullptr;
     localSlots[localIndex] = var;
+    // Category 2 values occupy two local slots, the second one is unusable
     if (IS_JLong(var) || IS_JDouble(var)) {
-        localSlots[localIndex++] = nullptr;
+        localSlots[localIndex + 1] = nullptr;
     }
 }
 
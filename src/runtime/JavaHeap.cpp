@@ -22,6 +22,7 @@
 //
 
 #include "../classfile/AccessFlag.h"
+#include "AllocationSampler.h"
 #include "JavaClass.h"
 #include "JavaHeap.hpp"
 #include "JavaType.h"
@@ -32,157 +33,170 @@
 
 using namespace std;
 
-// object creation and array creation
-void JavaHeap::createSuperFields(const JavaClass& javaClass,
-                                 const JObject* object) {
-    lock_guard<recursive_mutex> lock(objMtx);
-
-    if (javaClass.raw.superClass != 0) {
-        const JavaClass* superClass =
-            runtime.cs->findJavaClass(javaClass.getSuperClassName());
-        FOR_EACH(i, superClass->raw.fieldsCount) {
-            // Note that we have already created static field variables when the
-            // javaClass is linked into jvm (YVM::linkClass()) so we ignore all
-            // static fields here.
-            const string& descriptor = superClass->getString(
-                superClass->raw.fields[i].descriptorIndex);
-
-            if (IS_FIELD_REF_CLASS(descriptor)) {
-                // Special handling for field whose type is another class
-                if (!IS_FIELD_STATIC(superClass->raw.fields[i].accessFlags)) {
-                    JObject* fieldObject = nullptr;
-                    objectContainer.find(object->offset).push_back(fieldObject);
-                }
-            } else if (IS_FIELD_REF_ARRAY(descriptor)) {
-                // Special handling for field whose type is array. We create a
-                // null JArray as a placeholder since we don't know more
-                // information about size of array, so we defer to allocate
-                // memory while meeting opcodes [newarray]/[multinewarray]
-                if (!IS_FIELD_STATIC(superClass->raw.fields[i].accessFlags)) {
-                    JArray* uninitializedArray = nullptr;
-                    objectContainer.find(object->offset)
-                        .push_back(uninitializedArray);
-                }
-            } else {
-                // Otherwise it's a basic type. We insert it into instance's
-                // field or its class static field by determining its access
-                // flag
-                if (!IS_FIELD_STATIC(superClass->raw.fields[i].accessFlags)) {
-                    JType* basicField = determineBasicType(descriptor);
-                    objectContainer.find(object->offset).push_back(basicField);
-                }
-            }
+thread_local AllocationBuffer<InternalObject> JavaHeap::objectBuffer;
+thread_local AllocationBuffer<InternalArray> JavaHeap::arrayBuffer;
+
+string arrayClassName(int elementType, const JavaClass* elementClass) {
+    switch (elementType) {
+        case T_BOOLEAN:
+            return "[Z";
+        case T_CHAR:
+            return "[C";
+        case T_FLOAT:
+            return "[F";
+        case T_DOUBLE:
+            return "[D";
+        case T_BYTE:
+            return "[B";
+        case T_SHORT:
+            return "[S";
+        case T_INT:
+            return "[I";
+        case T_LONG:
+            return "[J";
+        default:
+            return "[L" +
+                   (elementClass != nullptr ? elementClass->getClassName()
+                                            : string("java/lang/Object")) +
+                   ";";
+    }
+}
+
+template <typename Type>
+static void remember(Region<Type>* region, bool holderIsArray, size_t holder) {
+    if (region == nullptr) {
+        return;
+    }
+    lock_guard<SpinLock> lock(region->rememberedSetSpin);
+    if (holderIsArray) {
+        region->rememberedArrays.insert(holder);
+    } else {
+        region->rememberedObjects.insert(holder);
+    }
+}
+
+void JavaHeap::writeBarrier(bool holderIsArray, size_t holder,
+                            const JType* value) {
+    if (!rememberedSetEnabled || value == nullptr) {
+        return;
+    }
+    const size_t holderRegion = (holder - 1) / YVM_GC_REGION_SLOTS;
+    if (typeid(*value) == typeid(JObject)) {
+        const size_t offset = static_cast<const JObject*>(value)->offset;
+        if (holderIsArray ||
+            (offset - 1) / YVM_GC_REGION_SLOTS != holderRegion) {
+            remember(objectContainer.liveRegionOf(offset), holderIsArray,
+                     holder);
         }
-        if (superClass->raw.superClass != 0) {
-            createSuperFields(*superClass, object);
+    } else if (typeid(*value) == typeid(JArray)) {
+        const size_t offset = static_cast<const JArray*>(value)->offset;
+        if (!holderIsArray ||
+            (offset - 1) / YVM_GC_REGION_SLOTS != holderRegion) {
+            remember(arrayContainer.liveRegionOf(offset), holderIsArray,
+                     holder);
         }
     }
 }
 
-// create an object on the heap. This is the only way to create objects in
-// the yvm
-JObject* JavaHeap::createObject(const JavaClass& javaClass) {
-    lock_guard<recursive_mutex> lock(objMtx);
+// Slots are plain pointers, an atomic pointer shares their layout
+static_assert(sizeof(atomic<JType*>) == sizeof(JType*) &&
+                  ATOMIC_POINTER_LOCK_FREE == 2,
+              "atomic pointer must be a lock-free plain pointer");
+
+atomic<JType*>& JavaHeap::atomicField(const JObject& object,
+                                      size_t fieldOffset) {
+    return atomicSlot(objectContainer.findLive(object.offset)[fieldOffset]);
+}
+
+atomic<JType*>& JavaHeap::atomicElement(const JArray& array, size_t index) {
+    return atomicSlot(arrayContainer.findLive(array.offset).items[index]);
+}
 
+// create an object on the heap. This is the only way to create objects in
+// the yvm. Note that we have already created static field variables when the
+// javaClass is linked into jvm (YVM::linkClass()), so only instance fields of
+// the class and its super classes are created here. Fields whose type is
+// another class or array are null, and we defer to allocate arrays while
+// meeting opcodes [newarray]/[multinewarray]
+JObject* JavaHeap::createObject(const JavaClass& javaClass,
+                               AllocationSite* site) {
     JObject* object = new JObject;
     object->jc = &javaClass;
-    object->offset = objectContainer.place();
-    vector<JType*> instanceFields;
-
-    FOR_EACH(fieldOffset, javaClass.raw.fieldsCount) {
-        // Note that we have already created static field variables when the
-        // javaClass is linked into jvm (YVM::linkClass()) so we ignore all
-        // static fields here.
-        const string& descriptor = javaClass.getString(
-            javaClass.raw.fields[fieldOffset].descriptorIndex);
-
-        if (IS_FIELD_REF_CLASS(descriptor)) {
-            // Special handling for field whose type is another class
-            if (!IS_FIELD_STATIC(
-                    javaClass.raw.fields[fieldOffset].accessFlags)) {
-                JObject* fieldObject = nullptr;
-                instanceFields.push_back(fieldObject);
-            }
-        } else if (IS_FIELD_REF_ARRAY(descriptor)) {
-            // Special handling for field whose type is array. We create a null
-            // JArray as a placeholder since we don't know more information
-            // about size of array, so we defer to allocate memory while meeting
-            // opcodes [newarray]/[multinewarray]
-            if (!IS_FIELD_STATIC(
-                    javaClass.raw.fields[fieldOffset].accessFlags)) {
-                JArray* uninitializedArray = nullptr;
-                instanceFields.push_back(uninitializedArray);
-            }
-        } else {
-            // Otherwise it's a basic type. We insert it into instance's field
-            // or its class static field by determining its access flag
-            if (!IS_FIELD_STATIC(
-                    javaClass.raw.fields[fieldOffset].accessFlags)) {
-                JType* basicField = determineBasicType(descriptor);
-                instanceFields.push_back(basicField);
-            }
-        }
+    object->offset =
+        objectContainer.place(objectBuffer, objMtx, &javaClass, site);
+
+    auto& instanceFields = objectContainer.findLive(object->offset);
+    instanceFields.reserve(javaClass.getFieldDescriptors().size());
+    for (const string& descriptor : javaClass.getFieldDescriptors()) {
+        instanceFields.push_back(determineBasicType(descriptor));
     }
-    objectContainer.find(object->offset) = instanceFields;
-    createSuperFields(javaClass, object);
+    runtime.sampler->recordAllocation(objectContainer.account(object->offset),
+                                      &javaClass, 0);
     return object;
 }
 
-JArray* JavaHeap::createPODArray(int atype, int length) {
-    lock_guard<recursive_mutex> lock(arrMtx);
-
+JArray* JavaHeap::createPODArray(int atype, int length,
+                                 AllocationSite* site) {
     JArray* arr = new JArray;
     arr->length = length;
-    arr->offset = arrayContainer.place();
+    arr->offset = arrayContainer.place(arrayBuffer, arrMtx, nullptr, site);
 
     JType** items = new JType*[arr->length];
     switch (atype) {
         case T_FLOAT:
             FOR_EACH(i, length) { items[i] = new JFloat; }
-            arrayContainer.find(arr->offset) = make_pair(length, items);
-            return arr;
+            break;
         case T_DOUBLE:
             FOR_EACH(i, length) { items[i] = new JDouble; }
-            arrayContainer.find(arr->offset) = make_pair(length, items);
-            return arr;
+            break;
         case T_BOOLEAN:
         case T_CHAR:
         case T_BYTE:
         case T_SHORT:
         case T_INT:
             FOR_EACH(i, length) { items[i] = new JInt; }
-            arrayContainer.find(arr->offset) = make_pair(length, items);
-            return arr;
+            break;
         case T_LONG:
             FOR_EACH(i, length) { items[i] = new JLong; }
-            arrayContainer.find(arr->offset) = make_pair(length, items);
-            return arr;
+            break;
         default:
             return nullptr;
     }
+    arrayContainer.findLive(arr->offset) = {static_cast<size_t>(length),
+                                            items, atype};
+    runtime.sampler->recordAllocation(arrayContainer.account(arr->offset),
+                                      nullptr, atype);
+    return arr;
 }
 
-JArray* JavaHeap::createObjectArray(const JavaClass& jc, int length) {
-    lock_guard<recursive_mutex> lock(arrMtx);
+JArray* JavaHeap::createObjectArray(const JavaClass& jc, int length,
+                                    AllocationSite* site) {
     JArray* arr = new JArray;
     arr->length = length;
-    arr->offset = arrayContainer.place();
+    arr->offset = arrayContainer.place(arrayBuffer, arrMtx, &jc, site);
 
+    // Elements are created along with the array, they are attributed to the
+    // same allocation site
     JType** items = new JType*[arr->length];
-    FOR_EACH(i, length) { items[i] = createObject(jc); }
-    arrayContainer.find(arr->offset) = make_pair(length, items);
+    FOR_EACH(i, length) { items[i] = createObject(jc, site); }
+    arrayContainer.findLive(arr->offset) = {static_cast<size_t>(length),
+                                            items, T_EXTRA_OBJECT};
+    runtime.sampler->recordAllocation(arrayContainer.account(arr->offset), &jc,
+                                      T_EXTRA_OBJECT);
+    FOR_EACH(i, length) { writeBarrier(true, arr->offset, items[i]); }
     return arr;
 }
 
 JArray* JavaHeap::createCharArray(const string& source, size_t length) {
-    lock_guard<recursive_mutex> lock(arrMtx);
     JArray* arr = new JArray;
     arr->length = length;
-    arr->offset = arrayContainer.place();
+    arr->offset = arrayContainer.place(arrayBuffer, arrMtx, nullptr, nullptr);
 
     JType** items = new JType*[arr->length];
     FOR_EACH(i, length) { items[i] = new JInt(source[i]); }
-    arrayContainer.find(arr->offset) = make_pair(length, items);
+    arrayContainer.findLive(arr->offset) = {length, items, T_CHAR};
+    runtime.sampler->recordAllocation(arrayContainer.account(arr->offset),
+                                      nullptr, T_CHAR);
     return arr;
 }
 
@@ -195,58 +209,162 @@ JArray* JavaHeap::createCharArray(const string& source, size_t length) {
 // class(ClassB), now if we want to get/set ClassB.field we must set
 // desireLookup as ClassA, and currentLookup for object->jc, which means starts
 // lookup from current object related class(ClassB)
-JType* JavaHeap::getFieldByNameImpl(const JavaClass* desireLookup,
-                                    const JavaClass* currentLookup,
-                                    const string& name,
-                                    const string& descriptor, JObject* object,
-                                    size_t offset /*= 0*/) {
-    lock_guard<recursive_mutex> lock(objMtx);
-    size_t howManyNonStaticFields = 0;
-    FOR_EACH(i, currentLookup->raw.fieldsCount) {
-        if (!IS_FIELD_STATIC(currentLookup->raw.fields[i].accessFlags)) {
-            howManyNonStaticFields++;
-            const string& n = currentLookup->getString(
-                currentLookup->raw.fields[i].nameIndex);
-            const string& d = currentLookup->getString(
-                currentLookup->raw.fields[i].descriptorIndex);
-            if (n == name && d == descriptor && desireLookup == currentLookup) {
-                return objectContainer.find(object->offset)[i + offset];
+size_t JavaHeap::fieldSlotOf(const JavaClass* desireLookup,
+                             const JavaClass* currentLookup,
+                             const string& name, const string& descriptor) {
+    size_t offset = 0;
+    while (true) {
+        size_t howManyNonStaticFields = 0;
+        FOR_EACH(i, currentLookup->raw.fieldsCount) {
+            if (!IS_FIELD_STATIC(currentLookup->raw.fields[i].accessFlags)) {
+                howManyNonStaticFields++;
+                const string& n = currentLookup->getString(
+                    currentLookup->raw.fields[i].nameIndex);
+                const string& d = currentLookup->getString(
+                    currentLookup->raw.fields[i].descriptorIndex);
+                if (n == name && d == descriptor &&
+                    desireLookup == currentLookup) {
+                    return howManyNonStaticFields - 1 + offset;
+                }
             }
         }
+        if (currentLookup->raw.superClass == 0) {
+            return NO_FIELD;
+        }
+        currentLookup =
+            runtime.cs->findJavaClass(currentLookup->getSuperClassName());
+        offset += howManyNonStaticFields;
+    }
+}
+
+atomic<uintptr_t>& JavaHeap::lockWordOf(const JType* ref) {
+    if (typeid(*ref) == typeid(JArray)) {
+        return arrayContainer.lockWordOf(
+            static_cast<const JArray*>(ref)->offset);
     }
-    if (currentLookup->raw.superClass != 0) {
-        return getFieldByNameImpl(
-            desireLookup,
-            runtime.cs->findJavaClass(currentLookup->getSuperClassName()), name,
-            descriptor, object, offset + howManyNonStaticFields);
+    return objectContainer.lockWordOf(
+        dynamic_cast<const JObject*>(ref)->offset);
+}
+
+ObjectMonitor* JavaHeap::findMonitor(uintptr_t word) {
+    lock_guard<recursive_mutex> lock(monitorMtx);
+    return monitorContainer.find(LockWord::monitorIdOf(word));
+}
+
+ObjectMonitor* JavaHeap::inflate(atomic<uintptr_t>& lockWord,
+                                 uintptr_t word) {
+    lock_guard<recursive_mutex> lock(monitorMtx);
+    const size_t monitorId = monitorContainer.place(
+        LockWord::ownerOf(word),
+        static_cast<int32_t>(LockWord::countOf(word)));
+    if (!lockWord.compare_exchange_strong(word,
+                                          LockWord::inflated(monitorId))) {
+        // Owner has exited or another thread has inflated it, the monitor
+        // id was never published
+        monitorContainer.remove(monitorId);
+        return nullptr;
     }
-    return nullptr;
-}
-
-void JavaHeap::putFieldByNameImpl(const JavaClass* desireLookup,
-                                  const JavaClass* currentLookup,
-                                  const string& name, const string& descriptor,
-                                  JObject* object, JType* value,
-                                  size_t offset /*= 0*/) {
-    lock_guard<recursive_mutex> lock(objMtx);
-    size_t howManyNonStaticFields = 0;
-    FOR_EACH(i, currentLookup->raw.fieldsCount) {
-        if (!IS_FIELD_STATIC(currentLookup->raw.fields[i].accessFlags)) {
-            howManyNonStaticFields++;
-            const string& n = currentLookup->getString(
-                currentLookup->raw.fields[i].nameIndex);
-            const string& d = currentLookup->getString(
-                currentLookup->raw.fields[i].descriptorIndex);
-            if (n == name && d == descriptor && desireLookup == currentLookup) {
-                objectContainer.find(object->offset)[i + offset] = value;
-                return;
+    return monitorContainer.find(monitorId);
+}
+
+ObjectMonitor* JavaHeap::enterMonitor(const JType* ref, uintptr_t lockId) {
+    auto& lockWord = lockWordOf(ref);
+    uintptr_t word = lockWord.load();
+    while (true) {
+        if (word == LockWord::UNLOCKED) {
+            if (lockWord.compare_exchange_weak(word,
+                                               LockWord::thin(lockId, 1))) {
+                return nullptr;
+            }
+        } else if (LockWord::isInflated(word)) {
+            auto* monitor = findMonitor(word);
+            monitor->addContender();
+            return monitor;
+        } else if (LockWord::ownerOf(word) == lockId &&
+                   LockWord::countOf(word) < LockWord::MAX_COUNT) {
+            const uintptr_t count = LockWord::countOf(word) + 1;
+            if (lockWord.compare_exchange_weak(word,
+                                               LockWord::thin(lockId, count))) {
+                return nullptr;
+            }
+        } else {
+            // Another thread holds the thin lock, or recursion count would
+            // overflow
+            auto* monitor = inflate(lockWord, word);
+            if (monitor != nullptr) {
+                monitor->addContender();
+                return monitor;
             }
+            word = lockWord.load();
         }
     }
-    if (currentLookup->raw.superClass != 0) {
-        putFieldByNameImpl(
-            desireLookup,
-            runtime.cs->findJavaClass(currentLookup->getSuperClassName()), name,
-            descriptor, object, value, offset + howManyNonStaticFields);
+}
+
+void JavaHeap::exitMonitor(const JType* ref, uintptr_t lockId) {
+    auto& lockWord = lockWordOf(ref);
+    uintptr_t word = lockWord.load();
+    while (!LockWord::isInflated(word)) {
+        if (word == LockWord::UNLOCKED || LockWord::ownerOf(word) != lockId) {
+            throw runtime_error("illegal monitor state");
+        }
+        const uintptr_t count = LockWord::countOf(word);
+        const uintptr_t unlocked = count == 1
+                                       ? LockWord::UNLOCKED
+                                       : LockWord::thin(lockId, count - 1);
+        if (lockWord.compare_exchange_weak(word, unlocked)) {
+            return;
+        }
     }
-}
\ No newline at end of file
+    findMonitor(word)->exit(lockId);
+}
+
+ObjectMonitor* JavaHeap::ownedMonitor(const JType* ref, uintptr_t lockId,
+                                      bool inflating) {
+    auto& lockWord = lockWordOf(ref);
+    while (true) {
+        const uintptr_t word = lockWord.load();
+        if (LockWord::isInflated(word)) {
+            auto* monitor = findMonitor(word);
+            if (!monitor->isOwnedBy(lockId)) {
+                throw runtime_error("illegal monitor state");
+            }
+            return monitor;
+        }
+        if (word == LockWord::UNLOCKED || LockWord::ownerOf(word) != lockId) {
+            throw runtime_error("illegal monitor state");
+        }
+        if (!inflating) {
+            return nullptr;
+        }
+        // Inflation fails only if a contender has inflated it
+        auto* monitor = inflate(lockWord, word);
+        if (monitor != nullptr) {
+            return monitor;
+        }
+    }
+}
+
+Synchronizer* JavaHeap::createSynchronizer(const JType* ref, int32_t state) {
+    auto& lockWord = lockWordOf(ref);
+    while (true) {
+        const uintptr_t word = lockWord.load();
+        auto* monitor = LockWord::isInflated(word) ? findMonitor(word)
+                                                   : inflate(lockWord, word);
+        if (monitor != nullptr) {
+            lock_guard<recursive_mutex> lock(monitorMtx);
+            monitor->setSynchronizer(new Synchronizer(state));
+            return monitor->getSynchronizer();
+        }
+    }
+}
+
+Synchronizer* JavaHeap::findSynchronizer(const JType* ref) {
+    const uintptr_t word = lockWordOf(ref).load();
+    auto* synchronizer = LockWord::isInflated(word)
+                             ? findMonitor(word)->getSynchronizer()
+                             : nullptr;
+    if (synchronizer == nullptr) {
+        throw runtime_error("synchronizer is not initialized");
+    }
+    return synchronizer;
+}
@@ -24,8 +24,11 @@
 #ifndef YVM_JAVAHEAP_H
 #define YVM_JAVAHEAP_H
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_set>
 #include <vector>
 #include "../gc/GC.h"
 #include "JavaType.h"
@@ -34,97 +37,509 @@
 
 using namespace std;
 
+//--------------------------------------------------------------------------------
+// The ArrayContainer manages array's elements as well as object pool. Each
+// array is tagged with its element type, which is one of T_BOOLEAN...T_LONG for
+// primitive arrays or T_EXTRA_OBJECT for arrays of references
+//
+// [1]  ->   <3, [elem_a, elem_b, elem_c], T_EXTRA_OBJECT>
+// [2]  ->   <0, [], T_INT>
+// [3]  ->   <2, [elem_a,elem_b], T_CHAR>
+// [4]  ->   <1, [elem_a], T_DOUBLE>
+// [..] ->   <..,[...], ..>
+//--------------------------------------------------------------------------------
+struct InternalArray {
+    size_t length;
+    JType** items;
+    int elementType;
+
+    bool hasReferences() const { return elementType == T_EXTRA_OBJECT; }
+};
+
+//--------------------------------------------------------------------------------
+// The ObjectContainer manages object's fields data, the key also the
+// only way to identify an object is the offset, you can use offset to get
+// object's fields data, push a field data into objects which specified by
+// offset and place a new area to store object fields Here is the internal
+// construction:
+//
+// [1]  ->  [field_a, field_b, field_c]
+// [2]  ->  []
+// [3]  ->  [field_a,field_b]
+// [4]  ->  [field_a]
+// [..] ->  [...]
+//--------------------------------------------------------------------------------
+using InternalObject = vector<JType*>;
+
+// Name of array class in the form of field descriptor, e.g. [I or
+// [Ljava/lang/String;. Element class of reference arrays is unknown if they
+// were not created by anewarray
+string arrayClassName(int elementType, const JavaClass* elementClass);
+
+// Estimated bytes of heap records, which are measured by their headers and
+// slots
+inline size_t sizeOfRecord(const InternalObject& fields) {
+    return sizeof(fields) + fields.size() * sizeof(JType*);
+}
+inline size_t sizeOfRecord(const InternalArray& array) {
+    return sizeof(array) + array.length * sizeof(JType*);
+}
+
+// Release memory of a dead record. Field values of objects are not deleted
+// since they might be shared with other slots
+inline void destroyRecord(InternalObject& fields) { InternalObject().swap(fields); }
+inline void destroyRecord(InternalArray& array) {
+    for (size_t i = 0; i < array.length; i++) {
+        delete array.items[i];
+    }
+    delete[] array.items;
+    array = InternalArray{};
+}
+
+//--------------------------------------------------------------------------------
+// Heap records are placed in fixed-size regions, each of them has
+// YVM_GC_REGION_SLOTS slots. Offset of a record encodes its region index and
+// slot index, i.e. offset = region * YVM_GC_REGION_SLOTS + slot + 1, so that 0
+// is never a valid offset.
+//
+// Besides records, a region keeps its liveness which is accounted while
+// marking, and a remembered set of records in other regions which may refer
+// into this region. They are used by evacuating collector to pick regions with
+// the most garbage and to fix references to evacuated records.
+//
+// A region belongs to either short-lived space or long-lived space, records of
+// sites which are judged long-lived by pretenuring policy are placed in the
+// latter, which is swept rarely.
+//
+// Lock word of each record lives in its region as well and moves along with
+// the record, see LockWord.
+//--------------------------------------------------------------------------------
+template <typename Type>
+struct Region {
+    explicit Region(size_t index, bool longLived = false)
+        : index(index),
+          longLived(longLived),
+          slots(YVM_GC_REGION_SLOTS),
+          used(YVM_GC_REGION_SLOTS, false),
+          classes(YVM_GC_REGION_SLOTS, nullptr),
+          sites(YVM_GC_REGION_SLOTS, nullptr),
+          marks(new atomic_bool[YVM_GC_REGION_SLOTS]()),
+          lockWords(new atomic<uintptr_t>[YVM_GC_REGION_SLOTS]()) {
+        // Lower slots are popped first
+        freeSlots.reserve(YVM_GC_REGION_SLOTS);
+        for (size_t i = YVM_GC_REGION_SLOTS; i > 0; i--) {
+            freeSlots.push_back(i - 1);
+        }
+    }
+
+    bool isMarked(size_t slot) const { return marks[slot]; }
+    void clearMarks() {
+        for (size_t i = 0; i < YVM_GC_REGION_SLOTS; i++) {
+            marks[i] = false;
+        }
+        liveCnt = 0;
+        liveBytes = 0;
+    }
+    size_t garbageBytes() const {
+        return usedBytes > liveBytes ? usedBytes - liveBytes : 0;
+    }
+
+    const size_t index;
+    const bool longLived;
+    vector<Type, HeapAllocator<Type>> slots;
+    vector<bool> used;
+    // Class of each object record, or element class of each reference array
+    // if it's known, which is used by heap inspection
+    vector<const JavaClass*> classes;
+    // Allocation site of each record until its survival has been profiled
+    vector<AllocationSite*> sites;
+    unique_ptr<atomic_bool[]> marks;
+    unique_ptr<atomic<uintptr_t>[]> lockWords;
+    size_t usedCnt = 0;
+    // Records placed into shared buffer are accounted by their threads
+    // concurrently
+    atomic<size_t> usedBytes{0};
+    // Free list of the region, slots freed by sweeper are pushed back here
+    // and allocation pops them without scanning the region
+    vector<size_t> freeSlots;
+
+    atomic<size_t> liveCnt{0};
+    atomic<size_t> liveBytes{0};
+
+    SpinLock rememberedSetSpin;
+    unordered_set<size_t> rememberedObjects;
+    unordered_set<size_t> rememberedArrays;
+
+    // New offsets of evacuated records indexed by slot, 0 for dead records
+    bool inCollectionSet = false;
+    unique_ptr<size_t[]> forwarding;
+};
+
+//--------------------------------------------------------------------------------
+// Each thread claims its own regions to place records, one for short-lived
+// space and one for long-lived space. Nobody else places records into a
+// claimed region, so that records are placed without holding container's
+// lock, which is only acquired when a region runs out of free slots.
+// Claimed regions are given up at every collection, since sweeper and
+// evacuator change their free slots or even release them.
+//
+// First records of a thread are placed into the shared buffer of container
+// under its lock instead, see YVM_GC_SHARED_ALLOCATION_RECORDS
+//--------------------------------------------------------------------------------
+template <typename Type>
+struct AllocationBuffer {
+    Region<Type>* regions[2] = {nullptr, nullptr};
+    // Collection epoch when the regions were claimed
+    size_t epoch = 0;
+    // Records placed by the thread, it's never reset
+    size_t placed = 0;
+};
+
 template <typename Type>
 class Container {
     friend class ConcurrentGC;
+    friend class HeapInspector;
 
 public:
+    using RegionType = Region<Type>;
+
     explicit Container() = default;
-    virtual ~Container() {}
+    ~Container() {
+        for (auto* region : regions) {
+            delete region;
+        }
+        for (auto* region : releasedRegions) {
+            delete region;
+        }
+    }
+
+    // Place a record in the region claimed by the buffer of calling thread,
+    // mtx is the container's lock which guards claiming regions
+    size_t place(AllocationBuffer<Type>& buffer, recursive_mutex& mtx,
+                 const JavaClass* klass, AllocationSite* site);
+    // Account bytes of the record after it has been completely constructed,
+    // and return them
+    size_t account(size_t offset);
+    Type& find(size_t offset) {
+        return regionOf(offset)->slots[slotOf(offset)];
+    }
+    // DITTO, but it's safe to be called without holding container's lock
+    // since regions are looked up in published table. Records never move
+    // outside of safepoints, so the record stays where it is until the
+    // caller reaches a safepoint
+    Type& findLive(size_t offset) {
+        return liveRegionOf(offset)->slots[slotOf(offset)];
+    }
+    Type* tryFind(size_t offset) {
+        auto* region = regionOf(offset);
+        if (region == nullptr || !region->used[slotOf(offset)]) {
+            return nullptr;
+        }
+        return &region->slots[slotOf(offset)];
+    }
+    bool has(size_t offset) { return tryFind(offset) != nullptr; }
+    const JavaClass* classOf(size_t offset) {
+        return regionOf(offset)->classes[slotOf(offset)];
+    }
 
-    virtual size_t place();
-    void remove(size_t offset);
-    Type& find(size_t offset) { return data.find(offset)->second; }
-    bool has(size_t offset) { return data.find(offset) != data.end(); }
+    // Bytes of all records in the container, which is updated as records are
+    // accounted and freed, so that it can be read without stopping the world
+    size_t getUsedBytes() const { return usedBytes; }
 
-protected:
-    auto& getContainer() { return data; }
+    RegionType* regionOf(size_t offset) {
+        const size_t index = (offset - 1) / YVM_GC_REGION_SLOTS;
+        return offset != 0 && index < regions.size() ? regions[index]
+                                                     : nullptr;
+    }
+    // Region of a live record, it's safe to be called without holding
+    // container's lock since regions are looked up in published table
+    RegionType* liveRegionOf(size_t offset) {
+        const size_t index = (offset - 1) / YVM_GC_REGION_SLOTS;
+        return regionTable.load(memory_order_acquire)[index].load(
+            memory_order_acquire);
+    }
+    static size_t slotOf(size_t offset) {
+        return (offset - 1) % YVM_GC_REGION_SLOTS;
+    }
+    static size_t offsetOf(size_t region, size_t slot) {
+        return region * YVM_GC_REGION_SLOTS + slot + 1;
+    }
+    // Lock word of a live record, it's safe to be called without holding
+    // container's lock since regions are looked up in published table
+    atomic<uintptr_t>& lockWordOf(size_t offset) {
+        return liveRegionOf(offset)->lockWords[slotOf(offset)];
+    }
+    // Return new offset if the record was evacuated, otherwise the offset
+    // itself. Destination regions are never in collection set, so that
+    // forwarding an offset twice is harmless
+    size_t forward(size_t offset) {
+        auto* region = regionOf(offset);
+        if (region == nullptr || !region->inCollectionSet) {
+            return offset;
+        }
+        const size_t newOffset = region->forwarding[slotOf(offset)];
+        return newOffset != 0 ? newOffset : offset;
+    }
 
 private:
-    map<size_t, Type, less<>, HeapAllocator<pair<const size_t, Type>>> data;
+    // Mark a live record and account it into its region, return false if it
+    // has already been marked
+    bool mark(size_t offset, size_t bytes);
+    void free(RegionType* region, size_t slot);
+    // Move a record into a free slot of destination region and return its new
+    // offset, the source slot is left unused
+    size_t move(RegionType* from, size_t slot, RegionType* to);
+
+    // Region of the buffer which has free slots, an allocatable region is
+    // picked or a new one is claimed if it's full. Container's lock must be
+    // held
+    RegionType* allocationRegionOf(AllocationBuffer<Type>& buffer,
+                                   bool longLived);
+    static size_t placeIn(RegionType* region, const JavaClass* klass,
+                          AllocationSite* site);
+    RegionType* claimRegion(bool longLived = false);
+    void releaseRegion(RegionType* region);
+    void publishRegion(size_t index, RegionType* region);
+    // Release empty regions and let allocation reuse free slots, which is
+    // called after every collection
+    void resetAllocation();
+    void unaccount(size_t bytes);
+
+protected:
+    vector<RegionType*> regions;
+    vector<size_t> freeRegionIndexes;
+    // Released regions have no records, they are waiting to be freed
+    vector<RegionType*> releasedRegions;
+    vector<size_t> allocatableRegions;
+    // DITTO, but for long-lived space
+    vector<size_t> longLivedAllocatableRegions;
+    // Buffer of threads which have placed few records, it's guarded by
+    // container's lock
+    AllocationBuffer<Type> sharedBuffer;
+    // It's increased by every collection, regions claimed in earlier epochs
+    // are given up by their allocation buffers
+    atomic<size_t> allocationEpoch{1};
+    atomic<size_t> usedBytes{0};
+    // Copy of regions which could be read without holding container's lock.
+    // It's replaced by a bigger one when it's full, and replaced tables are
+    // kept until container is destroyed since they might still be read
+    atomic<atomic<RegionType*>*> regionTable{nullptr};
+    size_t regionTableCapacity = 0;
+    vector<unique_ptr<atomic<RegionType*>[]>> regionTables;
 };
 
 template <typename Type>
-void Container<Type>::remove(size_t offset) {
-    if (data.find(offset) != data.end()) {
-        data.erase(offset);
+size_t Container<Type>::place(AllocationBuffer<Type>& buffer,
+                              recursive_mutex& mtx, const JavaClass* klass,
+                              AllocationSite* site) {
+    const bool longLived = site != nullptr && site->longLived;
+    if (buffer.placed < YVM_GC_SHARED_ALLOCATION_RECORDS) {
+        buffer.placed++;
+        lock_guard<recursive_mutex> lock(mtx);
+        return placeIn(allocationRegionOf(sharedBuffer, longLived), klass,
+                       site);
+    }
+
+    const size_t epoch = allocationEpoch.load(memory_order_acquire);
+    if (buffer.epoch != epoch) {
+        buffer.regions[0] = buffer.regions[1] = nullptr;
+        buffer.epoch = epoch;
+    }
+    RegionType* region = buffer.regions[longLived ? 1 : 0];
+    if (region == nullptr || region->freeSlots.empty()) {
+        lock_guard<recursive_mutex> lock(mtx);
+        region = allocationRegionOf(buffer, longLived);
+    }
+    return placeIn(region, klass, site);
+}
+
+template <typename Type>
+size_t Container<Type>::placeIn(RegionType* region, const JavaClass* klass,
+                                AllocationSite* site) {
+    const size_t slot = region->freeSlots.back();
+    region->freeSlots.pop_back();
+    region->used[slot] = true;
+    region->classes[slot] = klass;
+    region->sites[slot] = site;
+    region->usedCnt++;
+    return offsetOf(region->index, slot);
+}
+
+template <typename Type>
+size_t Container<Type>::account(size_t offset) {
+    auto* region = liveRegionOf(offset);
+    const size_t bytes = sizeOfRecord(region->slots[slotOf(offset)]);
+    region->usedBytes += bytes;
+    usedBytes += bytes;
+    runtime.gc->countAllocation(bytes);
+    return bytes;
+}
+
+template <typename Type>
+void Container<Type>::unaccount(size_t bytes) {
+    size_t current = usedBytes;
+    while (!usedBytes.compare_exchange_weak(current,
+                                            current - min(current, bytes))) {
     }
 }
 
 template <typename Type>
-size_t Container<Type>::place() {
-    size_t lastOffset = 0;
-    if (!data.empty()) {
-        lastOffset = (--data.end())->first;
+bool Container<Type>::mark(size_t offset, size_t bytes) {
+    auto* region = regionOf(offset);
+    if (region->marks[slotOf(offset)].exchange(true)) {
+        return false;
+    }
+    region->liveCnt++;
+    region->liveBytes += bytes;
+    return true;
+}
+
+template <typename Type>
+void Container<Type>::free(RegionType* region, size_t slot) {
+    const size_t bytes = sizeOfRecord(region->slots[slot]);
+    region->usedBytes -= min(region->usedBytes.load(), bytes);
+    unaccount(bytes);
+    destroyRecord(region->slots[slot]);
+    region->used[slot] = false;
+    region->classes[slot] = nullptr;
+    region->sites[slot] = nullptr;
+    region->lockWords[slot] = LockWord::UNLOCKED;
+    region->usedCnt--;
+    region->freeSlots.push_back(slot);
+}
+
+template <typename Type>
+size_t Container<Type>::move(RegionType* from, size_t slot, RegionType* to) {
+    const size_t toSlot = to->freeSlots.back();
+    to->freeSlots.pop_back();
+    const size_t bytes = sizeOfRecord(from->slots[slot]);
+    to->slots[toSlot] = std::move(from->slots[slot]);
+    to->used[toSlot] = true;
+    to->classes[toSlot] = from->classes[slot];
+    to->sites[toSlot] = from->sites[slot];
+    to->lockWords[toSlot] = from->lockWords[slot].load();
+    to->usedCnt++;
+    to->usedBytes += bytes;
+    to->marks[toSlot] = true;
+    to->liveCnt++;
+    to->liveBytes += bytes;
+
+    from->slots[slot] = Type{};
+    from->used[slot] = false;
+    from->classes[slot] = nullptr;
+    from->sites[slot] = nullptr;
+    from->lockWords[slot] = LockWord::UNLOCKED;
+    from->usedCnt--;
+    from->usedBytes -= min(from->usedBytes.load(), bytes);
+    from->freeSlots.push_back(slot);
+    return offsetOf(to->index, toSlot);
+}
+
+template <typename Type>
+Region<Type>* Container<Type>::allocationRegionOf(
+    AllocationBuffer<Type>& buffer, bool longLived) {
+    RegionType*& region = buffer.regions[longLived ? 1 : 0];
+    vector<size_t>& allocatable =
+        longLived ? longLivedAllocatableRegions : allocatableRegions;
+    while (region == nullptr || region->freeSlots.empty()) {
+        region = nullptr;
+        while (region == nullptr && !allocatable.empty()) {
+            region = regions[allocatable.back()];
+            allocatable.pop_back();
+        }
+        if (region == nullptr) {
+            region = claimRegion(longLived);
+        }
+    }
+    return region;
+}
+
+template <typename Type>
+Region<Type>* Container<Type>::claimRegion(bool longLived) {
+    if (!freeRegionIndexes.empty()) {
+        const size_t index = freeRegionIndexes.back();
+        freeRegionIndexes.pop_back();
+        regions[index] = new RegionType(index, longLived);
+        publishRegion(index, regions[index]);
+        return regions[index];
+    }
+    regions.push_back(new RegionType(regions.size(), longLived));
+    publishRegion(regions.size() - 1, regions.back());
+    return regions.back();
+}
+
+template <typename Type>
+void Container<Type>::releaseRegion(RegionType* region) {
+    regions[region->index] = nullptr;
+    publishRegion(region->index, nullptr);
+    freeRegionIndexes.push_back(region->index);
+    releasedRegions.push_back(region);
+}
+
+template <typename Type>
+void Container<Type>::publishRegion(size_t index, RegionType* region) {
+    if (index >= regionTableCapacity) {
+        const size_t capacity = max(index + 1, regionTableCapacity * 2);
+        auto* table = new atomic<RegionType*>[capacity]();
+        for (size_t i = 0; i < regionTableCapacity; i++) {
+            table[i] = regionTable.load()[i].load();
+        }
+        regionTables.emplace_back(table);
+        regionTableCapacity = capacity;
+        regionTable = table;
+    }
+    regionTable.load()[index] = region;
+}
+
+template <typename Type>
+void Container<Type>::resetAllocation() {
+    allocationEpoch++;
+    sharedBuffer.regions[0] = sharedBuffer.regions[1] = nullptr;
+    allocatableRegions.clear();
+    longLivedAllocatableRegions.clear();
+    for (auto* region : regions) {
+        if (region == nullptr) {
+            continue;
+        }
+        if (region->usedCnt == 0) {
+            releaseRegion(region);
+        } else if (!region->freeSlots.empty()) {
+            (region->longLived ? longLivedAllocatableRegions
+                               : allocatableRegions)
+                .push_back(region->index);
+        }
     }
-    data.insert(make_pair(lastOffset + 1, Type{}));
-    return lastOffset + 1;
 }
 
-//--------------------------------------------------------------------------------
-// The ArrayContainer manages array's elements as well as object pool
-//
-// [1]  ->   <3, [field_a, field_b, field_c]>
-// [2]  ->   <0, []>
-// [3]  ->   <2, [field_a,field_b]>
-// [4]  ->   <1, [field_a]>
-// [..] ->   <..,[...]>
-//--------------------------------------------------------------------------------
-using InternalArray = pair<size_t, JType**>;
 struct ArrayContainer : public Container<InternalArray> {
-    ~ArrayContainer() override {
-        for (auto intPairPair : getContainer()) {
-            for (size_t i = 0; i < intPairPair.second.first; i++) {
-                delete intPairPair.second.second[i];
+    ~ArrayContainer() {
+        for (auto* region : regions) {
+            for (size_t i = 0; region != nullptr && i < YVM_GC_REGION_SLOTS;
+                 i++) {
+                if (region->used[i]) {
+                    destroyRecord(region->slots[i]);
+                }
             }
-            delete[] intPairPair.second.second;
         }
     }
 };
-//--------------------------------------------------------------------------------
-// The ObjectContainer manages object's fields data, the key also the
-// only way to identify an object is the offset, you can use offset to get
-// object's fields data, push a field data into objects which specified by
-// offset and place a new area to store object fields Here is the internal
-// construction:
-//
-// [1]  ->  [field_a, field_b, field_c]
-// [2]  ->  []
-// [3]  ->  [field_a,field_b]
-// [4]  ->  [field_a]
-// [..] ->  [...]
-//--------------------------------------------------------------------------------
-using InternalObject = vector<JType*>;
 struct ObjectContainer : public Container<InternalObject> {
-    ~ObjectContainer() override {
-        for (auto intVecPair : getContainer()) {
-            for (auto ptr : intVecPair.second) {
-                delete ptr;
+    ~ObjectContainer() {
+        for (auto* region : regions) {
+            for (size_t i = 0; region != nullptr && i < YVM_GC_REGION_SLOTS;
+                 i++) {
+                for (auto ptr : region->slots[i]) {
+                    delete ptr;
+                }
             }
         }
     }
 };
 
 //--------------------------------------------------------------------------------
-// MonitorContainer manages synchronous block monitors as well as the
-// above
-//
-// [1]  ->   ObjectMonitor*
-// [2]  ->   ObjectMonitor*
-// [3]  ->   ObjectMonitor*
-// [4]  ->   ObjectMonitor*
-// [..] ->   ObjectMonitor*// MonitorContainer manages synchronous block
-// monitors as well as the above
+// MonitorContainer manages inflated monitors, monitor ids are allocated in
+// their own number space and stored in lock words. Ids and monitors of
+// deflated monitors are recycled by later inflation
 //
 // [1]  ->   ObjectMonitor*
 // [2]  ->   ObjectMonitor*
@@ -133,20 +548,28 @@ struct ObjectContainer : public Container<InternalObject> {
 // [..] ->   ObjectMonitor*
 //--------------------------------------------------------------------------------
 using InternalMonitor = ObjectMonitor*;
-struct MonitorContainer : public Container<InternalMonitor> {
-    ~MonitorContainer() override {
-        for (auto intMonitorPair : getContainer()) {
-            delete intMonitorPair.second;
+struct MonitorContainer {
+    ~MonitorContainer() {
+        for (auto monitor : monitors) {
+            delete monitor;
         }
     }
-    size_t place() override {
-        size_t lastOffset = 0;
-        if (!getContainer().empty()) {
-            lastOffset = (--getContainer().end())->first;
+    size_t place(uintptr_t owner, int32_t count) {
+        if (!freeIds.empty()) {
+            const size_t id = freeIds.back();
+            freeIds.pop_back();
+            monitors[id - 1]->reset(owner, count);
+            return id;
         }
-        getContainer().insert(make_pair(lastOffset + 1, new ObjectMonitor()));
-        return lastOffset + 1;
+        monitors.push_back(new ObjectMonitor(owner, count));
+        return monitors.size();
     }
+    InternalMonitor& find(size_t id) { return monitors[id - 1]; }
+    void remove(size_t id) { freeIds.push_back(id); }
+    size_t size() const { return monitors.size() - freeIds.size(); }
+
+    vector<InternalMonitor, HeapAllocator<InternalMonitor>> monitors;
+    vector<size_t> freeIds;
 };
 //--------------------------------------------------------------------------------
 // Java heap holds instance's fields data which object referred to and elements
@@ -156,92 +579,133 @@ struct MonitorContainer : public Container<InternalMonitor> {
 class JavaHeap {
     friend class Interpreter;
     friend class ConcurrentGC;
+    friend class HeapInspector;
 
 public:
     JavaHeap() = default;
 
-    JObject* createObject(const JavaClass& javaClass);
-    JArray* createPODArray(int atype, int length);
-    JArray* createObjectArray(const JavaClass& jc, int length);
+    // Allocation site is given by interpreter if pretenuring is enabled
+    JObject* createObject(const JavaClass& javaClass,
+                          AllocationSite* site = nullptr);
+    JArray* createPODArray(int atype, int length,
+                           AllocationSite* site = nullptr);
+    JArray* createObjectArray(const JavaClass& jc, int length,
+                              AllocationSite* site = nullptr);
     JArray* createCharArray(const string& source, size_t length);
 
+    // Slot of the field declared by desireLookup in objects of currentLookup,
+    // or NO_FIELD if there is no such field. Layout of a class never changes,
+    // so the slot could be remembered for the class of receiver
+    static size_t fieldSlotOf(const JavaClass* desireLookup,
+                              const JavaClass* currentLookup,
+                              const string& name, const string& descriptor);
+    static constexpr size_t NO_FIELD = static_cast<size_t>(-1);
+
     auto getFieldByName(const JavaClass* jc, const string& name,
                         const string& descriptor, JObject* object) {
-        return getFieldByNameImpl(jc, object->jc, name, descriptor, object, 0);
+        const size_t slot = fieldSlotOf(jc, object->jc, name, descriptor);
+        return slot != NO_FIELD ? getFieldByOffset(*object, slot) : nullptr;
     }
     void putFieldByName(const JavaClass* jc, const string& name,
                         const string& descriptor, JObject* object,
                         JType* value) {
-        putFieldByNameImpl(jc, object->jc, name, descriptor, object, value, 0);
+        const size_t slot = fieldSlotOf(jc, object->jc, name, descriptor);
+        if (slot != NO_FIELD) {
+            putFieldByOffset(*object, slot, value);
+        }
     }
+    // Fields and elements are read and written without heap locks, a record
+    // is only moved or freed at safepoints while mutators are stopped. Slots
+    // are accessed atomically so that racy java code can't tear them
     void putFieldByOffset(const JObject& object, size_t fieldOffset,
                           JType* value) {
-        lock_guard<recursive_mutex> lock(objMtx);
-        objectContainer.find(object.offset)[fieldOffset] = value;
+        atomicSlot(objectContainer.findLive(object.offset)[fieldOffset])
+            .store(value, memory_order_release);
+        writeBarrier(false, object.offset, value);
     }
-    auto getFieldByOffset(const JObject& object, size_t fieldOffset) {
-        lock_guard<recursive_mutex> lock(objMtx);
-        return objectContainer.find(object.offset)[fieldOffset];
+    JType* getFieldByOffset(const JObject& object, size_t fieldOffset) {
+        return atomicSlot(objectContainer.findLive(object.offset)[fieldOffset])
+            .load(memory_order_acquire);
     }
-    auto getFields(JObject* object) {
-        lock_guard<recursive_mutex> lockMA(objMtx);
-        return objectContainer.find(object->offset);
+    auto& getFields(JObject* object) {
+        return objectContainer.findLive(object->offset);
     }
 
     void putElement(const JArray& array, size_t index, JType* value) {
-        lock_guard<recursive_mutex> lock(arrMtx);
-        arrayContainer.find(array.offset).second[index] = value;
+        atomicSlot(arrayContainer.findLive(array.offset).items[index])
+            .store(value, memory_order_release);
+        writeBarrier(true, array.offset, value);
     }
-    auto getElement(const JArray& array, size_t index) {
-        lock_guard<recursive_mutex> lock(arrMtx);
-        return arrayContainer.find(array.offset).second[index];
+    JType* getElement(const JArray& array, size_t index) {
+        return atomicSlot(arrayContainer.findLive(array.offset).items[index])
+            .load(memory_order_acquire);
     }
-    auto getElements(JArray* array) {
-        lock_guard<recursive_mutex> lockMA(arrMtx);
-        return arrayContainer.find(array->offset);
+    auto& getElements(JArray* array) {
+        return arrayContainer.findLive(array->offset);
     }
 
-    void removeArray(size_t offset) {
-        lock_guard<recursive_mutex> lock(arrMtx);
-        arrayContainer.remove(offset);
-    }
-    void removeObject(size_t offset) {
-        lock_guard<recursive_mutex> lock(objMtx);
-        objectContainer.remove(offset);
+    // Slots which natives of atomic classes access by atomic operations
+    // rather than under heap locks. Natives are not safe for GC, so the
+    // record is neither moved nor freed until they return
+    atomic<JType*>& atomicField(const JObject& object, size_t fieldOffset);
+    atomic<JType*>& atomicElement(const JArray& array, size_t index);
+    // Record a reference stored into a slot returned above
+    void rememberReference(bool holderIsArray, size_t holder,
+                           const JType* value) {
+        writeBarrier(holderIsArray, holder, value);
     }
 
-    bool hasMonitor(const JType* ref) {
-        lock_guard<recursive_mutex> lock(monitorMtx);
-        return monitorContainer.has(dynamic_cast<const JObject*>(ref)->offset);
-    }
-    auto createMonitor() {
-        lock_guard<recursive_mutex> lock(monitorMtx);
-        return monitorContainer.place();
-    }
-    auto findMonitor(const JType* ref) {
-        lock_guard<recursive_mutex> lock(monitorMtx);
-        return monitorContainer.find(dynamic_cast<const JObject*>(ref)->offset);
+    // Lock the object or array by its lock word. nullptr is returned if the
+    // lock has been acquired, otherwise the lock is contended and it has been
+    // inflated, the returned monitor must be entered by caller
+    ObjectMonitor* enterMonitor(const JType* ref, uintptr_t lockId);
+    void exitMonitor(const JType* ref, uintptr_t lockId);
+    // Return inflated monitor of the record which must be locked by the
+    // thread. Thin lock is inflated if inflating is requested, otherwise
+    // nullptr is returned for it
+    ObjectMonitor* ownedMonitor(const JType* ref, uintptr_t lockId,
+                                bool inflating);
+    // Attach a new synchronizer to the record, its lock is inflated so that
+    // the synchronizer lives in the monitor
+    Synchronizer* createSynchronizer(const JType* ref, int32_t state);
+    Synchronizer* findSynchronizer(const JType* ref);
+
+    // Estimated bytes of all objects and arrays
+    size_t getUsedBytes() const {
+        return objectContainer.getUsedBytes() + arrayContainer.getUsedBytes();
     }
 
+    // Remembered sets are merely maintained for evacuating collector
+    void enableRememberedSet() { rememberedSetEnabled = true; }
+
 private:
-    void createSuperFields(const JavaClass& javaClass, const JObject* object);
+    // Record the holder in remembered set of the region where the referenced
+    // record lives, if they are in different regions
+    void writeBarrier(bool holderIsArray, size_t holder, const JType* value);
 
-    JType* getFieldByNameImpl(const JavaClass* desireLookup,
-                              const JavaClass* currentLookup,
-                              const string& name, const string& descriptor,
-                              JObject* object, size_t offset = 0);
-    void putFieldByNameImpl(const JavaClass* desireLookup,
-                            const JavaClass* currentLookup, const string& name,
-                            const string& descriptor, JObject* object,
-                            JType* value, size_t offset = 0);
+    atomic<uintptr_t>& lockWordOf(const JType* ref);
+    ObjectMonitor* findMonitor(uintptr_t word);
+    // Replace the thin lock word by an inflated one which inherits its owner
+    // and count, return the monitor or nullptr if the word has been changed
+    ObjectMonitor* inflate(atomic<uintptr_t>& lockWord, uintptr_t word);
+
+    static atomic<JType*>& atomicSlot(JType*& slot) {
+        return *reinterpret_cast<atomic<JType*>*>(&slot);
+    }
 
 private:
     ObjectContainer objectContainer;
     ArrayContainer arrayContainer;
     MonitorContainer monitorContainer;
 
+    // They guard claiming regions of containers rather than every allocation,
+    // see AllocationBuffer
     recursive_mutex objMtx;
     recursive_mutex arrMtx;
     recursive_mutex monitorMtx;
+    static thread_local AllocationBuffer<InternalObject> objectBuffer;
+    static thread_local AllocationBuffer<InternalArray> arrayBuffer;
+
+    bool rememberedSetEnabled = false;
 };
 #endif  // YVM_JAVAHEAP_H
@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "../interpreter/SymbolicRef.h"
+#include "Futex.h"
+#include "JavaThread.h"
+#include "VirtualThread.h"
+
+using namespace std;
+
+thread_local JavaThread* ThreadRegistry::boundThread = nullptr;
+
+JavaThread::JavaThread(JavaFrame* frames)
+    : frames(frames),
+      id(this_thread::get_id()),
+      lockId(nextLockId()),
+      state(ThreadState::BLOCKED),
+      atSafepoint(false),
+      interrupted(false),
+      parkPermit(0),
+      pendingException(nullptr),
+      threadObject(nullptr),
+      vthread(nullptr),
+      monitorProfile(nullptr),
+      resolution(new ResolutionCache) {}
+
+JavaThread::~JavaThread() { delete resolution; }
+
+uintptr_t JavaThread::nextLockId() {
+    static atomic<uintptr_t> lastLockId{0};
+    return ++lastLockId;
+}
+
+void JavaThread::park(const chrono::nanoseconds* timeout) {
+    if (vthread != nullptr) {
+        vthread->park(timeout);
+        return;
+    }
+    if (parkPermit.exchange(0) == 1) {
+        return;
+    }
+    futexWait(&parkPermit, 0, timeout);
+    parkPermit = 0;
+}
+
+void JavaThread::unpark() {
+    if (vthread != nullptr) {
+        vthread->unpark();
+        return;
+    }
+    if (parkPermit.exchange(1) == 0) {
+        futexWake(&parkPermit);
+    }
+}
+
+void JavaThread::yield() {
+    if (vthread != nullptr) {
+        vthread->yield();
+    } else {
+        this_thread::yield();
+    }
+}
+
+void ThreadRegistry::attach(JavaThread* thread) {
+    if (boundThread == nullptr && VirtualThread::current() == nullptr) {
+        boundThread = thread;
+    }
+    lock_guard<mutex> lock(registryMtx);
+    threads.insert(thread);
+}
+
+void ThreadRegistry::detach(JavaThread* thread) {
+    if (boundThread == thread) {
+        boundThread = nullptr;
+    }
+    lock_guard<mutex> lock(registryMtx);
+    threads.erase(thread);
+}
+
+vector<JavaThread*> ThreadRegistry::getThreads() {
+    lock_guard<mutex> lock(registryMtx);
+    return vector<JavaThread*>(threads.begin(), threads.end());
+}
+
+JavaThread* ThreadRegistry::current() {
+    if (VirtualThread* vthread = VirtualThread::current()) {
+        return vthread->getThread();
+    }
+    return boundThread;
+}
+
+bool ThreadRegistry::interrupt(uintptr_t lockId) {
+    // The thread can't detach itself and go away meanwhile
+    lock_guard<mutex> lock(registryMtx);
+    for (JavaThread* thread : threads) {
+        if (thread->lockId == lockId) {
+            thread->interrupt();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadRegistry::unpark(uintptr_t lockId) {
+    lock_guard<mutex> lock(registryMtx);
+    for (JavaThread* thread : threads) {
+        if (thread->lockId == lockId) {
+            thread->unpark();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadRegistry::isInterrupted(uintptr_t lockId) {
+    lock_guard<mutex> lock(registryMtx);
+    for (JavaThread* thread : threads) {
+        if (thread->lockId == lockId) {
+            return thread->interrupted;
+        }
+    }
+    return false;
+}
+
+void ThreadRegistry::spawn(function<void()> body) {
+    lock_guard<mutex> lock(spawnMtx);
+    reapTerminated();
+    thread nativeThread([this, body]() -> void {
+        body();
+        // Its native thread could be joined once it's listed here
+        lock_guard<mutex> lock(spawnMtx);
+        terminated.push_back(this_thread::get_id());
+        terminatedCnd.notify_all();
+    });
+    const thread::id id = nativeThread.get_id();
+    nativeThreads.emplace(id, std::move(nativeThread));
+}
+
+void ThreadRegistry::reapTerminated() {
+    for (const thread::id& id : terminated) {
+        auto iter = nativeThreads.find(id);
+        iter->second.join();
+        nativeThreads.erase(iter);
+    }
+    terminated.clear();
+}
+
+void ThreadRegistry::joinAll() {
+    unique_lock<mutex> lock(spawnMtx);
+    while (true) {
+        reapTerminated();
+        if (nativeThreads.empty()) {
+            return;
+        }
+        terminatedCnd.wait(lock);
+    }
+}
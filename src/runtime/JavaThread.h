@@ -0,0 +1,153 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_JAVATHREAD_H
+#define YVM_JAVATHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class JavaFrame;
+struct JObject;
+class ResolutionCache;
+struct ThreadMonitorProfile;
+class VirtualThread;
+
+//--------------------------------------------------------------------------------
+// JavaThread represents a thread which executes java code. Every interpreter
+// owns one and attaches it to the thread registry, thus garbage collector
+// could find roots on stacks of all threads rather than triggering thread only.
+// It's also the context of the thread which is passed to natives, state which
+// is only touched by its owner lives here so that it needs no lock
+//--------------------------------------------------------------------------------
+// Natives of yvm manipulate heap directly, so unlike blocked threads, threads
+// executing native code are not safe for garbage collection
+enum class ThreadState { IN_JAVA, IN_NATIVE, BLOCKED };
+
+struct JavaThread {
+    explicit JavaThread(JavaFrame* frames);
+    ~JavaThread();
+    JavaThread(const JavaThread&) = delete;
+    JavaThread& operator=(const JavaThread&) = delete;
+
+    // Block until the permit is available and consume it, or until the
+    // timeout expires if it's given. It may return spuriously
+    void park(const std::chrono::nanoseconds* timeout = nullptr);
+    // Make the permit available, a parked thread is woken up
+    void unpark();
+    // Give up the processor, a virtual thread gives up its carrier
+    void yield();
+    void interrupt() {
+        interrupted = true;
+        unpark();
+    }
+
+    JavaFrame* frames;
+    // Native thread which executes java code, i.e. the thread created it. It's
+    // meaningless for virtual threads
+    const std::thread::id id;
+    // Owner of locks held by this thread, it's never 0 and never reused
+    const uintptr_t lockId;
+    std::atomic<ThreadState> state;
+    // Whether this thread has parked itself at current safepoint, it's
+    // guarded by the safepoint lock
+    bool atSafepoint;
+    std::atomic_bool interrupted;
+    // Futex word of parking, it's 1 if the permit is available
+    std::atomic<uint32_t> parkPermit;
+    // Exception thrown by native method, which is raised by interpreter after
+    // the native method returns
+    JObject* pendingException;
+    // java.lang.Thread object of this thread, it's a GC root. Threads which
+    // were not started by Thread.start() get it lazily
+    JObject* threadObject;
+    // Virtual thread which runs this thread, or nullptr if it owns a native
+    // thread. Virtual threads park on their own permits
+    VirtualThread* vthread;
+    // Monitor statistics of this thread, it's created by monitor profiler
+    // lazily and owned by it
+    ThreadMonitorProfile* monitorProfile;
+    // Constant pool entries resolved by this thread, interpreter consults it
+    // before asking class space which is shared by all threads
+    ResolutionCache* const resolution;
+
+private:
+    static uintptr_t nextLockId();
+};
+
+class ThreadRegistry {
+public:
+    void attach(JavaThread* thread);
+    void detach(JavaThread* thread);
+
+    // Return all attached threads at this moment
+    std::vector<JavaThread*> getThreads();
+    // Return java thread of the calling native thread, or the virtual thread
+    // mounted on it, or nullptr if it doesn't execute java code. It reads
+    // thread locals only, code which owns its JavaThread should use it
+    // directly anyway
+    JavaThread* current();
+    // Interrupt the attached thread with given lock id, return false if
+    // there is no such thread
+    bool interrupt(uintptr_t lockId);
+    // Make the permit of the attached thread with given lock id available,
+    // return false if there is no such thread
+    bool unpark(uintptr_t lockId);
+    // Return whether the attached thread with given lock id was interrupted
+    bool isInterrupted(uintptr_t lockId);
+
+    // Run the body on a new native thread, which is bound to one java thread
+    // for its whole life. Native threads which have terminated are joined by
+    // later spawns and by joinAll(), so their resources are reclaimed
+    void spawn(std::function<void()> body);
+    // Block until all spawned threads have terminated, including threads
+    // spawned meanwhile
+    void joinAll();
+
+private:
+    // Join terminated native threads, spawnMtx must be held
+    void reapTerminated();
+
+    // Java thread bound to the calling native thread, i.e. the first one
+    // attached by it. Virtual threads are attached by their starters, so they
+    // are never bound
+    static thread_local JavaThread* boundThread;
+
+    std::mutex registryMtx;
+    std::unordered_set<JavaThread*> threads;
+
+    std::mutex spawnMtx;
+    std::condition_variable terminatedCnd;
+    std::unordered_map<std::thread::id, std::thread> nativeThreads;
+    std::vector<std::thread::id> terminated;
+};
+
+#endif  // YVM_JAVATHREAD_H
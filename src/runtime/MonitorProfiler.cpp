@@ -0,0 +1,270 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "MonitorProfiler.h"
+#include <algorithm>
+#include <typeinfo>
+#include "../misc/Option.h"
+#include "JavaClass.h"
+#include "JavaFrame.hpp"
+#include "JavaThread.h"
+#include "JavaType.h"
+#include "ObjectMonitor.h"
+
+void MonitorProfiler::Stats::add(const Contention* contention,
+                                 int64_t waitNanos) {
+    acquisitions++;
+    if (contention == nullptr) {
+        return;
+    }
+    contended++;
+    this->waitNanos += waitNanos;
+    maxWaitNanos = max(maxWaitNanos, waitNanos);
+    owners[contention->ownerSite]++;
+}
+
+void MonitorProfiler::Stats::merge(const Stats& other) {
+    acquisitions += other.acquisitions;
+    contended += other.contended;
+    waitNanos += other.waitNanos;
+    maxWaitNanos = max(maxWaitNanos, other.maxWaitNanos);
+    for (auto& owner : other.owners) {
+        owners[owner.first] += owner.second;
+    }
+}
+
+void MonitorProfiler::initialize(const VMOption& option) {
+    enabled = option.profileMonitorContention;
+}
+
+MonitorProfiler::MonitorId MonitorProfiler::monitorIdOf(const JType* ref) {
+    if (typeid(*ref) == typeid(JObject)) {
+        auto* object = static_cast<const JObject*>(ref);
+        return {false, object->offset, object->jc};
+    }
+    return {true, static_cast<const JArray*>(ref)->offset, nullptr};
+}
+
+ThreadMonitorProfile* MonitorProfiler::profileOf(JavaThread* thread) {
+    if (thread->monitorProfile == nullptr) {
+        auto* profile = new ThreadMonitorProfile;
+        lock_guard<mutex> lock(profilesMtx);
+        profiles[thread->lockId].reset(profile);
+        thread->monitorProfile = profile;
+    }
+    return thread->monitorProfile;
+}
+
+bool MonitorProfiler::beginContention(const ObjectMonitor* monitor,
+                                      const JType* ref, uintptr_t lockId,
+                                      Contention& contention) {
+    const uintptr_t owner = monitor->getOwner();
+    if (owner == 0 || owner == lockId) {
+        return false;
+    }
+    contention.ownerSite = {nullptr, nullptr, 0};
+    contention.since = chrono::steady_clock::now();
+
+    // Owner may have exited the monitor meanwhile, then its site is unknown
+    const MonitorId id = monitorIdOf(ref);
+    lock_guard<mutex> lock(profilesMtx);
+    auto iter = profiles.find(owner);
+    if (iter != profiles.end()) {
+        ThreadMonitorProfile& profile = *iter->second;
+        lock_guard<mutex> heldLock(profile.profileMtx);
+        for (auto held = profile.held.rbegin(); held != profile.held.rend();
+             ++held) {
+            if (held->first == id) {
+                contention.ownerSite = held->second;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void MonitorProfiler::recordEnter(JavaThread* thread, const Slots* frame,
+                                  const JType* ref,
+                                  const Contention* contention) {
+    const int64_t waitNanos =
+        contention != nullptr
+            ? chrono::duration_cast<chrono::nanoseconds>(
+                  chrono::steady_clock::now() - contention->since)
+                  .count()
+            : 0;
+    const MonitorId id = monitorIdOf(ref);
+    const Site site = frame->method != nullptr
+                          ? Site{frame->jc, frame->method, frame->bci}
+                          : Site{nullptr, nullptr, 0};
+
+    ThreadMonitorProfile* profile = profileOf(thread);
+    lock_guard<mutex> lock(profile->profileMtx);
+    profile->sites[site].add(contention, waitNanos);
+    profile->monitors[id].add(contention, waitNanos);
+    profile->held.emplace_back(id, site);
+}
+
+void MonitorProfiler::recordExit(JavaThread* thread, const JType* ref) {
+    ThreadMonitorProfile* profile = profileOf(thread);
+    const MonitorId id = monitorIdOf(ref);
+    lock_guard<mutex> lock(profile->profileMtx);
+    for (auto held = profile->held.rbegin(); held != profile->held.rend();
+         ++held) {
+        if (held->first == id) {
+            profile->held.erase(next(held).base());
+            break;
+        }
+    }
+}
+
+void MonitorProfiler::retire(JavaThread* thread) {
+    if (thread->monitorProfile == nullptr) {
+        return;
+    }
+    lock_guard<mutex> lock(profilesMtx);
+    for (auto& site : thread->monitorProfile->sites) {
+        retiredSites[site.first].merge(site.second);
+    }
+    for (auto& monitor : thread->monitorProfile->monitors) {
+        retiredMonitors[monitor.first].merge(monitor.second);
+    }
+    profiles.erase(thread->lockId);
+    thread->monitorProfile = nullptr;
+}
+
+string MonitorProfiler::monitorName(const MonitorId& monitor) {
+    string name = monitor.isArray ? "array" : monitor.jc->getClassName();
+    replace(name.begin(), name.end(), '/', '.');
+    char offset[32];
+    snprintf(offset, sizeof offset, "@%zx", monitor.offset);
+    return name + offset;
+}
+
+void MonitorProfiler::printSite(FILE* out, const char* prefix,
+                                const Site& site) {
+    if (site.method == nullptr) {
+        fprintf(out, "%s<unknown>", prefix);
+    } else {
+        fprintf(out, "%s%s", prefix,
+                site.jc->getSourceLocation(site.method, site.bci).c_str());
+    }
+}
+
+// Rank entries by wait time, then by contended and total acquisitions
+template <typename Key>
+static vector<pair<const Key*, const MonitorProfiler::Stats*>> rankByWait(
+    const map<Key, MonitorProfiler::Stats>& stats) {
+    vector<pair<const Key*, const MonitorProfiler::Stats*>> ranked;
+    for (auto& entry : stats) {
+        ranked.emplace_back(&entry.first, &entry.second);
+    }
+    sort(ranked.begin(), ranked.end(),
+         [](const pair<const Key*, const MonitorProfiler::Stats*>& a,
+            const pair<const Key*, const MonitorProfiler::Stats*>& b) {
+             return tie(a.second->waitNanos, a.second->contended,
+                        a.second->acquisitions) >
+                    tie(b.second->waitNanos, b.second->contended,
+                        b.second->acquisitions);
+         });
+    if (ranked.size() > YVM_MONITOR_REPORT_ENTRIES) {
+        ranked.resize(YVM_MONITOR_REPORT_ENTRIES);
+    }
+    return ranked;
+}
+
+static void printStats(FILE* out, const MonitorProfiler::Stats& stats) {
+    fprintf(out,
+            "%zu acquisitions, %zu contended (%.1f%%), wait %.3f ms total, "
+            "%.3f ms max\n",
+            stats.acquisitions, stats.contended,
+            stats.acquisitions > 0
+                ? stats.contended * 100.0 / stats.acquisitions
+                : 0.0,
+            stats.waitNanos / 1e6, stats.maxWaitNanos / 1e6);
+}
+
+void MonitorProfiler::printReport(FILE* out) {
+    map<Site, Stats> sites;
+    map<MonitorId, Stats> monitors;
+    {
+        lock_guard<mutex> lock(profilesMtx);
+        sites = retiredSites;
+        monitors = retiredMonitors;
+        for (auto& entry : profiles) {
+            ThreadMonitorProfile& profile = *entry.second;
+            lock_guard<mutex> profileLock(profile.profileMtx);
+            for (auto& site : profile.sites) {
+                sites[site.first].merge(site.second);
+            }
+            for (auto& monitor : profile.monitors) {
+                monitors[monitor.first].merge(monitor.second);
+            }
+        }
+    }
+
+    Stats total;
+    for (auto& site : sites) {
+        total.merge(site.second);
+    }
+    fprintf(out, "[monitor] %zu monitors: ", monitors.size());
+    printStats(out, total);
+
+    // Owners are printed from the most frequent one
+    auto printOwners = [out](const Stats& stats) {
+        vector<pair<size_t, Site>> owners;
+        for (auto& owner : stats.owners) {
+            owners.emplace_back(owner.second, owner.first);
+        }
+        sort(owners.begin(), owners.end(),
+             [](const pair<size_t, Site>& a, const pair<size_t, Site>& b) {
+                 return a.first > b.first;
+             });
+        for (size_t i = 0; i < owners.size() && i < YVM_MONITOR_REPORT_OWNERS;
+             i++) {
+            printSite(out, "[monitor]     owned at ", owners[i].second);
+            fprintf(out, " (%zu times)\n", owners[i].first);
+        }
+    };
+
+    auto rankedSites = rankByWait(sites);
+    for (size_t i = 0; i < rankedSites.size(); i++) {
+        const string prefix = "[monitor] site #" + to_string(i + 1) + " ";
+        printSite(out, prefix.c_str(), *rankedSites[i].first);
+        fprintf(out, ": ");
+        printStats(out, *rankedSites[i].second);
+        printOwners(*rankedSites[i].second);
+    }
+    auto rankedMonitors = rankByWait(monitors);
+    for (size_t i = 0; i < rankedMonitors.size(); i++) {
+        fprintf(out, "[monitor] monitor #%zu %s: ", i + 1,
+                monitorName(*rankedMonitors[i].first).c_str());
+        printStats(out, *rankedMonitors[i].second);
+        printOwners(*rankedMonitors[i].second);
+    }
+}
+
+void MonitorProfiler::finish() {
+    if (enabled) {
+        printReport(stderr);
+    }
+}
@@ -0,0 +1,147 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_MONITORPROFILER_H
+#define YVM_MONITORPROFILER_H
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "../interpreter/Internal.h"
+
+using namespace std;
+
+class JavaClass;
+class ObjectMonitor;
+class Slots;
+struct JType;
+struct JavaThread;
+struct MethodInfo;
+struct ThreadMonitorProfile;
+struct VMOption;
+
+//--------------------------------------------------------------------------------
+// Monitor profiler counts acquisitions of every monitor and every bytecode
+// site which enters monitors, i.e. monitorenter and entry of synchronized
+// methods. An acquisition is contended if another thread owned the monitor
+// when this thread reached it, then the time until it's acquired is counted
+// as wait time, and the site where the owner had entered the monitor is
+// counted as the owner of contention.
+//
+// Statistics are kept per thread and merged when a thread terminates or a
+// report is printed, so that profiling doesn't add contention on its own.
+// Monitors are identified by records, a record which was moved by evacuation
+// is counted as a new one. Report is printed at exit and on SIGQUIT.
+//--------------------------------------------------------------------------------
+class MonitorProfiler {
+public:
+    struct Site {
+        const JavaClass* jc;
+        const MethodInfo* method;
+        u4 bci;
+
+        bool operator<(const Site& rhs) const {
+            return tie(jc, method, bci) < tie(rhs.jc, rhs.method, rhs.bci);
+        }
+    };
+    struct MonitorId {
+        bool isArray;
+        size_t offset;
+        const JavaClass* jc;  // Absent for arrays
+
+        bool operator<(const MonitorId& rhs) const {
+            return tie(isArray, offset) < tie(rhs.isArray, rhs.offset);
+        }
+        bool operator==(const MonitorId& rhs) const {
+            return isArray == rhs.isArray && offset == rhs.offset;
+        }
+    };
+    // Monitor which this thread found owned by another thread
+    struct Contention {
+        Site ownerSite;
+        chrono::steady_clock::time_point since;
+    };
+    struct Stats {
+        size_t acquisitions = 0;
+        size_t contended = 0;
+        int64_t waitNanos = 0;
+        int64_t maxWaitNanos = 0;
+        // Sites where owners had entered the monitor when it was contended
+        map<Site, size_t> owners;
+
+        void add(const Contention* contention, int64_t waitNanos);
+        void merge(const Stats& other);
+    };
+
+    void initialize(const VMOption& option);
+    bool isEnabled() const { return enabled; }
+
+    // Return false if the monitor is not owned by another thread, otherwise
+    // it fills the contention, which must be passed to recordEnter() once
+    // this thread has entered the monitor
+    bool beginContention(const ObjectMonitor* monitor, const JType* ref,
+                         uintptr_t lockId, Contention& contention);
+    // Frame is the one which entered the monitor, contention is nullptr if
+    // the acquisition was uncontended
+    void recordEnter(JavaThread* thread, const Slots* frame, const JType* ref,
+                     const Contention* contention);
+    void recordExit(JavaThread* thread, const JType* ref);
+    // Merge statistics of a terminating thread
+    void retire(JavaThread* thread);
+
+    void printReport(FILE* out);
+    void finish();
+
+private:
+    static MonitorId monitorIdOf(const JType* ref);
+    static string monitorName(const MonitorId& monitor);
+    static void printSite(FILE* out, const char* prefix, const Site& site);
+    ThreadMonitorProfile* profileOf(JavaThread* thread);
+
+    bool enabled = false;
+
+    // Profiles of live threads by their lock ids, statistics of terminated
+    // threads are merged into retired ones
+    mutex profilesMtx;
+    unordered_map<uintptr_t, unique_ptr<ThreadMonitorProfile>> profiles;
+    map<Site, Stats> retiredSites;
+    map<MonitorId, Stats> retiredMonitors;
+};
+
+// Statistics of a single thread, it's locked by the thread while it's updated,
+// and by contenders which look for sites of monitors held by the thread
+struct ThreadMonitorProfile {
+    mutex profileMtx;
+    map<MonitorProfiler::Site, MonitorProfiler::Stats> sites;
+    map<MonitorProfiler::MonitorId, MonitorProfiler::Stats> monitors;
+    // Monitors held by the thread and sites where they were entered, from the
+    // outermost one
+    vector<pair<MonitorProfiler::MonitorId, MonitorProfiler::Site>> held;
+};
+
+#endif  // YVM_MONITORPROFILER_H
@@ -21,35 +21,236 @@
 // SOFTWARE.
 //
 
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include "Futex.h"
+#include "JavaThread.h"
 #include "ObjectMonitor.h"
+#include "../misc/Option.h"
 
-void ObjectMonitor::enter(std::thread::id tid) {
-    std::unique_lock<std::mutex> lock(internalMtx);
+using namespace std;
 
-    if (monitorCnt == 0) {
-        monitorCnt = 1;
-        owner = tid;
-        entered = true;
-    } else {
-        if (tid == owner) {
-            monitorCnt++;
-            entered = true;
-        } else {
-            cv.wait(lock, [=] { return monitorCnt == 0; });
-            entered = true;
+static inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Spinning never helps on a uniprocessor since the owner can't run meanwhile
+static bool canSpin() {
+    static const bool multiprocessor = thread::hardware_concurrency() > 1;
+    return multiprocessor;
+}
+
+ObjectMonitor::ObjectMonitor(uintptr_t owner, int32_t count)
+    : contenders(0) {
+    reset(owner, count);
+}
+
+void ObjectMonitor::reset(uintptr_t owner, int32_t count) {
+    state = count != 0 ? LOCKED : UNLOCKED;
+    this->owner = owner;
+    enteredSinceCheck = true;
+    monitorCnt = count;
+    acquiredAt = chrono::steady_clock::now();
+    avgHoldNanos = YVM_MONITOR_MAX_SPIN_NANOS / YVM_MONITOR_SPIN_HOLD_FACTOR;
+    synchronizer.reset();
+}
+
+bool ObjectMonitor::tryLock() {
+    uint32_t unlocked = UNLOCKED;
+    return state.compare_exchange_strong(unlocked, LOCKED);
+}
+
+void ObjectMonitor::acquire(uintptr_t lockId) {
+    owner = lockId;
+    monitorCnt = 1;
+    acquiredAt = chrono::steady_clock::now();
+    enteredSinceCheck = true;
+    contenders--;
+}
+
+void ObjectMonitor::reenter() {
+    monitorCnt++;
+    contenders--;
+}
+
+bool ObjectMonitor::tryEnter(uintptr_t lockId) {
+    if (owner == lockId) {
+        reenter();
+        return true;
+    }
+    if (tryLock()) {
+        acquire(lockId);
+        return true;
+    }
+    if (!canSpin()) {
+        return false;
+    }
+    // Spin a bit longer than the monitor is usually held, a monitor which is
+    // held for long makes spinning useless
+    const chrono::nanoseconds budget(
+        min<int64_t>(avgHoldNanos * YVM_MONITOR_SPIN_HOLD_FACTOR,
+                     YVM_MONITOR_MAX_SPIN_NANOS));
+    const auto deadline = chrono::steady_clock::now() + budget;
+    do {
+        for (int i = 0; i < 64; i++) {
+            spinPause();
+        }
+        if (state == UNLOCKED && tryLock()) {
+            acquire(lockId);
+            return true;
+        }
+    } while (chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+void ObjectMonitor::lockState(JavaThread* self) {
+    if (tryLock()) {
+        return;
+    }
+    if (self->vthread != nullptr) {
+        lockStateVirtual(self);
+        return;
+    }
+    // The monitor is marked as contended by every thread which is going to
+    // park, so that exit() wakes one of them. A woken thread marks it again
+    // since there might be other parked threads
+    uint32_t current = state.exchange(CONTENDED);
+    while (current != UNLOCKED) {
+        futexWait(&state, CONTENDED);
+        current = state.exchange(CONTENDED);
+    }
+}
+
+// Same protocol as the futex one, except that the thread is queued before it
+// marks the monitor as contended, so that exit() finds it
+void ObjectMonitor::lockStateVirtual(JavaThread* self) {
+    while (true) {
+        {
+            lock_guard<mutex> lock(entrantsMtx);
+            virtualEntrants.push_back(self);
         }
+        const uint32_t current = state.exchange(CONTENDED);
+        if (current != UNLOCKED) {
+            self->park();
+        }
+        {
+            lock_guard<mutex> lock(entrantsMtx);
+            auto iter =
+                find(virtualEntrants.begin(), virtualEntrants.end(), self);
+            if (iter != virtualEntrants.end()) {
+                virtualEntrants.erase(iter);
+            }
+        }
+        if (current == UNLOCKED) {
+            return;
+        }
+    }
+}
+
+void ObjectMonitor::enter(JavaThread* self) {
+    if (owner == self->lockId) {
+        reenter();
+        return;
+    }
+    lockState(self);
+    acquire(self->lockId);
+}
+
+void ObjectMonitor::release() {
+    owner = 0;
+    if (state.exchange(UNLOCKED) == CONTENDED) {
+        futexWake(&state);
+        lock_guard<mutex> lock(entrantsMtx);
+        if (!virtualEntrants.empty()) {
+            JavaThread* entrant = virtualEntrants.front();
+            virtualEntrants.pop_front();
+            entrant->unpark();
+        }
+    }
+}
+
+void ObjectMonitor::checkOwner(uintptr_t lockId) const {
+    if (owner != lockId) {
+        throw runtime_error("illegal monitor state");
     }
 }
 
-void ObjectMonitor::exit() {
-    std::unique_lock<std::mutex> lock(internalMtx);
+void ObjectMonitor::exit(uintptr_t lockId) {
+    checkOwner(lockId);
+    if (--monitorCnt != 0) {
+        return;
+    }
+    const auto held = chrono::steady_clock::now() - acquiredAt;
+    avgHoldNanos =
+        (avgHoldNanos * 7 +
+         chrono::duration_cast<chrono::nanoseconds>(held).count()) /
+        8;
+    release();
+}
 
-    if (!entered) {
-        throw std::runtime_error("illegal monitor state");
+void ObjectMonitor::wait(JavaThread* self, int64_t timeoutMillis) {
+    checkOwner(self->lockId);
+    Waiter waiter{self, {false}};
+    {
+        lock_guard<mutex> lock(waitSetMtx);
+        waitSet.push_back(&waiter);
     }
+    // Waiting thread is a contender until it enters the monitor again, so
+    // that the monitor is never deflated meanwhile
+    contenders++;
+    const int32_t count = monitorCnt;
+    monitorCnt = 0;
+    release();
+
+    const auto deadline =
+        chrono::steady_clock::now() + chrono::milliseconds(timeoutMillis);
+    while (!waiter.notified && !self->interrupted) {
+        if (timeoutMillis == 0) {
+            self->park();
+            continue;
+        }
+        const chrono::nanoseconds remaining =
+            deadline - chrono::steady_clock::now();
+        if (remaining.count() <= 0) {
+            break;
+        }
+        self->park(&remaining);
+    }
+    {
+        // Notifier may still be using the waiter until it unlocks
+        lock_guard<mutex> lock(waitSetMtx);
+        if (!waiter.notified) {
+            waitSet.erase(find(waitSet.begin(), waitSet.end(), &waiter));
+        }
+    }
+
+    lockState(self);
+    acquire(self->lockId);
+    monitorCnt = count;
+}
+
+void ObjectMonitor::notify(uintptr_t lockId) {
+    checkOwner(lockId);
+    lock_guard<mutex> lock(waitSetMtx);
+    if (!waitSet.empty()) {
+        Waiter* waiter = waitSet.front();
+        waitSet.pop_front();
+        waiter->notified = true;
+        waiter->thread->unpark();
+    }
+}
 
-    monitorCnt--;
-    if (monitorCnt == 0) {
-        cv.notify_one();
+void ObjectMonitor::notifyAll(uintptr_t lockId) {
+    checkOwner(lockId);
+    lock_guard<mutex> lock(waitSetMtx);
+    for (Waiter* waiter : waitSet) {
+        waiter->notified = true;
+        waiter->thread->unpark();
     }
+    waitSet.clear();
 }
@@ -24,22 +24,145 @@
 #ifndef YVM_OBJECTMONITOR_H
 #define YVM_OBJECTMONITOR_H
 
-#include <condition_variable>
-#include <queue>
-#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "Synchronizer.h"
 
+struct JavaThread;
+
+//--------------------------------------------------------------------------------
+// Every object and array has a lock word, it's changed by CAS so that locking
+// an uncontended record never acquires a mutex. Owner of a thin lock is the
+// lock id of its java thread, and recursion count is kept in the word:
+//
+// [0]                          unlocked
+// [owner | count << 1 | 0]     thin lock entered count times by owner
+// [monitor id << 1 | 1]        inflated, see ObjectMonitor
+//
+// Thin lock is inflated to an ObjectMonitor when another thread contends it
+// or the recursion count overflows. Monitors which stay idle between two GC
+// cycles are deflated back to unlocked words and recycled.
+//--------------------------------------------------------------------------------
+struct LockWord {
+    static constexpr uintptr_t UNLOCKED = 0;
+    static constexpr uintptr_t INFLATED = 1;
+    static constexpr int COUNT_BITS = 15;
+    static constexpr uintptr_t COUNT_MASK = ((uintptr_t(1) << COUNT_BITS) - 1)
+                                            << 1;
+    static constexpr uintptr_t MAX_COUNT = (uintptr_t(1) << COUNT_BITS) - 1;
+
+    static uintptr_t thin(uintptr_t owner, uintptr_t count) {
+        return (owner << (COUNT_BITS + 1)) | (count << 1);
+    }
+    static uintptr_t inflated(size_t monitorId) {
+        return (monitorId << 1) | INFLATED;
+    }
+    static bool isInflated(uintptr_t word) { return (word & INFLATED) != 0; }
+    static uintptr_t ownerOf(uintptr_t word) {
+        return word >> (COUNT_BITS + 1);
+    }
+    static uintptr_t countOf(uintptr_t word) {
+        return (word & COUNT_MASK) >> 1;
+    }
+    static size_t monitorIdOf(uintptr_t word) { return word >> 1; }
+};
+
+//--------------------------------------------------------------------------------
+// ObjectMonitor is the inflated lock of a record. A thread which failed to
+// enter it spins for a while according to recent hold times of the monitor,
+// since most critical sections are short, then it parks on the futex word
+// until the owner exits and wakes exactly one waiter. Virtual threads park on
+// their own permits instead, so that their carriers are not blocked.
+//
+// Threads which called Object.wait() are kept in wait set of the monitor,
+// each of them parks on its own permit until it's notified, interrupted or
+// timed out, then it enters the monitor again.
+//
+// A monitor may also carry the synchronizer of its record, such a monitor is
+// not deflated until the record is dead.
+//--------------------------------------------------------------------------------
 class ObjectMonitor {
 public:
-    void enter(std::thread::id tid);
-    void exit();
+    // A monitor inflated from a thin lock inherits its owner and count
+    explicit ObjectMonitor(uintptr_t owner = 0, int32_t count = 0);
+    // Reinitialize a recycled monitor as if it was newly inflated
+    void reset(uintptr_t owner, int32_t count);
+
+    // A thread must be counted before it enters the monitor, so that the
+    // monitor is never deflated under its feet
+    void addContender() { contenders++; }
+
+    // Enter the monitor without parking, return false if it's still held by
+    // another thread after spinning
+    bool tryEnter(uintptr_t lockId);
+    // Enter the monitor, park this thread until then if necessary
+    void enter(JavaThread* self);
+    void exit(uintptr_t lockId);
+
+    // Exit the monitor entirely and wait until this thread is notified or
+    // interrupted, or until the timeout expires if it's not zero, then enter
+    // it with the same recursion count. It must be called by the owner, and
+    // the thread must be blocked for safepoints
+    void wait(JavaThread* self, int64_t timeoutMillis);
+    void notify(uintptr_t lockId);
+    void notifyAll(uintptr_t lockId);
+    bool isOwnedBy(uintptr_t lockId) const { return owner == lockId; }
+    // Lock id of the owner, or 0 if it's not held
+    uintptr_t getOwner() const { return owner; }
+
+    // Whether it's held or some threads are entering it, it's only stable
+    // at safepoint
+    bool isBusy() const {
+        return owner != 0 || state != UNLOCKED || contenders != 0 ||
+               (synchronizer != nullptr && synchronizer->hasQueuedThreads());
+    }
+    // Return whether it was entered since the last call
+    bool checkEntered() { return enteredSinceCheck.exchange(false); }
+
+    Synchronizer* getSynchronizer() const { return synchronizer.get(); }
+    void setSynchronizer(Synchronizer* synchronizer) {
+        this->synchronizer.reset(synchronizer);
+    }
 
 private:
-    std::mutex internalMtx;
+    bool tryLock();
+    // Take the futex word, park until then if necessary
+    void lockState(JavaThread* self);
+    void lockStateVirtual(JavaThread* self);
+    void acquire(uintptr_t lockId);
+    void reenter();
+    void release();
+    void checkOwner(uintptr_t lockId) const;
+
+    // Futex word, it's CONTENDED if there might be parked threads
+    enum : uint32_t { UNLOCKED, LOCKED, CONTENDED };
+    std::atomic<uint32_t> state;
+
+    std::atomic<uintptr_t> owner;
+    std::atomic<int32_t> contenders;
+    std::atomic_bool enteredSinceCheck;
+    // Following fields are only accessed by the owner
+    int32_t monitorCnt;
+    std::chrono::steady_clock::time_point acquiredAt;
+    // Moving average of hold time, it's read by spinning threads
+    std::atomic<int64_t> avgHoldNanos;
+
+    struct Waiter {
+        JavaThread* thread;
+        std::atomic_bool notified;
+    };
+    std::mutex waitSetMtx;
+    std::deque<Waiter*> waitSet;
+    // Virtual threads which are parked to enter the monitor, one of them is
+    // woken up together with a futex waiter
+    std::mutex entrantsMtx;
+    std::deque<JavaThread*> virtualEntrants;
 
-    volatile bool entered = false;
-    int32_t monitorCnt = 0;
-    std::thread::id owner;
-    std::condition_variable cv;
+    std::unique_ptr<Synchronizer> synchronizer;
 };
 
 #endif
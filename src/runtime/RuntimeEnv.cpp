@@ -24,17 +24,32 @@
 #include "RuntimeEnv.h"
 
 #include "../gc/GC.h"
+#include "AllocationSampler.h"
 #include "ClassSpace.h"
 #include "JavaHeap.hpp"
+#include "JavaThread.h"
+#include "MonitorProfiler.h"
+#include "Safepoint.h"
+#include "VirtualThread.h"
 
 RuntimeEnv runtime; // yvm runtime
 
 RuntimeEnv::RuntimeEnv() {
     heap = new JavaHeap;
     gc = new ConcurrentGC;
+    threads = new ThreadRegistry;
+    safepoint = new Safepoint;
+    sampler = new AllocationSampler;
+    monitorProfiler = new MonitorProfiler;
+    scheduler = new VirtualThreadScheduler;
 }
 
 RuntimeEnv::~RuntimeEnv() {
     delete cs;
     delete heap;
+    delete threads;
+    delete safepoint;
+    delete sampler;
+    delete monitorProfiler;
+    delete scheduler;
 }
@@ -26,12 +26,19 @@
 
 #include <string>
 #include <unordered_map>
+#include "../misc/Option.h"
 
 struct JType;
 class JavaFrame;
 class JavaHeap;
 class ClassSpace;
 class ConcurrentGC;
+class ThreadRegistry;
+class Safepoint;
+class AllocationSampler;
+class MonitorProfiler;
+class VirtualThreadScheduler;
+struct JavaThread;
 
 struct RuntimeEnv {
     RuntimeEnv();
@@ -39,9 +46,16 @@ struct RuntimeEnv {
 
     ClassSpace* cs;
     JavaHeap* heap;
-    std::unordered_map<std::string, JType* (*)(RuntimeEnv* env, JType**,int)>
+    std::unordered_map<std::string,
+                       JType* (*)(RuntimeEnv* env, JavaThread*, JType**, int)>
         nativeMethods;
     ConcurrentGC* gc;
+    ThreadRegistry* threads;
+    Safepoint* safepoint;
+    AllocationSampler* sampler;
+    MonitorProfiler* monitorProfiler;
+    VirtualThreadScheduler* scheduler;
+    VMOption option;
 };
 
 extern RuntimeEnv runtime;
@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include "Safepoint.h"
+#include <iostream>
+#include "../gc/GC.h"
+#include "../misc/Option.h"
+#include "JavaThread.h"
+#include "RuntimeEnv.h"
+
+using namespace std;
+
+void Safepoint::request() {
+    lock_guard<mutex> lock(safepointMtx);
+    requestLocked();
+}
+
+void Safepoint::requestLocked() {
+    if (!requested) {
+        requestTime = chrono::steady_clock::now();
+        requested.store(true, memory_order_release);
+    }
+}
+
+void Safepoint::execute(JavaThread* self, function<void()> operation) {
+    unique_lock<mutex> lock(safepointMtx);
+    operations.push_back(move(operation));
+    const size_t sequence = ++requestedOps;
+    // Operation might be taken by a coordinator which has stopped the world,
+    // or it's left to the next safepoint which may be coordinated by us
+    while (executedOps < sequence) {
+        requestLocked();
+        lock.unlock();
+        block(self);
+        lock.lock();
+    }
+}
+
+bool Safepoint::allThreadsSafe(JavaThread* self) {
+    for (JavaThread* thread : runtime.threads->getThreads()) {
+        if (thread != self && !thread->atSafepoint &&
+            thread->state != ThreadState::BLOCKED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Safepoint::block(JavaThread* self) {
+    unique_lock<mutex> lock(safepointMtx);
+    if (!requested) {
+        return;
+    }
+
+    if (synchronizing) {
+        // Another thread is coordinating this safepoint, park until it's done
+        if (self != nullptr) {
+            self->atSafepoint = true;
+            safepointCond.notify_all();
+        }
+        const size_t currentEpoch = epoch;
+        safepointCond.wait(lock, [&] { return epoch != currentEpoch; });
+        return;
+    }
+
+    synchronizing = true;
+    // Threads may detach from registry without notifying us, so we check
+    // them periodically rather than wait for notification only
+    while (!allThreadsSafe(self)) {
+        safepointCond.wait_for(lock, chrono::milliseconds(1));
+    }
+
+    auto timeToSafepoint = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - requestTime);
+    safepointCount++;
+    lastTimeToSafepoint = timeToSafepoint;
+    totalTimeToSafepoint += timeToSafepoint;
+    if (timeToSafepoint > maxTimeToSafepoint) {
+        maxTimeToSafepoint = timeToSafepoint;
+    }
+#ifdef YVM_DEBUG_SHOW_SAFEPOINT
+    cout << "[Safepoint] #" << safepointCount
+         << " time to safepoint:" << timeToSafepoint.count() << "ns\n";
+#endif
+
+    requested.store(false, memory_order_release);
+    // Operations requested from now on are left to the next safepoint
+    auto pendingOps = move(operations);
+    operations.clear();
+    lock.unlock();
+
+    for (auto& operation : pendingOps) {
+        operation();
+    }
+    runtime.gc->gc(runtime.gc->getPolicy());
+
+    lock.lock();
+    executedOps += pendingOps.size();
+    // Parked threads reset nothing by themselves, otherwise a new coordinator
+    // might see a stale flag of a thread which has been resumed
+    for (JavaThread* thread : runtime.threads->getThreads()) {
+        thread->atSafepoint = false;
+    }
+    synchronizing = false;
+    epoch++;
+    safepointCond.notify_all();
+}
+
+void Safepoint::enterBlocked(JavaThread* self) {
+    lock_guard<mutex> lock(safepointMtx);
+    self->state = ThreadState::BLOCKED;
+    safepointCond.notify_all();
+}
+
+void Safepoint::leaveBlocked(JavaThread* self) {
+    unique_lock<mutex> lock(safepointMtx);
+    // The coordinator may have counted us as safe, wait until it finishes
+    safepointCond.wait(lock, [this] { return !synchronizing; });
+    self->state = ThreadState::IN_JAVA;
+}
@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#ifndef YVM_SAFEPOINT_H
+#define YVM_SAFEPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct JavaThread;
+
+//--------------------------------------------------------------------------------
+// Safepoint brings all java threads to a state where their frames and heap
+// references can not change, so that garbage collector is able to work on
+// them. Mutator threads poll isRequested() at method entry, method exit and
+// backward branches. The first thread which observes the request becomes the
+// coordinator, it waits until every other thread has either parked itself in
+// block() or is blocked (e.g. waiting for a monitor), then it runs pending VM
+// operations, performs the collection and resumes them.
+//--------------------------------------------------------------------------------
+class Safepoint {
+public:
+    Safepoint()
+        : requested(false),
+          synchronizing(false),
+          epoch(0),
+          requestedOps(0),
+          executedOps(0),
+          safepointCount(0),
+          lastTimeToSafepoint(0),
+          totalTimeToSafepoint(0),
+          maxTimeToSafepoint(0) {}
+
+    // Fast path of safepoint poll, it's merely an atomic load
+    bool isRequested() const {
+        return requested.load(std::memory_order_acquire);
+    }
+
+    // Ask all java threads to come to a safepoint as soon as possible
+    void request();
+
+    // Slow path of safepoint poll, self is nullptr if caller is not a java
+    // thread
+    void block(JavaThread* self);
+
+    // Run a VM operation while all java threads are stopped and return after
+    // it's done. It can be called by java threads (e.g. in natives, whose heap
+    // references must be registered as roots) or by other native threads
+    void execute(JavaThread* self, std::function<void()> operation);
+
+    // Blocked threads are treated as already safe. A thread leaving blocked
+    // state must wait for the ongoing safepoint operation, if any
+    void enterBlocked(JavaThread* self);
+    void leaveBlocked(JavaThread* self);
+
+    // Time-to-safepoint statistics, i.e. the elapsed time between a request
+    // and the moment all threads reached safepoint
+    size_t getSafepointCount() const { return safepointCount; }
+    std::chrono::nanoseconds getLastTimeToSafepoint() const {
+        return lastTimeToSafepoint;
+    }
+    std::chrono::nanoseconds getTotalTimeToSafepoint() const {
+        return totalTimeToSafepoint;
+    }
+    std::chrono::nanoseconds getMaxTimeToSafepoint() const {
+        return maxTimeToSafepoint;
+    }
+
+private:
+    bool allThreadsSafe(JavaThread* self);
+    void requestLocked();
+
+    std::atomic_bool requested;
+    bool synchronizing;
+    size_t epoch;
+    std::chrono::steady_clock::time_point requestTime;
+    std::mutex safepointMtx;
+    std::condition_variable safepointCond;
+    // Pending VM operations, each of them is identified by its sequence
+    std::vector<std::function<void()>> operations;
+    size_t requestedOps;
+    size_t executedOps;
+
+    size_t safepointCount;
+    std::chrono::nanoseconds lastTimeToSafepoint;
+    std::chrono::nanoseconds totalTimeToSafepoint;
+    std::chrono::nanoseconds maxTimeToSafepoint;
+};
+
+//--------------------------------------------------------------------------------
+// Mark current thread as blocked in the scope, which is used around the code
+// that may block for a long time
+//--------------------------------------------------------------------------------
+class ThreadBlockedScope {
+public:
+    ThreadBlockedScope(Safepoint* safepoint, JavaThread* self)
+        : safepoint(safepoint), self(self) {
+        safepoint->enterBlocked(self);
+    }
+    ~ThreadBlockedScope() { safepoint->leaveBlocked(self); }
+
+private:
+    Safepoint* safepoint;
+    JavaThread* self;
+};
+
+#endif  // YVM_SAFEPOINT_H
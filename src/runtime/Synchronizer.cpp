@@ -0,0 +1,199 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "Synchronizer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "JavaThread.h"
+
+using namespace std;
+
+template <typename TryAcquire>
+Synchronizer::Result Synchronizer::block(JavaThread* self,
+                                         TryAcquire tryAcquire,
+                                         const chrono::nanoseconds* timeout,
+                                         bool interruptible) {
+    const auto deadline = chrono::steady_clock::now() +
+                          (timeout != nullptr ? *timeout
+                                              : chrono::nanoseconds::zero());
+    // Interrupt status is cleared while waiting uninterruptibly, otherwise
+    // parking returns immediately, and it's restored at last
+    bool interrupted = false;
+    Waiter waiter{self, {false}};
+    Result result = Result::ACQUIRED;
+    while (!tryAcquire()) {
+        if (self->interrupted) {
+            if (interruptible) {
+                result = Result::INTERRUPTED;
+                break;
+            }
+            interrupted = self->interrupted.exchange(false) || interrupted;
+        }
+        if (!waiter.inQueue) {
+            // The thread was just woken up or it has never been queued. The
+            // state must be checked again after queueing, a release after
+            // that is going to wake it up
+            enqueue(&waiter);
+            continue;
+        }
+        if (timeout == nullptr) {
+            self->park();
+            continue;
+        }
+        const chrono::nanoseconds remaining =
+            deadline - chrono::steady_clock::now();
+        if (remaining.count() <= 0) {
+            result = Result::TIMED_OUT;
+            break;
+        }
+        self->park(&remaining);
+    }
+    leave(&waiter, result == Result::ACQUIRED);
+    if (interrupted) {
+        self->interrupted = true;
+    }
+    return result;
+}
+
+void Synchronizer::enqueue(Waiter* waiter) {
+    lock_guard<mutex> lock(queueMtx);
+    waiter->inQueue = true;
+    queue.push_back(waiter);
+    queued++;
+}
+
+void Synchronizer::leave(Waiter* waiter, bool acquired) {
+    lock_guard<mutex> lock(queueMtx);
+    if (waiter->inQueue) {
+        queue.erase(find(queue.begin(), queue.end(), waiter));
+        queued--;
+    } else if (!acquired && !queue.empty()) {
+        // The thread may have been woken up by a release which it's not
+        // going to take, pass the wakeup on
+        Waiter* next = queue.front();
+        queue.pop_front();
+        queued--;
+        next->inQueue = false;
+        next->thread->unpark();
+    }
+}
+
+void Synchronizer::wakeFirst() {
+    lock_guard<mutex> lock(queueMtx);
+    if (!queue.empty()) {
+        Waiter* waiter = queue.front();
+        queue.pop_front();
+        queued--;
+        waiter->inQueue = false;
+        waiter->thread->unpark();
+    }
+}
+
+void Synchronizer::wakeAll() {
+    lock_guard<mutex> lock(queueMtx);
+    for (Waiter* waiter : queue) {
+        waiter->inQueue = false;
+        waiter->thread->unpark();
+    }
+    queued -= static_cast<int32_t>(queue.size());
+    queue.clear();
+}
+
+bool Synchronizer::tryLock(uintptr_t lockId) {
+    if (owner == lockId) {
+        state++;
+        return true;
+    }
+    int32_t unlocked = 0;
+    if (state.compare_exchange_strong(unlocked, 1)) {
+        owner = lockId;
+        return true;
+    }
+    return false;
+}
+
+Synchronizer::Result Synchronizer::lock(JavaThread* self,
+                                        const chrono::nanoseconds* timeout,
+                                        bool interruptible) {
+    const uintptr_t lockId = self->lockId;
+    return block(self, [this, lockId]() { return tryLock(lockId); }, timeout,
+                 interruptible);
+}
+
+void Synchronizer::unlock(uintptr_t lockId) {
+    if (owner != lockId) {
+        throw runtime_error("illegal monitor state");
+    }
+    const int32_t count = state - 1;
+    if (count != 0) {
+        state = count;
+        return;
+    }
+    owner = 0;
+    state = 0;
+    if (queued != 0) {
+        wakeFirst();
+    }
+}
+
+bool Synchronizer::tryAcquire(int32_t permits) {
+    int32_t available = state;
+    while (available >= permits) {
+        if (state.compare_exchange_weak(available, available - permits)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Synchronizer::Result Synchronizer::acquire(JavaThread* self, int32_t permits,
+                                           const chrono::nanoseconds* timeout) {
+    return block(self, [this, permits]() { return tryAcquire(permits); },
+                 timeout, true);
+}
+
+void Synchronizer::release(int32_t permits) {
+    state += permits;
+    if (queued != 0) {
+        // Woken threads may acquire different numbers of permits
+        wakeAll();
+    }
+}
+
+Synchronizer::Result Synchronizer::await(JavaThread* self,
+                                         const chrono::nanoseconds* timeout) {
+    return block(self, [this]() { return state == 0; }, timeout, true);
+}
+
+void Synchronizer::countDown() {
+    int32_t count = state;
+    while (count > 0) {
+        if (state.compare_exchange_weak(count, count - 1)) {
+            if (count == 1 && queued != 0) {
+                wakeAll();
+            }
+            return;
+        }
+    }
+}
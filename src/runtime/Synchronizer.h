@@ -0,0 +1,99 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_SYNCHRONIZER_H
+#define YVM_SYNCHRONIZER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+struct JavaThread;
+
+//--------------------------------------------------------------------------------
+// Synchronizer is the native state of locks, latches and semaphores of
+// ydk.concurrent. Its state is changed by CAS, so acquiring or releasing an
+// uncontended synchronizer never acquires a mutex. Threads which failed to
+// acquire it are queued and parked on their own permits. Releasing a lock
+// wakes the first queued thread, while releasing shared state wakes all of
+// them, and woken threads compete for the state again.
+//
+// A synchronizer is attached to the inflated monitor of its java object, so
+// it's moved and reclaimed together with the monitor, see ObjectMonitor
+//--------------------------------------------------------------------------------
+class Synchronizer {
+public:
+    enum class Result { ACQUIRED, TIMED_OUT, INTERRUPTED };
+
+    explicit Synchronizer(int32_t state) : state(state), owner(0), queued(0) {}
+
+    // Exclusive mode, state is the hold count of the owner. Slow paths park
+    // the thread, so it must be blocked for safepoints. An uninterruptible
+    // acquisition keeps the interrupt status of the thread
+    bool tryLock(uintptr_t lockId);
+    Result lock(JavaThread* self, const std::chrono::nanoseconds* timeout,
+                bool interruptible);
+    void unlock(uintptr_t lockId);
+    int32_t getHoldCount(uintptr_t lockId) const {
+        return owner == lockId ? state.load() : 0;
+    }
+
+    // Shared mode, state is the number of available permits
+    bool tryAcquire(int32_t permits);
+    Result acquire(JavaThread* self, int32_t permits,
+                   const std::chrono::nanoseconds* timeout);
+    void release(int32_t permits);
+
+    // Latch mode, state is the count which is going to reach zero
+    Result await(JavaThread* self, const std::chrono::nanoseconds* timeout);
+    void countDown();
+
+    int32_t getState() const { return state; }
+    bool hasQueuedThreads() const { return queued != 0; }
+
+private:
+    struct Waiter {
+        JavaThread* thread;
+        std::atomic_bool inQueue;
+    };
+
+    // Park the thread until tryAcquire succeeds, the timeout expires, or the
+    // thread is interrupted if it's interruptible
+    template <typename TryAcquire>
+    Result block(JavaThread* self, TryAcquire tryAcquire,
+                 const std::chrono::nanoseconds* timeout, bool interruptible);
+    void enqueue(Waiter* waiter);
+    void leave(Waiter* waiter, bool acquired);
+    void wakeFirst();
+    void wakeAll();
+
+    std::atomic<int32_t> state;
+    std::atomic<uintptr_t> owner;
+    std::atomic<int32_t> queued;
+    std::mutex queueMtx;
+    std::deque<Waiter*> queue;
+};
+
+#endif  // YVM_SYNCHRONIZER_H
@@ -0,0 +1,301 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "VirtualThread.h"
+#include "JavaThread.h"
+#include "RuntimeEnv.h"
+#include "Safepoint.h"
+
+using namespace std;
+
+thread_local VirtualThread* VirtualThread::mounted = nullptr;
+thread_local VirtualThreadScheduler::Carrier*
+    VirtualThreadScheduler::currentCarrier = nullptr;
+
+VirtualThread::VirtualThread(VirtualThreadScheduler* scheduler,
+                             JavaThread* thread, function<void()> body,
+                             size_t stackSize)
+    : scheduler(scheduler),
+      thread(thread),
+      body(move(body)),
+      continuation(stackSize, entry, this),
+      state(RUNNABLE),
+      permit(0),
+      refs(1),
+      timerArmed(false) {}
+
+VirtualThread* VirtualThread::current() { return mounted; }
+
+void VirtualThread::entry(void* arg) {
+    auto* self = static_cast<VirtualThread*>(arg);
+    // It was attached as blocked by its starter
+    runtime.safepoint->leaveBlocked(self->thread);
+    self->body();
+    // Java thread has been detached and destroyed by the body
+    self->thread = nullptr;
+    self->state = TERMINATED;
+    self->continuation.suspend();
+}
+
+void VirtualThread::unmount(State next) {
+    const ThreadState saved = thread->state;
+    if (saved != ThreadState::BLOCKED) {
+        runtime.safepoint->enterBlocked(thread);
+    }
+    state = next;
+    continuation.suspend();
+    if (saved != ThreadState::BLOCKED) {
+        runtime.safepoint->leaveBlocked(thread);
+        thread->state = saved;
+    }
+}
+
+void VirtualThread::park(const chrono::nanoseconds* timeout) {
+    if (permit.exchange(0) == 1) {
+        return;
+    }
+    if (timeout != nullptr) {
+        scheduler->armTimer(this, chrono::steady_clock::now() + *timeout);
+    }
+    unmount(PARKING);
+    if (timeout != nullptr) {
+        scheduler->disarmTimer(this);
+    }
+    permit = 0;
+}
+
+void VirtualThread::unpark() {
+    if (permit.exchange(1) == 0) {
+        // Thread which is still parking is resubmitted by its carrier
+        int parked = PARKED;
+        if (state.compare_exchange_strong(parked, RUNNABLE)) {
+            scheduler->submit(this);
+        }
+    }
+}
+
+void VirtualThread::yield() { unmount(YIELDING); }
+
+void VirtualThreadScheduler::start(JavaThread* thread, function<void()> body) {
+    {
+        lock_guard<mutex> lock(startMtx);
+        if (carriers.empty()) {
+            startCarriers();
+        }
+    }
+    auto* vthread = new VirtualThread(this, thread, move(body),
+                                      runtime.option.virtualThreadStackSize);
+    thread->vthread = vthread;
+    {
+        lock_guard<mutex> lock(aliveMtx);
+        alive++;
+    }
+    submit(vthread);
+}
+
+void VirtualThreadScheduler::startCarriers() {
+    size_t count = runtime.option.virtualThreadCarriers;
+    if (count == 0) {
+        count = max(thread::hardware_concurrency(), 1U);
+    }
+    for (size_t i = 0; i < count; i++) {
+        carriers.emplace_back(new Carrier);
+    }
+    // Carriers are started after the vector is filled, since they steal from
+    // each other
+    for (auto& carrier : carriers) {
+        Carrier* self = carrier.get();
+        carrier->nativeThread = thread([this, self]() { runCarrier(self); });
+    }
+    timerThread = thread([this]() { runTimer(); });
+}
+
+void VirtualThreadScheduler::runCarrier(Carrier* carrier) {
+    currentCarrier = carrier;
+    while (VirtualThread* vthread = next(carrier)) {
+        vthread->state = VirtualThread::RUNNING;
+        VirtualThread::mounted = vthread;
+        vthread->continuation.resume();
+        VirtualThread::mounted = nullptr;
+        afterUnmount(vthread);
+    }
+}
+
+VirtualThread* VirtualThreadScheduler::next(Carrier* carrier) {
+    while (true) {
+        {
+            lock_guard<mutex> lock(carrier->queueMtx);
+            if (!carrier->runQueue.empty()) {
+                VirtualThread* vthread = carrier->runQueue.front();
+                carrier->runQueue.pop_front();
+                queued--;
+                return vthread;
+            }
+        }
+        for (auto& victim : carriers) {
+            if (victim.get() == carrier) {
+                continue;
+            }
+            // The oldest thread is stolen, the newer ones are more likely to
+            // share data which is still in caches of the victim
+            lock_guard<mutex> lock(victim->queueMtx);
+            if (!victim->runQueue.empty()) {
+                VirtualThread* vthread = victim->runQueue.front();
+                victim->runQueue.pop_front();
+                queued--;
+                return vthread;
+            }
+        }
+
+        unique_lock<mutex> lock(idleMtx);
+        if (stopping) {
+            return nullptr;
+        }
+        idleCarriers++;
+        idleCnd.wait(lock, [this] { return queued != 0 || stopping; });
+        idleCarriers--;
+    }
+}
+
+void VirtualThreadScheduler::afterUnmount(VirtualThread* vthread) {
+    switch (vthread->state) {
+        case VirtualThread::PARKING: {
+            // Once it's parked, it may be unparked and resumed by another
+            // carrier, which frees it when it terminates
+            vthread->refs++;
+            vthread->state = VirtualThread::PARKED;
+            int parked = VirtualThread::PARKED;
+            if (vthread->permit == 1 &&
+                vthread->state.compare_exchange_strong(
+                    parked, VirtualThread::RUNNABLE)) {
+                submit(vthread);
+            }
+            release(vthread);
+        } break;
+        case VirtualThread::YIELDING: {
+            vthread->state = VirtualThread::RUNNABLE;
+            submit(vthread);
+        } break;
+        case VirtualThread::TERMINATED: {
+            release(vthread);
+            lock_guard<mutex> lock(aliveMtx);
+            if (--alive == 0) {
+                terminatedCnd.notify_all();
+            }
+        } break;
+        default:
+            break;
+    }
+}
+
+void VirtualThreadScheduler::submit(VirtualThread* vthread) {
+    Carrier* carrier = currentCarrier;
+    if (carrier == nullptr) {
+        carrier = carriers[nextCarrier++ % carriers.size()].get();
+    }
+    // Counted before it's queued, so that it's never negative
+    queued++;
+    {
+        lock_guard<mutex> lock(carrier->queueMtx);
+        carrier->runQueue.push_back(vthread);
+    }
+    if (idleCarriers != 0) {
+        lock_guard<mutex> lock(idleMtx);
+        idleCnd.notify_one();
+    }
+}
+
+void VirtualThreadScheduler::release(VirtualThread* vthread) {
+    if (--vthread->refs == 0) {
+        delete vthread;
+    }
+}
+
+void VirtualThreadScheduler::armTimer(
+    VirtualThread* vthread, chrono::steady_clock::time_point deadline) {
+    lock_guard<mutex> lock(timerMtx);
+    vthread->timer = timers.emplace(deadline, vthread);
+    vthread->timerArmed = true;
+    if (vthread->timer == timers.begin()) {
+        timerCnd.notify_one();
+    }
+}
+
+void VirtualThreadScheduler::disarmTimer(VirtualThread* vthread) {
+    lock_guard<mutex> lock(timerMtx);
+    if (vthread->timerArmed) {
+        timers.erase(vthread->timer);
+        vthread->timerArmed = false;
+    }
+}
+
+void VirtualThreadScheduler::runTimer() {
+    unique_lock<mutex> lock(timerMtx);
+    while (!stopping) {
+        if (timers.empty()) {
+            timerCnd.wait(lock);
+            continue;
+        }
+        auto first = timers.begin();
+        // The timer may be disarmed while we are waiting for it
+        const auto deadline = first->first;
+        if (deadline > chrono::steady_clock::now()) {
+            timerCnd.wait_until(lock, deadline);
+            continue;
+        }
+        // The thread can't disarm the timer and go away meanwhile
+        VirtualThread* vthread = first->second;
+        timers.erase(first);
+        vthread->timerArmed = false;
+        vthread->unpark();
+    }
+}
+
+bool VirtualThreadScheduler::awaitTermination() {
+    unique_lock<mutex> lock(aliveMtx);
+    if (alive == 0) {
+        return false;
+    }
+    terminatedCnd.wait(lock, [this] { return alive == 0; });
+    return true;
+}
+
+void VirtualThreadScheduler::terminate() {
+    {
+        lock_guard<mutex> lock(idleMtx);
+        stopping = true;
+    }
+    idleCnd.notify_all();
+    {
+        lock_guard<mutex> lock(timerMtx);
+        timerCnd.notify_all();
+    }
+    for (auto& carrier : carriers) {
+        if (carrier->nativeThread.joinable()) {
+            carrier->nativeThread.join();
+        }
+    }
+    if (timerThread.joinable()) {
+        timerThread.join();
+    }
+}
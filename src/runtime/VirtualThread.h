@@ -0,0 +1,166 @@
+// MIT License
+//
+// Copyright (c) 2017 Yi Yang <kelthuzadx@qq.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#ifndef YVM_VIRTUALTHREAD_H
+#define YVM_VIRTUALTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Continuation.h"
+
+struct JavaThread;
+class VirtualThreadScheduler;
+
+//--------------------------------------------------------------------------------
+// VirtualThread is a java thread which runs on a continuation rather than on a
+// native thread of its own, it's mounted on a carrier thread of the scheduler
+// while it's running. Parking unmounts it so that the carrier runs other
+// virtual threads meanwhile, and unparking submits it to a run queue again.
+// Unmounted threads can't reach safepoint polls, so they are treated as
+// blocked for safepoints until they are mounted again.
+//--------------------------------------------------------------------------------
+class VirtualThread {
+public:
+    // Return the virtual thread mounted on the calling native thread, or
+    // nullptr if it's not a carrier
+    static VirtualThread* current();
+
+    JavaThread* getThread() const { return thread; }
+
+    // Same as JavaThread::park() and unpark() except that parking unmounts
+    // this thread rather than blocking its carrier
+    void park(const std::chrono::nanoseconds* timeout);
+    void unpark();
+    // Unmount this thread and submit it to the tail of a run queue
+    void yield();
+
+private:
+    friend class VirtualThreadScheduler;
+    enum State { RUNNABLE, RUNNING, PARKING, PARKED, YIELDING, TERMINATED };
+
+    VirtualThread(VirtualThreadScheduler* scheduler, JavaThread* thread,
+                  std::function<void()> body, size_t stackSize);
+    static void entry(void* arg);
+    // Return to the carrier, which moves this thread out of the given state
+    void unmount(State next);
+
+    static thread_local VirtualThread* mounted;
+
+    VirtualThreadScheduler* scheduler;
+    JavaThread* thread;
+    std::function<void()> body;
+    Continuation continuation;
+    std::atomic<int> state;
+    // It's 1 if the permit is available
+    std::atomic<uint32_t> permit;
+    // A carrier which has just parked this thread may still look at it after
+    // another carrier resumed it, the last one of them frees it
+    std::atomic<int> refs;
+    // Wakeup of timed parking, they are guarded by the timer lock
+    bool timerArmed;
+    std::multimap<std::chrono::steady_clock::time_point,
+                  VirtualThread*>::iterator timer;
+};
+
+//--------------------------------------------------------------------------------
+// VirtualThreadScheduler multiplexes virtual threads over a fixed number of
+// carrier threads, which are started on first use. Every carrier has its own
+// run queue, a thread made runnable by a carrier is queued there since it's
+// likely to share data with the carrier. A carrier which runs out of work
+// steals the oldest thread of another carrier, and sleeps if there is
+// nothing to steal. Timed parking is woken up by a timer thread.
+//--------------------------------------------------------------------------------
+class VirtualThreadScheduler {
+public:
+    VirtualThreadScheduler()
+        : nextCarrier(0),
+          queued(0),
+          idleCarriers(0),
+          stopping(false),
+          alive(0) {}
+    ~VirtualThreadScheduler() { terminate(); }
+
+    // Run the body on a new virtual thread of the java thread, which must be
+    // attached and blocked for safepoints. The body must detach it at last
+    void start(JavaThread* thread, std::function<void()> body);
+    // Block until all virtual threads have terminated, return false if there
+    // was none
+    bool awaitTermination();
+    // Stop carriers and timer, no virtual thread may be alive
+    void terminate();
+
+private:
+    friend class VirtualThread;
+    struct Carrier {
+        std::mutex queueMtx;
+        std::deque<VirtualThread*> runQueue;
+        std::thread nativeThread;
+    };
+
+    void startCarriers();
+    void runCarrier(Carrier* carrier);
+    // Return the next thread to run, or nullptr if scheduler is terminated
+    VirtualThread* next(Carrier* carrier);
+    // Move the thread out of the state in which it unmounted itself
+    void afterUnmount(VirtualThread* vthread);
+    void submit(VirtualThread* vthread);
+    void release(VirtualThread* vthread);
+
+    void armTimer(VirtualThread* vthread,
+                  std::chrono::steady_clock::time_point deadline);
+    void disarmTimer(VirtualThread* vthread);
+    void runTimer();
+
+    static thread_local Carrier* currentCarrier;
+
+    std::mutex startMtx;
+    std::vector<std::unique_ptr<Carrier>> carriers;
+    // Threads submitted by non-carrier threads are spread round robin
+    std::atomic<size_t> nextCarrier;
+    std::atomic<size_t> queued;
+    std::atomic<size_t> idleCarriers;
+    std::mutex idleMtx;
+    std::condition_variable idleCnd;
+    std::atomic_bool stopping;
+
+    std::mutex timerMtx;
+    std::condition_variable timerCnd;
+    std::multimap<std::chrono::steady_clock::time_point, VirtualThread*>
+        timers;
+    std::thread timerThread;
+
+    std::mutex aliveMtx;
+    std::condition_variable terminatedCnd;
+    size_t alive;
+};
+
+#endif  // YVM_VIRTUALTHREAD_H
@@ -21,23 +21,78 @@
 // SOFTWARE.
 //
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include "YVM.h"
 
+static void printUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  yvm [options] --lib=<path> <main_class>" << std::endl;
+    std::cout << std::endl;
+    std::cout << "      --lib=<path>     Tells YVM where to find JDK classes(java.lang.String, etc)" << std::endl;
+    std::cout << "      <main_class>     The full qualified Java class name, e.g. org.example.Foo" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "      -verbose:gc      Log every garbage collection and print a summary at exit" << std::endl;
+    std::cout << "      -Xlog:gc         Same as -verbose:gc" << std::endl;
+    std::cout << "      -XX:MaxGCPauseMillis=<ms>" << std::endl;
+    std::cout << "                       Pause time goal, GC threshold and GC workers are adapted to meet it" << std::endl;
+    std::cout << "      -XX:GCTimeRatio=<n>" << std::endl;
+    std::cout << "                       Throughput goal, GC takes 1/(1+n) of running time at most" << std::endl;
+    std::cout << "      -Xms<size>       Initial GC threshold, e.g. -Xms10m" << std::endl;
+    std::cout << "      -Xmx<size>       Maximum GC threshold which GC ergonomics could grow to" << std::endl;
+    std::cout << "      -XX:ParallelGCThreads=<n>" << std::endl;
+    std::cout << "                       Number of GC threads working within pauses, by default it follows core count" << std::endl;
+    std::cout << "      -XX:ConcGCThreads=<n>" << std::endl;
+    std::cout << "                       Number of GC threads working alongside Java threads" << std::endl;
+    std::cout << "      -XX:+UseStringDeduplication" << std::endl;
+    std::cout << "                       Let strings with equal contents share a char array during GC" << std::endl;
+    std::cout << "      -XX:+UseAllocationSitePretenuring" << std::endl;
+    std::cout << "                       Allocate records of sites which mostly survive GC into long-lived space" << std::endl;
+    std::cout << "      -XX:LongLivedSweepInterval=<n>" << std::endl;
+    std::cout << "                       Sweep long-lived space every n GC cycles (default: 8)" << std::endl;
+    std::cout << "      -XX:+UseEvacuationGC" << std::endl;
+    std::cout << "                       Evacuate heap regions with the most garbage within the pause time goal" << std::endl;
+    std::cout << "      -XX:HeapDumpPath=<path>" << std::endl;
+    std::cout << "                       Write an HPROF heap dump to the path on SIGQUIT, besides heap histogram" << std::endl;
+    std::cout << "      -XX:AllocationSampleInterval=<size>" << std::endl;
+    std::cout << "                       Sample an allocation about every <size> bytes and report allocation hotspots at exit" << std::endl;
+    std::cout << "      -XX:AllocationProfilePath=<path>" << std::endl;
+    std::cout << "                       Write sampled allocations to the path as a pprof profile instead of the report" << std::endl;
+    std::cout << "      -XX:+ProfileMonitorContention" << std::endl;
+    std::cout << "                       Report acquisitions and wait time of monitors and their sites at exit and on SIGQUIT" << std::endl;
+    std::cout << "      -XX:VirtualThreadCarriers=<n>" << std::endl;
+    std::cout << "                       Number of carrier threads running virtual threads, by default it follows core count" << std::endl;
+    std::cout << "      -XX:VirtualThreadStackSize=<size>" << std::endl;
+    std::cout << "                       Stack size of a virtual thread, its pages are committed as the stack grows (default: 4m)" << std::endl;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 3 || strstr(argv[1], "--lib") == NULL) {
-        std::cout << "Usage:" << std::endl;
-        std::cout << "  yvm --lib=<path> <main_class>" << std::endl;
-        std::cout << std::endl;
-        std::cout << "      --lib=<path>     Tells YVM where to find JDK classes(java.lang.String, etc)" << std::endl;
-        std::cout << "      <main_class>     The full qualified Java class name, e.g. org.example.Foo" << std::endl;
+    std::string libs;
+    std::string mainClass;
+    for (int i = 1; i < argc; i++) {
+        if (strstr(argv[i], "--lib=") == argv[i]) {
+            libs = argv[i] + strlen("--lib=");
+        } else if (argv[i][0] == '-') {
+            if (!runtime.option.parse(argv[i])) {
+                std::cout << "Unrecognized option: " << argv[i] << std::endl;
+                printUsage();
+                return 0;
+            }
+        } else if (mainClass.empty()) {
+            mainClass = argv[i];
+        } else {
+            printUsage();
+            return 0;
+        }
+    }
+    if (libs.empty() || mainClass.empty()) {
+        printUsage();
         return 0;
     }
 
-    std::string libs = argv[1] + strlen("--lib=");
     YVM::initialize(libs);
-    std::string mainClass = argv[2];
     for (auto& c : mainClass) {
         if (c == '.') {
             c = '/';
@@ -45,4 +100,4 @@ int main(int argc, char* argv[]) {
     }
     YVM::callMain(mainClass);
     return 0;
-}
\ No newline at end of file
+}
@@ -23,17 +23,24 @@
 
 #include "YVM.h"
 
+#include <csignal>
+#include <cstdio>
+#include <thread>
 #include "../gc/GC.h"
+#include "../gc/HeapInspector.h"
 #include "../misc/Debug.h"
 #include "../misc/NativeMethod.h"
 #include "../misc/Option.h"
 #include "../misc/Utils.h"
+#include "../runtime/AllocationSampler.h"
 #include "../runtime/ClassSpace.h"
 #include "../runtime/JavaClass.h"
 #include "../runtime/JavaHeap.hpp"
+#include "../runtime/MonitorProfiler.h"
 #include "../runtime/RuntimeEnv.h"
+#include "../runtime/Safepoint.h"
+#include "../runtime/VirtualThread.h"
 
-YVM::ExecutorThreadPool YVM::executor;
 
 #define FORCE(x) (reinterpret_cast<char*>(x))
 
@@ -44,8 +51,32 @@ static const char*((nativeFunctionTable[])[4]) = {
      FORCE(ydk_lang_IO_print_str)},
     {"ydk/lang/IO", "print", "(I)V", FORCE(ydk_lang_IO_print_I)},
     {"ydk/lang/IO", "print", "(C)V", FORCE(ydk_lang_IO_print_C)},
+    {"ydk/lang/Diagnostics", "printHeapHistogram", "()V",
+     FORCE(ydk_lang_Diagnostics_printHeapHistogram)},
+    {"ydk/lang/Diagnostics", "dumpHeap", "(Ljava/lang/String;)Z",
+     FORCE(ydk_lang_Diagnostics_dumpHeap)},
+
+    {"ydk/lang/GCStats", "getCollectionCount", "()J",
+     FORCE(ydk_lang_GCStats_getCollectionCount)},
+    {"ydk/lang/GCStats", "getTotalPauseNanos", "()J",
+     FORCE(ydk_lang_GCStats_getTotalPauseNanos)},
+    {"ydk/lang/GCStats", "getBytesReclaimed", "()J",
+     FORCE(ydk_lang_GCStats_getBytesReclaimed)},
 
     {"java/lang/Math", "random", "()D", FORCE(java_lang_Math_random)},
+    {"java/lang/System", "gc", "()V", FORCE(java_lang_System_gc)},
+    {"java/lang/System", "currentTimeMillis", "()J",
+     FORCE(java_lang_System_currentTimeMillis)},
+    {"java/lang/Runtime", "totalMemory", "()J",
+     FORCE(java_lang_Runtime_totalMemory)},
+    {"java/lang/Runtime", "freeMemory", "()J",
+     FORCE(java_lang_Runtime_freeMemory)},
+    {"java/lang/Runtime", "maxMemory", "()J",
+     FORCE(java_lang_Runtime_maxMemory)},
+    {"java/lang/Object", "wait", "(J)V", FORCE(java_lang_Object_wait)},
+    {"java/lang/Object", "notify", "()V", FORCE(java_lang_Object_notify)},
+    {"java/lang/Object", "notifyAll", "()V",
+     FORCE(java_lang_Object_notifyAll)},
     {"java/lang/StringBuilder", "append", "(I)Ljava/lang/StringBuilder;",
      FORCE(java_lang_stringbuilder_append_I)},
     {"java/lang/StringBuilder", "append", "(C)Ljava/lang/StringBuilder;",
@@ -57,7 +88,136 @@ static const char*((nativeFunctionTable[])[4]) = {
      FORCE(java_lang_stringbuilder_append_str)},
     {"java/lang/StringBuilder", "toString", "()Ljava/lang/String;",
      FORCE(java_lang_stringbuilder_tostring)},
-    {"java/lang/Thread", "start", "()V", FORCE(java_lang_thread_start)}
+    {"java/lang/Thread", "start", "()V", FORCE(java_lang_thread_start)},
+    {"java/lang/Thread", "startVirtual", "()V",
+     FORCE(java_lang_Thread_startVirtual)},
+    {"java/lang/Thread", "currentThread", "()Ljava/lang/Thread;",
+     FORCE(java_lang_Thread_currentThread)},
+    {"java/lang/Thread", "sleep", "(J)V", FORCE(java_lang_Thread_sleep)},
+    {"java/lang/Thread", "yield", "()V", FORCE(java_lang_Thread_yield)},
+    {"java/lang/Thread", "interrupt", "()V", FORCE(java_lang_Thread_interrupt)},
+    {"java/lang/Thread", "isInterrupted", "()Z",
+     FORCE(java_lang_Thread_isInterrupted)},
+    {"java/lang/Thread", "interrupted", "()Z",
+     FORCE(java_lang_Thread_interrupted)},
+    {"ydk/concurrent/LockSupport", "park", "()V",
+     FORCE(ydk_concurrent_LockSupport_park)},
+    {"ydk/concurrent/LockSupport", "parkNanos", "(J)V",
+     FORCE(ydk_concurrent_LockSupport_parkNanos)},
+    {"ydk/concurrent/LockSupport", "unpark", "(Ljava/lang/Thread;)V",
+     FORCE(ydk_concurrent_LockSupport_unpark)},
+    {"ydk/concurrent/ReentrantLock", "init", "()V",
+     FORCE(ydk_concurrent_ReentrantLock_init)},
+    {"ydk/concurrent/ReentrantLock", "lock", "()V",
+     FORCE(ydk_concurrent_ReentrantLock_lock)},
+    {"ydk/concurrent/ReentrantLock", "lockInterruptibly", "()V",
+     FORCE(ydk_concurrent_ReentrantLock_lockInterruptibly)},
+    {"ydk/concurrent/ReentrantLock", "tryLock", "()Z",
+     FORCE(ydk_concurrent_ReentrantLock_tryLock)},
+    {"ydk/concurrent/ReentrantLock", "tryLock", "(J)Z",
+     FORCE(ydk_concurrent_ReentrantLock_tryLock_J)},
+    {"ydk/concurrent/ReentrantLock", "unlock", "()V",
+     FORCE(ydk_concurrent_ReentrantLock_unlock)},
+    {"ydk/concurrent/ReentrantLock", "isHeldByCurrentThread", "()Z",
+     FORCE(ydk_concurrent_ReentrantLock_isHeldByCurrentThread)},
+    {"ydk/concurrent/ReentrantLock", "getHoldCount", "()I",
+     FORCE(ydk_concurrent_ReentrantLock_getHoldCount)},
+    {"ydk/concurrent/CountDownLatch", "init", "(I)V",
+     FORCE(ydk_concurrent_CountDownLatch_init)},
+    {"ydk/concurrent/CountDownLatch", "await", "()V",
+     FORCE(ydk_concurrent_CountDownLatch_await)},
+    {"ydk/concurrent/CountDownLatch", "await", "(J)Z",
+     FORCE(ydk_concurrent_CountDownLatch_await_J)},
+    {"ydk/concurrent/CountDownLatch", "countDown", "()V",
+     FORCE(ydk_concurrent_CountDownLatch_countDown)},
+    {"ydk/concurrent/CountDownLatch", "getCount", "()J",
+     FORCE(ydk_concurrent_CountDownLatch_getCount)},
+    {"ydk/concurrent/Semaphore", "init", "(I)V",
+     FORCE(ydk_concurrent_Semaphore_init)},
+    {"ydk/concurrent/Semaphore", "acquire", "(I)V",
+     FORCE(ydk_concurrent_Semaphore_acquire)},
+    {"ydk/concurrent/Semaphore", "tryAcquire", "(I)Z",
+     FORCE(ydk_concurrent_Semaphore_tryAcquire)},
+    {"ydk/concurrent/Semaphore", "tryAcquire", "(IJ)Z",
+     FORCE(ydk_concurrent_Semaphore_tryAcquire_IJ)},
+    {"ydk/concurrent/Semaphore", "release", "(I)V",
+     FORCE(ydk_concurrent_Semaphore_release)},
+    {"ydk/concurrent/Semaphore", "availablePermits", "()I",
+     FORCE(ydk_concurrent_Semaphore_availablePermits)},
+    {"ydk/concurrent/AtomicInteger", "get", "()I",
+     FORCE(ydk_concurrent_AtomicInteger_get)},
+    {"ydk/concurrent/AtomicInteger", "set", "(I)V",
+     FORCE(ydk_concurrent_AtomicInteger_set)},
+    {"ydk/concurrent/AtomicInteger", "lazySet", "(I)V",
+     FORCE(ydk_concurrent_AtomicInteger_lazySet)},
+    {"ydk/concurrent/AtomicInteger", "getAndSet", "(I)I",
+     FORCE(ydk_concurrent_AtomicInteger_getAndSet)},
+    {"ydk/concurrent/AtomicInteger", "compareAndSet", "(II)Z",
+     FORCE(ydk_concurrent_AtomicInteger_compareAndSet)},
+    {"ydk/concurrent/AtomicInteger", "getAndAdd", "(I)I",
+     FORCE(ydk_concurrent_AtomicInteger_getAndAdd)},
+    {"ydk/concurrent/AtomicLong", "get", "()J",
+     FORCE(ydk_concurrent_AtomicLong_get)},
+    {"ydk/concurrent/AtomicLong", "set", "(J)V",
+     FORCE(ydk_concurrent_AtomicLong_set)},
+    {"ydk/concurrent/AtomicLong", "lazySet", "(J)V",
+     FORCE(ydk_concurrent_AtomicLong_lazySet)},
+    {"ydk/concurrent/AtomicLong", "getAndSet", "(J)J",
+     FORCE(ydk_concurrent_AtomicLong_getAndSet)},
+    {"ydk/concurrent/AtomicLong", "compareAndSet", "(JJ)Z",
+     FORCE(ydk_concurrent_AtomicLong_compareAndSet)},
+    {"ydk/concurrent/AtomicLong", "getAndAdd", "(J)J",
+     FORCE(ydk_concurrent_AtomicLong_getAndAdd)},
+    {"ydk/concurrent/AtomicReference", "get", "()Ljava/lang/Object;",
+     FORCE(ydk_concurrent_AtomicReference_get)},
+    {"ydk/concurrent/AtomicReference", "set", "(Ljava/lang/Object;)V",
+     FORCE(ydk_concurrent_AtomicReference_set)},
+    {"ydk/concurrent/AtomicReference", "lazySet", "(Ljava/lang/Object;)V",
+     FORCE(ydk_concurrent_AtomicReference_lazySet)},
+    {"ydk/concurrent/AtomicReference", "getAndSet",
+     "(Ljava/lang/Object;)Ljava/lang/Object;",
+     FORCE(ydk_concurrent_AtomicReference_getAndSet)},
+    {"ydk/concurrent/AtomicReference", "compareAndSet",
+     "(Ljava/lang/Object;Ljava/lang/Object;)Z",
+     FORCE(ydk_concurrent_AtomicReference_compareAndSet)},
+    {"ydk/concurrent/AtomicIntegerArray", "get", "(I)I",
+     FORCE(ydk_concurrent_AtomicIntegerArray_get)},
+    {"ydk/concurrent/AtomicIntegerArray", "set", "(II)V",
+     FORCE(ydk_concurrent_AtomicIntegerArray_set)},
+    {"ydk/concurrent/AtomicIntegerArray", "lazySet", "(II)V",
+     FORCE(ydk_concurrent_AtomicIntegerArray_lazySet)},
+    {"ydk/concurrent/AtomicIntegerArray", "getAndSet", "(II)I",
+     FORCE(ydk_concurrent_AtomicIntegerArray_getAndSet)},
+    {"ydk/concurrent/AtomicIntegerArray", "compareAndSet", "(III)Z",
+     FORCE(ydk_concurrent_AtomicIntegerArray_compareAndSet)},
+    {"ydk/concurrent/AtomicIntegerArray", "getAndAdd", "(II)I",
+     FORCE(ydk_concurrent_AtomicIntegerArray_getAndAdd)},
+    {"ydk/concurrent/AtomicLongArray", "get", "(I)J",
+     FORCE(ydk_concurrent_AtomicLongArray_get)},
+    {"ydk/concurrent/AtomicLongArray", "set", "(IJ)V",
+     FORCE(ydk_concurrent_AtomicLongArray_set)},
+    {"ydk/concurrent/AtomicLongArray", "lazySet", "(IJ)V",
+     FORCE(ydk_concurrent_AtomicLongArray_lazySet)},
+    {"ydk/concurrent/AtomicLongArray", "getAndSet", "(IJ)J",
+     FORCE(ydk_concurrent_AtomicLongArray_getAndSet)},
+    {"ydk/concurrent/AtomicLongArray", "compareAndSet", "(IJJ)Z",
+     FORCE(ydk_concurrent_AtomicLongArray_compareAndSet)},
+    {"ydk/concurrent/AtomicLongArray", "getAndAdd", "(IJ)J",
+     FORCE(ydk_concurrent_AtomicLongArray_getAndAdd)},
+    {"ydk/concurrent/AtomicReferenceArray", "init", "(I)V",
+     FORCE(ydk_concurrent_AtomicReferenceArray_init)},
+    {"ydk/concurrent/AtomicReferenceArray", "get", "(I)Ljava/lang/Object;",
+     FORCE(ydk_concurrent_AtomicReferenceArray_get)},
+    {"ydk/concurrent/AtomicReferenceArray", "set", "(ILjava/lang/Object;)V",
+     FORCE(ydk_concurrent_AtomicReferenceArray_set)},
+    {"ydk/concurrent/AtomicReferenceArray", "lazySet", "(ILjava/lang/Object;)V",
+     FORCE(ydk_concurrent_AtomicReferenceArray_lazySet)},
+    {"ydk/concurrent/AtomicReferenceArray", "getAndSet",
+     "(ILjava/lang/Object;)Ljava/lang/Object;",
+     FORCE(ydk_concurrent_AtomicReferenceArray_getAndSet)},
+    {"ydk/concurrent/AtomicReferenceArray", "compareAndSet",
+     "(ILjava/lang/Object;Ljava/lang/Object;)Z",
+     FORCE(ydk_concurrent_AtomicReferenceArray_compareAndSet)}
 
 };
 
@@ -71,9 +231,7 @@ YVM::YVM() {
 // main thread. It is also responsible for releasing resources and terminating
 // virtual machine after main method executing accomplished
 void YVM::callMain(const std::string& name) {
-    executor.initialize(1);
-
-    std::future<void> mainFuture = executor.submit([=]() -> void {
+    runtime.threads->spawn([=]() -> void {
 #ifdef YVM_DEBUG_SHOW_THREAD_NAME
         std::cout << "[Main Executing Thread] ID:" << std::this_thread::get_id()
                   << "\n";
@@ -86,17 +244,51 @@ void YVM::callMain(const std::string& name) {
         exec.invokeByName(jc, "main", "([Ljava/lang/String;)V");
     });
 
-    // Block until all sub threads accomplished its task
-    for (const auto& start : executor.getTaskFutures()) {
-        start.get();
-    }
-    // Block until main thread accomplished;
-    mainFuture.get();
+    // Block until main thread and all threads started by java code have
+    // terminated. Platform threads and virtual threads may start each other
+    do {
+        runtime.threads->joinAll();
+    } while (runtime.scheduler->awaitTermination());
+    runtime.scheduler->terminate();
 
     // Close garbage collection. This is optional since operation system would
     // release all resources when process exited
     runtime.gc->terminateGC();
+    runtime.gc->getLog().printSummary();
+    runtime.sampler->finish();
+    runtime.monitorProfiler->finish();
+}
+
+#ifndef _WIN32
+// SIGQUIT is blocked in all threads and consumed by a dedicated thread, which
+// prints heap histogram and monitor contention report at a safepoint, so that
+// heap inspection never runs in a signal handler. It must be started before
+// any other thread is created, since new threads inherit signal mask of their
+// creators
+static void startSignalDispatcher() {
+    sigset_t quitSet;
+    sigemptyset(&quitSet);
+    sigaddset(&quitSet, SIGQUIT);
+    pthread_sigmask(SIG_BLOCK, &quitSet, nullptr);
+
+    std::thread([quitSet]() -> void {
+        int signal = 0;
+        while (sigwait(&quitSet, &signal) == 0) {
+            runtime.safepoint->execute(nullptr, []() -> void {
+                HeapInspector::printHistogram(stdout);
+                if (runtime.monitorProfiler->isEnabled()) {
+                    runtime.monitorProfiler->printReport(stdout);
+                }
+                const std::string& path = runtime.option.heapDumpPath;
+                if (!path.empty() && !HeapInspector::dumpHeap(path)) {
+                    fprintf(stderr, "Failed to write heap dump to %s\n",
+                            path.c_str());
+                }
+            });
+        }
+    }).detach();
 }
+#endif
 
 // Initialize yvm. This function would register native methods into jvm before
 // actual code execution, and also initialize ClassSpace with given java runtime
@@ -107,9 +299,16 @@ void YVM::initialize(const std::string& libPath) {
         registerNativeMethod(
             nativeFunctionTable[i][0], nativeFunctionTable[i][1],
             nativeFunctionTable[i][2],
-            reinterpret_cast<JType* (*)(RuntimeEnv*, JType**, int)>(
+            reinterpret_cast<JType* (*)(RuntimeEnv*, JavaThread*, JType**,
+                                        int)>(
                 const_cast<char*>(nativeFunctionTable[i][3])));
     }
 
     runtime.cs = new ClassSpace(libPath);
+    runtime.sampler->initialize(runtime.option);
+    runtime.monitorProfiler->initialize(runtime.option);
+#ifndef _WIN32
+    startSignalDispatcher();
+#endif
+    runtime.gc->initialize();
 }